@@ -0,0 +1,237 @@
+///////////////////////////////////////////////////////////////////////////////
+// 文件名称: ByteSearchBench.cpp
+// 功能描述: ByteSearch 各实现 (逐字节/SSE2/AVX2) 的校验及吞吐量测试
+//
+// 用法: bytesearch_bench [每项测试的毫秒数 (默认 300)]
+//
+// 说明:
+// * 先以随机数据校验各实现与旧的逐字节分包循环结果一致。
+// * 再按 64B/4KB/1MB 的帧长度，测量 linePacketSplitter 与
+//   nullTerminatedPacketSplitter 的分隔符查找吞吐量 (分隔符位于每帧末尾)。
+//   "legacy" 为向量化之前分包器中的循环，"dispatch" 为运行时选用的实现。
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ByteSearch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////
+
+typedef const char* (*LineSearchFunc)(const char *data, int bytes);
+typedef const char* (*NulSearchFunc)(const char *data, int bytes);
+
+//-----------------------------------------------------------------------------
+// 向量化之前 linePacketSplitter / nullTerminatedPacketSplitter 中的查找循环
+
+static const char* legacyFindLine(const char *data, int bytes)
+{
+    const char *p = data;
+    int i = 0;
+    while (i < bytes)
+    {
+        if (*p == '\r' || *p == '\n')
+            return p;
+        ++p;
+        ++i;
+    }
+    return NULL;
+}
+
+static const char* legacyFindNul(const char *data, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+    {
+        if (data[i] == '\0')
+            return data + i;
+    }
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+
+static const char* scalarFindLine(const char *data, int bytes) { return findLineDelimiterByLevel(BSL_SCALAR, data, bytes); }
+static const char* sse2FindLine(const char *data, int bytes) { return findLineDelimiterByLevel(BSL_SSE2, data, bytes); }
+static const char* avx2FindLine(const char *data, int bytes) { return findLineDelimiterByLevel(BSL_AVX2, data, bytes); }
+static const char* dispatchFindLine(const char *data, int bytes) { return findLineDelimiter(data, bytes); }
+
+static const char* scalarFindNul(const char *data, int bytes) { return findByteByLevel(BSL_SCALAR, data, bytes, '\0'); }
+static const char* sse2FindNul(const char *data, int bytes) { return findByteByLevel(BSL_SSE2, data, bytes, '\0'); }
+static const char* avx2FindNul(const char *data, int bytes) { return findByteByLevel(BSL_AVX2, data, bytes, '\0'); }
+static const char* dispatchFindNul(const char *data, int bytes) { return findByte(data, bytes, '\0'); }
+
+struct LineImpl
+{
+    const char *name;
+    BYTE_SEARCH_LEVEL level;      // 所需的实现级别 (CPU 不支持时跳过)
+    LineSearchFunc findLine;
+    NulSearchFunc findNul;
+};
+
+static const LineImpl IMPLS[] =
+{
+    { "legacy",   BSL_SCALAR, &legacyFindLine,   &legacyFindNul },
+    { "scalar",   BSL_SCALAR, &scalarFindLine,   &scalarFindNul },
+    { "sse2",     BSL_SSE2,   &sse2FindLine,     &sse2FindNul },
+    { "avx2",     BSL_AVX2,   &avx2FindLine,     &avx2FindNul },
+    { "dispatch", BSL_SCALAR, &dispatchFindLine, &dispatchFindNul },
+};
+
+static const int IMPL_COUNT = sizeof(IMPLS) / sizeof(IMPLS[0]);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static volatile size_t g_sink = 0;
+
+//-----------------------------------------------------------------------------
+// 描述: 以随机数据校验各实现，返回不一致的次数
+//-----------------------------------------------------------------------------
+static int verify(int rounds)
+{
+    const char ALPHABET[] = "abcdefghij\r\n\0";
+    std::vector<char> buffer(1024);
+    int mismatches = 0;
+
+    srand(12345);
+    for (int round = 0; round < rounds; ++round)
+    {
+        int bytes = rand() % (int)buffer.size();
+        int offset = rand() % 32;
+        int density = 1 + rand() % 512;      // 分隔符的稀疏程度
+
+        if (offset + bytes > (int)buffer.size())
+            bytes = (int)buffer.size() - offset;
+
+        char *data = &buffer[offset];
+        for (int i = 0; i < bytes; ++i)
+            data[i] = (rand() % density == 0) ? ALPHABET[10 + rand() % 3] : ALPHABET[rand() % 10];
+
+        const char *expectLine = legacyFindLine(data, bytes);
+        const char *expectNul = legacyFindNul(data, bytes);
+
+        for (int k = 1; k < IMPL_COUNT; ++k)
+        {
+            if (IMPLS[k].level > getByteSearchLevel()) continue;
+
+            if (IMPLS[k].findLine(data, bytes) != expectLine ||
+                IMPLS[k].findNul(data, bytes) != expectNul)
+            {
+                if (mismatches < 10)
+                    fprintf(stderr, "mismatch: impl=%s bytes=%d offset=%d\n", IMPLS[k].name, bytes, offset);
+                ++mismatches;
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 测量在帧长度为 frameSize 的数据中逐帧查找分隔符的吞吐量 (GB/s)
+//-----------------------------------------------------------------------------
+static double measure(LineSearchFunc func, const std::vector<char>& buffer, int frameSize, int durationMs)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const char *data = &buffer[0];
+    const int totalBytes = (int)buffer.size();
+    double scannedBytes = 0;
+    size_t found = 0;
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::milliseconds(durationMs);
+    Clock::time_point now = start;
+
+    while (now < deadline)
+    {
+        // 模拟分包: 每次从上一个分隔符之后开始查找
+        int pos = 0;
+        while (pos < totalBytes)
+        {
+            const char *p = func(data + pos, totalBytes - pos);
+            if (p == NULL) break;
+            pos = (int)(p - data) + 1;
+            ++found;
+        }
+        scannedBytes += totalBytes;
+        now = Clock::now();
+    }
+
+    g_sink += found;
+    double seconds = std::chrono::duration<double>(now - start).count();
+    return scannedBytes / seconds / 1e9;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 生成帧长度为 frameSize 的数据，每帧末尾为分隔符 delimiter
+//-----------------------------------------------------------------------------
+static void makeFrames(std::vector<char>& buffer, int frameSize, char delimiter)
+{
+    const int TOTAL_BYTES = 4 * 1024 * 1024;
+
+    int frameCount = std::max(1, TOTAL_BYTES / frameSize);
+    buffer.resize((size_t)frameCount * frameSize);
+    for (size_t i = 0; i < buffer.size(); ++i)
+        buffer[i] = (char)('a' + i % 26);
+    for (int i = 0; i < frameCount; ++i)
+        buffer[(size_t)(i + 1) * frameSize - 1] = delimiter;
+}
+
+//-----------------------------------------------------------------------------
+
+static void runThroughput(const char *title, char delimiter, bool searchLine, int durationMs)
+{
+    const int FRAME_SIZES[] = { 64, 4 * 1024, 1024 * 1024 };
+    const char *FRAME_NAMES[] = { "64B", "4KB", "1MB" };
+
+    printf("\n%s (GB/s)\n%-10s", title, "frame");
+    for (int k = 0; k < IMPL_COUNT; ++k)
+        printf("%10s", IMPLS[k].name);
+    printf("\n");
+
+    std::vector<char> buffer;
+    for (int f = 0; f < 3; ++f)
+    {
+        makeFrames(buffer, FRAME_SIZES[f], delimiter);
+
+        printf("%-10s", FRAME_NAMES[f]);
+        for (int k = 0; k < IMPL_COUNT; ++k)
+        {
+            if (IMPLS[k].level > getByteSearchLevel())
+            {
+                printf("%10s", "n/a");
+                continue;
+            }
+
+            LineSearchFunc func = searchLine ? IMPLS[k].findLine : IMPLS[k].findNul;
+            printf("%10.2f", measure(func, buffer, FRAME_SIZES[f], durationMs));
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    const int VERIFY_ROUNDS = 200 * 1000;
+
+    int durationMs = (argc > 1 ? atoi(argv[1]) : 300);
+    if (durationMs <= 0) durationMs = 300;
+
+    printf("cpu level: %s\n", getByteSearchLevelName(getByteSearchLevel()));
+
+    int mismatches = verify(VERIFY_ROUNDS);
+    printf("verify: %d rounds, %d mismatches\n", VERIFY_ROUNDS, mismatches);
+
+    runThroughput("line delimiter", '\n', true, durationMs);
+    runThroughput("nul byte", '\0', false, durationMs);
+
+    return (mismatches == 0 ? 0 : 1);
+}
@@ -0,0 +1,266 @@
+///////////////////////////////////////////////////////////////////////////////
+// 文件名称: DelegateBench.cpp
+// 功能描述: EventLoop::delegateToLoop() 在多生产者竞争下的性能测试
+//
+// 用法: delegate_bench [生产者线程数 (默认 32)] [事件循环数 (默认 8)] [每个生产者的委托次数 (默认 100000)]
+//
+// 说明:
+// * "mpsc"  为当前实现: 无锁 MpscQueue，且仅当事件循环正在 (或即将) 阻塞等待时
+//   (isWaiting_) 才唤醒它。
+// * "mutex" 为改写前的实现: 在互斥锁保护下压入 FunctorList，每次委托都唤醒事件
+//   循环，事件循环在同一把锁下交换出全部仿函数。
+// * 先在单线程中测量两种队列本身每次压入并取出执行的耗时 (不含线程竞争及唤醒)。
+// * 再由各生产者轮流向各事件循环委托仿函数。输出生产者端每次委托的平均耗时、全部
+//   仿函数执行完毕的总耗时，以及实际到达 wakeupLoop() 的次数 (其中写 eventfd 的
+//   次数及因已有未处理的唤醒而省去的次数)。
+///////////////////////////////////////////////////////////////////////////////
+
+#include "EventLoop.h"
+#include "TCPServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// class LegacyEventLoop - 以改写前的 FunctorList 方式接收委托的事件循环
+
+class LegacyEventLoop : public OsEventLoop
+{
+public:
+    LegacyEventLoop() {}
+    virtual ~LegacyEventLoop() { stop(false, true); }
+
+    void legacyDelegateToLoop(const Functor& functor)
+    {
+        {
+            AutoLocker locker(legacyFunctors_.mutex);
+            legacyFunctors_.items.push_back(functor);
+        }
+
+        wakeupLoop();
+    }
+
+protected:
+    virtual void doLoopWork(Thread *thread)
+    {
+        OsEventLoop::doLoopWork(thread);
+
+        Functors functors;
+        {
+            AutoLocker locker(legacyFunctors_.mutex);
+            functors.swap(legacyFunctors_.items);
+        }
+
+        for (size_t i = 0; i < functors.size(); ++i)
+            functors[i]();
+    }
+
+private:
+    FunctorList legacyFunctors_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+enum BENCH_MODE { BM_MPSC, BM_MUTEX };
+
+// 每个事件循环已执行的仿函数个数 (独占缓存行，仅由事件循环线程写入)
+struct LoopCounter
+{
+    std::atomic<long> executed;
+    char padding[64 - sizeof(std::atomic<long>)];
+};
+
+struct BenchResult
+{
+    double pushNsPerOp;       // 生产者端每次委托的平均耗时 (纳秒)
+    double totalMs;           // 自开始委托至全部执行完毕的耗时 (毫秒)
+    long wakeupCalls;         // 到达 wakeupLoop() 的次数
+    long wakeupWrites;        // 其中实际写 eventfd 的次数
+};
+
+//-----------------------------------------------------------------------------
+
+static void increaseCounter(LoopCounter *counter)
+{
+    counter->executed.store(counter->executed.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 生产者线程，轮流向各事件循环委托仿函数
+//-----------------------------------------------------------------------------
+static void producerProc(BENCH_MODE mode, std::vector<EventLoop*> *loops,
+    std::vector<LoopCounter> *counters, int producerIndex, int opCount,
+    std::atomic<bool> *startFlag, std::atomic<long> *pushNanos)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const int loopCount = (int)loops->size();
+
+    while (!startFlag->load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+    Clock::time_point start = Clock::now();
+
+    for (int i = 0; i < opCount; ++i)
+    {
+        int index = (producerIndex + i) % loopCount;
+        Functor functor = std::bind(&increaseCounter, &(*counters)[index]);
+
+        if (mode == BM_MPSC)
+            (*loops)[index]->delegateToLoop(functor);
+        else
+            static_cast<LegacyEventLoop*>((*loops)[index])->legacyDelegateToLoop(functor);
+    }
+
+    long nanos = (long)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    pushNanos->fetch_add(nanos);
+}
+
+//-----------------------------------------------------------------------------
+
+static BenchResult runBench(BENCH_MODE mode, int producerCount, int loopCount, int opCount)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    std::vector<EventLoop*> loops;
+    std::vector<LoopCounter> counters(loopCount);
+    for (int i = 0; i < loopCount; ++i)
+    {
+        counters[i].executed.store(0);
+        loops.push_back(mode == BM_MPSC ? new OsEventLoop() : new LegacyEventLoop());
+        loops[i]->start();
+    }
+
+    // 等待各事件循环进入阻塞等待
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    TcpInspectInfo& info = TcpInspectInfo::instance();
+    long wakeupWrites = info.wakeupCount.get();
+    long wakeupSkips = info.wakeupSkippedCount.get();
+
+    std::atomic<bool> startFlag(false);
+    std::atomic<long> pushNanos(0);
+    std::vector<std::thread> producers;
+    for (int i = 0; i < producerCount; ++i)
+    {
+        producers.push_back(std::thread(&producerProc, mode, &loops, &counters,
+            i, opCount, &startFlag, &pushNanos));
+    }
+
+    Clock::time_point start = Clock::now();
+    startFlag.store(true, std::memory_order_release);
+
+    for (int i = 0; i < producerCount; ++i)
+        producers[i].join();
+
+    const long totalOps = (long)producerCount * opCount;
+    for (;;)
+    {
+        long executed = 0;
+        for (int i = 0; i < loopCount; ++i)
+            executed += counters[i].executed.load(std::memory_order_relaxed);
+        if (executed >= totalOps) break;
+        std::this_thread::yield();
+    }
+
+    BenchResult result;
+    result.totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    result.pushNsPerOp = (double)pushNanos.load() / totalOps;
+    result.wakeupWrites = info.wakeupCount.get() - wakeupWrites;
+    result.wakeupCalls = result.wakeupWrites + (info.wakeupSkippedCount.get() - wakeupSkips);
+
+    for (int i = 0; i < loopCount; ++i)
+    {
+        loops[i]->stop(false, true);
+        delete loops[i];
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 单线程中测量队列本身每次压入并取出执行的耗时 (纳秒)
+//-----------------------------------------------------------------------------
+static double measureQueueCost(BENCH_MODE mode, int opCount)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const int BATCH_SIZE = 1000;
+    LoopCounter counter;
+    counter.executed.store(0);
+
+    MpscQueue<Functor> queue;
+    EventLoop::FunctorList list;
+    Clock::time_point start = Clock::now();
+
+    for (int done = 0; done < opCount; done += BATCH_SIZE)
+    {
+        EventLoop::Functors functors;
+
+        if (mode == BM_MPSC)
+        {
+            for (int i = 0; i < BATCH_SIZE; ++i)
+                queue.push(std::bind(&increaseCounter, &counter));
+            queue.popAll(functors);
+        }
+        else
+        {
+            for (int i = 0; i < BATCH_SIZE; ++i)
+            {
+                AutoLocker locker(list.mutex);
+                list.items.push_back(std::bind(&increaseCounter, &counter));
+            }
+
+            AutoLocker locker(list.mutex);
+            functors.swap(list.items);
+        }
+
+        for (size_t i = 0; i < functors.size(); ++i)
+            functors[i]();
+    }
+
+    double nanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return nanos / counter.executed.load();
+}
+
+//-----------------------------------------------------------------------------
+
+static void printResult(const char *name, const BenchResult& r, long totalOps)
+{
+    printf("%-8s push %8.1f ns/op   total %9.1f ms   %6.2f Mops/s   wakeup calls %9ld (%5.1f%%)   eventfd writes %8ld\n",
+        name, r.pushNsPerOp, r.totalMs, totalOps / r.totalMs / 1000.0,
+        r.wakeupCalls, 100.0 * r.wakeupCalls / totalOps, r.wakeupWrites);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    const int ROUNDS = 3;
+
+    int producerCount = (argc > 1 ? atoi(argv[1]) : 32);
+    int loopCount = (argc > 2 ? atoi(argv[2]) : 8);
+    int opCount = (argc > 3 ? atoi(argv[3]) : 100000);
+
+    if (producerCount <= 0) producerCount = 32;
+    if (loopCount <= 0) loopCount = 8;
+    if (opCount <= 0) opCount = 100000;
+
+    const long totalOps = (long)producerCount * opCount;
+    printf("queue cost (single thread): mutex %.1f ns/op, mpsc %.1f ns/op\n",
+        measureQueueCost(BM_MUTEX, 2000 * 1000), measureQueueCost(BM_MPSC, 2000 * 1000));
+    printf("producers=%d loops=%d delegates=%ld\n", producerCount, loopCount, totalOps);
+
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        printResult("mutex", runBench(BM_MUTEX, producerCount, loopCount, opCount), totalOps);
+        printResult("mpsc", runBench(BM_MPSC, producerCount, loopCount, opCount), totalOps);
+    }
+
+    return 0;
+}
@@ -572,6 +572,7 @@ private:
     {
         SRS_SENDING_RES_HEADERS,
         SRS_SENDING_CONTENT,
+        SRS_SENDING_FILE,         // The content file has been handed to TcpConnection::sendFile().
         SRS_COMPLETE,
     };
 
@@ -741,6 +742,10 @@ public:
 		int packetSize, const Context& context);
 	// TCP连接上的一个发送任务已完成
 	virtual void onTcpSendComplete(const TcpConnectionPtr& connection, const Context& context);
+	// TCP连接上待发送的数据量达到了高水位
+	virtual void onTcpHighWaterMark(const TcpConnectionPtr& connection, int pendingBytes);
+	// TCP连接上待发送的数据量回落到了低水位
+	virtual void onTcpWriteDrained(const TcpConnectionPtr& connection);
 
 	void open();
 	void close();
@@ -22,7 +22,9 @@
 #include <fcntl.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/ioctl.h>
+#include <limits.h>
 #include <net/if_arp.h>
 #include <net/if.h>
 #include <netinet/tcp.h>
@@ -51,6 +53,8 @@ class UdpListenerThread;
 class UdpListenerThreadPool;
 class TcpListenerThread;
 
+struct SocketTuning;
+
 ///////////////////////////////////////////////////////////////////////////////
 // 常量定义
 
@@ -288,6 +292,18 @@ std::string lookupHostAddr(const std::string& host);
 //取最后的错误码并抛出异常
 void ThrowSocketLastError();
 
+//将调优参数应用到套接字
+// 参数:
+//   isListener    - 是否为监听套接字 (TCP_DEFER_ACCEPT 仅用于监听套接字)
+//   failedOptions - 非空时返回设置失败的选项名称 (以空格分隔)
+// 返回:
+//   是否全部设置成功
+bool applySocketTuning(SOCKET handle, const SocketTuning& tuning, bool isListener,
+    std::string *failedOptions = NULL);
+
+//取得套接字上调优参数的实际生效值 (每行一项，如 "so_rcvbuf: 131072")
+std::string getSocketTuningReport(SOCKET handle, bool isListener);
+
 ///////////////////////////////////////////////////////////////////////////////
 // class InetAddress - IPv4地址类
 
@@ -336,6 +352,41 @@ public:
 
 #pragma pack()
 
+///////////////////////////////////////////////////////////////////////////////
+// class SocketTuning - TCP套接字调优参数
+//
+// 说明:
+// * 各项为 -1 时不设置，保持系统缺省值。
+// * TcpServer 在 listen() 之前将其应用到监听套接字 (接受的连接由此继承缓存大小
+//   和窗口扩大因子)，并在接受连接时应用到每个连接；TcpConnector 在 connect() 之前
+//   应用到新建的套接字。
+// * 标注 "仅 Linux" 的项在其它平台上忽略。
+
+struct SocketTuning
+{
+public:
+    int recvBufferSize;    // SO_RCVBUF (字节，内核实际取其两倍)
+    int sendBufferSize;    // SO_SNDBUF (字节，内核实际取其两倍)
+    int noDelay;           // TCP_NODELAY (0/1)
+    int quickAck;          // TCP_QUICKACK (0/1，仅 Linux。内核可能自行退出快速确认模式)
+    int deferAccept;       // TCP_DEFER_ACCEPT (秒，仅 Linux，只用于监听套接字)
+    int notSentLowat;      // TCP_NOTSENT_LOWAT (字节，仅 Linux)
+    int busyPoll;          // SO_BUSY_POLL (微秒，仅 Linux，超过系统设置时需要 CAP_NET_ADMIN)
+    int listenBacklog;     // listen() 的队列长度 (-1 表示 BaseTcpServer::LISTEN_QUEUE_SIZE)
+public:
+    SocketTuning()
+    {
+        recvBufferSize = -1;
+        sendBufferSize = -1;
+        noDelay = -1;
+        quickAck = -1;
+        deferAccept = -1;
+        notSentLowat = -1;
+        busyPoll = -1;
+        listenBacklog = -1;
+    }
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // class Socket - 套接字类
 
@@ -365,7 +416,7 @@ protected:
     void setType(int value);
     void setProtocol(int value);
 
-    void bind(WORD port);
+    void bind(WORD port, bool reusePort = false);
 
 private:
     void doSetBlockMode(SOCKET handle, bool value);
@@ -414,6 +465,9 @@ public:
 
     void setNoDelay(bool value);
     void setKeepAlive(bool value);
+#ifdef _COMPILER_LINUX
+    void setCork(bool value);
+#endif
 
     TcpSocket& getSocket() { return socket_; }
     const TcpSocket& getSocket() const { return socket_; }
@@ -426,6 +480,10 @@ protected:
 protected:
     int sendBuffer(void *buffer, int size, bool syncMode = false, int timeoutMSecs = -1);
     int recvBuffer(void *buffer, int size, bool syncMode = false, int timeoutMSecs = -1);
+#ifdef _COMPILER_LINUX
+    int sendBufferV(const struct iovec *iov, int iovCount, int flags = 0);
+    int recvBufferV(struct iovec *iov, int iovCount);
+#endif
 
 private:
     int doSyncSendBuffer(void *buffer, int size, int timeoutMSecs = -1);
@@ -450,6 +508,10 @@ public:
     BaseTcpClient();
     virtual ~BaseTcpClient();
 
+    // 新建套接字在 connect() 之前应用的调优参数
+    const SocketTuning& getSocketTuning() const { return socketTuning_; }
+    void setSocketTuning(const SocketTuning& value) { socketTuning_ = value; }
+
     // 阻塞式连接
     void connect(const std::string& ip, int port);
     // 异步(非阻塞式)连接 (返回 enum ASYNC_CONNECT_STATE)
@@ -463,11 +525,13 @@ public:
 
 protected:
     virtual BaseTcpConnection* createConnection() { return new BaseTcpConnection(); }
+    int beginAsyncConnect(const InetAddress& peerAddr);
 private:
     void ensureConnCreated();
     TcpSocket& getSocket();
 protected:
     BaseTcpConnection *connection_;
+    SocketTuning socketTuning_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -502,6 +566,14 @@ public:
 
     const TcpSocket& getSocket() const { return socket_; }
 
+    bool isReusePort() const { return reusePort_; }
+    void setReusePort(bool value);
+
+    // 监听套接字及接受的连接所采用的调优参数 (须在 open() 之前设置)
+    const SocketTuning& getSocketTuning() const { return socketTuning_; }
+    void setSocketTuning(const SocketTuning& value) { socketTuning_ = value; }
+    std::string getSocketTuningReport() const;
+
     void setCreateConnCallback(const TcpSvrCreateConnCallback& callback);
     void setAcceptConnCallback(const TcpSvrAcceptConnCallback& callback);
 
@@ -512,9 +584,14 @@ protected:
     virtual BaseTcpConnection* createConnection(SOCKET socketHandle);
     virtual void acceptConnection(BaseTcpConnection *connection);
 
+    SOCKET openExtraListener();
+    void listenSocket(SOCKET handle);
+
 private:
     TcpSocket socket_;
     WORD localPort_;
+    bool reusePort_;
+    SocketTuning socketTuning_;
     TcpListenerThread *listenerThread_;
     TcpSvrCreateConnCallback onCreateConn_;
     TcpSvrAcceptConnCallback onAcceptConn_;
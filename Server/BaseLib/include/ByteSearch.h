@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// ByteSearch.h
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _BYTE_SEARCH_H_
+#define _BYTE_SEARCH_H_
+
+#include "Options.h"
+#include "GlobalDefs.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// 说明:
+//   分包器等热点路径上使用的字节查找函数。x86/x64 平台上根据 CPU 在运行时选用
+//   AVX2 或 SSE2 实现 (每次比较 32/16 字节)，其它平台使用逐字节查找。
+
+enum BYTE_SEARCH_LEVEL
+{
+    BSL_SCALAR = 0,   // 逐字节查找
+    BSL_SSE2   = 1,   // SSE2 (16 字节)
+    BSL_AVX2   = 2,   // AVX2 (32 字节)
+};
+
+/*
+* 函数名： findLineDelimiter
+* 功能：   查找第一个 '\r' 或 '\n'
+* 参数：   data  - 数据首字节指针
+*          bytes - 数据字节数
+* 返回值： 指向找到的字节，未找到时返回 NULL
+*/
+const char* findLineDelimiter(const char *data, int bytes);
+
+/*
+* 函数名： findByte
+* 功能：   查找第一个等于 value 的字节 (如 '\0')
+* 参数：   data  - 数据首字节指针
+*          bytes - 数据字节数
+*          value - 要查找的字节
+* 返回值： 指向找到的字节，未找到时返回 NULL
+*/
+const char* findByte(const char *data, int bytes, char value);
+
+/*
+* 函数名： findLineDelimiterByLevel / findByteByLevel
+* 功能：   以指定的实现查找 (用于校验及基准测试)
+* 参数：   level - 选用的实现，CPU 不支持时降为所支持的最高实现
+* 返回值： 同 findLineDelimiter / findByte
+*/
+const char* findLineDelimiterByLevel(BYTE_SEARCH_LEVEL level, const char *data, int bytes);
+const char* findByteByLevel(BYTE_SEARCH_LEVEL level, const char *data, int bytes, char value);
+
+/*
+* 函数名： getByteSearchLevel
+* 功能：   取得当前 CPU 上选用的实现
+* 参数：
+* 返回值： BYTE_SEARCH_LEVEL
+*/
+BYTE_SEARCH_LEVEL getByteSearchLevel();
+
+/*
+* 函数名： getByteSearchLevelName
+* 功能：   取得实现的名称 ("scalar"/"sse2"/"avx2")
+* 参数：
+* 返回值：
+*/
+const char* getByteSearchLevelName(BYTE_SEARCH_LEVEL level);
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // _BYTE_SEARCH_H_
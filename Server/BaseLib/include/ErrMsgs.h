@@ -40,6 +40,7 @@ const char* const SEM_UNSAFE_VALUE_IN_PACKET      = "Unsafe value in packet.";
 
 // thread
 const char* const SEM_THREAD_RUN_ONCE             = "Thread::run() can be call only once.";
+const char* const SEM_SET_THREAD_AFFINITY_ERROR   = "Fail to bind thread %s to cpus (%s).";
 
 // xml_doc
 const char* const SEM_INVALID_XML_FILE_FORMAT     = "Invalid file format.";
@@ -53,9 +54,19 @@ const char* const SEM_INIT_DAEMON_ERROR           = "Init daemon error.";
 
 // server_*
 const char* const SEM_CREATE_PIPE_ERROR           = "Fail to create pipe.";
+const char* const SEM_CREATE_EVENTFD_ERROR        = "Fail to create eventfd.";
 const char* const SEM_CREATE_EPOLL_ERROR          = "Fail to create epoll object.";
 const char* const SEM_EPOLL_WAIT_ERROR            = "epoll_wait error.";
 const char* const SEM_EPOLL_CTRL_ERROR            = "epoll_ctl error (op: %d).";
+const char* const SEM_URING_UNAVAILABLE           = "io_uring is unavailable (%s), falling back to epoll.";
+const char* const SEM_URING_ENTER_ERROR           = "io_uring_enter error (error: %d).";
+const char* const SEM_URING_NO_SQE                = "io_uring submission queue is full.";
+const char* const SEM_ACCEPT_ERROR                = "accept error (error: %d).";
+const char* const SEM_ACCEPT_BACKOFF              = "accept error (error: %d), pausing accept for %d ms (%d similar errors suppressed).";
+const char* const SEM_ACCEPT_ERROR_SUPPRESSED     = "accept error (error: %d) (%d similar errors suppressed).";
+const char* const SEM_SOCKET_TUNING_FAILED        = "fail to apply socket options (%s) on port %d.";
+const char* const SEM_PACKET_FRAMING_ERROR        = "invalid packet framing, disconnecting %s.";
+const char* const SEM_SEND_FILE_ERROR             = "fail to send file (error: %d), disconnecting %s.";
 const char* const SEM_THREAD_KILLED               = "Killed %d %s thread.";
 const char* const SEM_WAIT_FOR_THREADS            = "Waiting %s threads to exit...";
 const char* const SEM_IOCP_ERROR                  = "IOCP Error #%d";
@@ -18,6 +18,7 @@
 #endif
 #ifdef _COMPILER_LINUX
 #include "linux_epoll.h"
+#include "linux_uring.h"
 #endif
 
 
@@ -64,6 +65,9 @@ public:
 
     THREAD_ID getLoopThreadId() const { return loopThreadId_; };
 
+    // 设置事件循环线程的 CPU 绑定 (index 为其在所属线程组中的序号)
+    void setPlacement(const ThreadPlacement& placement, int index);
+
 protected:
     virtual void runLoop(Thread *thread);
     virtual void doLoopWork(Thread *thread) = 0;
@@ -72,9 +76,11 @@ protected:
 protected:
     void executeDelegatedFunctors();
     void executeFinalizer();
+    bool hasFinalizers();
 
-    int calcLoopWaitTimeout();
-    void processExpiredTimers();
+    virtual int calcLoopWaitTimeout();
+    virtual void endLoopWait();
+    virtual void processExpiredTimers();
 
 private:
     TimerId addTimer(Timestamp expiration, INT64 interval, const TimerCallback& callback);
@@ -82,14 +88,17 @@ private:
 protected:
     EventLoopThread *thread_;
     THREAD_ID loopThreadId_;
-    FunctorList delegatedFunctors_;
+    MpscQueue<Functor> delegatedFunctors_;
+    std::atomic<bool> isWaiting_;     // 事件循环是否正在 (或即将) 阻塞等待事件
     FunctorList finalizers_;
-    UINT64 lastCheckTimeoutTicks_;
     TimerQueue timerQueue_;
+    ThreadPlacement placement_;
+    int placementIndex_;
 
     friend class EventLoopThread;
     friend class IocpObject;
     friend class EpollObject;
+    friend class UringObject;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -121,6 +130,10 @@ public:
     void start();
     void stop();
 
+    // 设置各事件循环线程的 CPU 绑定 (须在 start() 之前调用)
+    void setPlacement(const ThreadPlacement& value) { placement_ = value; }
+    const ThreadPlacement& getPlacement() const { return placement_; }
+
     int getCount() { return items_.getCount(); }
     EventLoop* findEventLoop(THREAD_ID loopThreadId);
 
@@ -134,6 +147,7 @@ private:
 protected:
     ObjectList<EventLoop> items_;
     int wantLoopCount_;
+    ThreadPlacement placement_;
     Mutex mutex_;
 };
 
@@ -156,6 +170,7 @@ protected:
 #endif
 #ifdef _COMPILER_LINUX
     EpollObject *epollObject_;
+    UringObject *uringObject_;    // 启用 io_uring 后端时非空 (此时不再使用 epollObject_)
 #endif
 };
 
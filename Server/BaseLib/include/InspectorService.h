@@ -85,6 +85,9 @@ class PredefinedInspector : noncopyable
 public:
 	ServerInspector::CommandItems getItems() const;
 private:
+    static std::string getTcpStats(const PropertyList& argList, std::string& contentType);
+    static std::string getTcpLoops(const PropertyList& argList, std::string& contentType);
+    static std::string getThreadPlacement(const PropertyList& argList, std::string& contentType);
 
 #ifdef _COMPILER_WIN
     static std::string getBasicInfo(const PropertyList& argList, std::string& contentType);
@@ -29,6 +29,7 @@
 #include "NonCopyable.h"
 #include "UtilClass.h"
 #include "ObjectArray.h"
+#include "Singleton.h"
 ///////////////////////////////////////////////////////////////////////////////
 /* 说明
 
@@ -319,6 +320,56 @@
 		mutable Mutex mutex_;
 	};
 
+	///////////////////////////////////////////////////////////////////////////////
+	// class ThreadPlacement - 一组线程的 CPU 绑定设置
+
+	struct ThreadPlacement
+	{
+	public:
+		enum PLACEMENT_MODE
+		{
+			TPM_NONE          = 0,   // 不绑定，由系统调度 (缺省)
+			TPM_CPU_LIST      = 1,   // 第 i 个线程绑定到 cpuLists[i % cpuLists.size()]
+			TPM_PHYSICAL_CORE = 2,   // 每个线程绑定到一个物理核 (各 NUMA 节点交替)
+		};
+
+	public:
+		PLACEMENT_MODE mode;
+		std::vector<IntegerArray> cpuLists;  // TPM_CPU_LIST 模式下各线程的 CPU 列表
+		bool numaLocalMemory;                // 线程分配内存时是否优先取自其 CPU 所在的 NUMA 节点
+
+	public:
+		ThreadPlacement()
+		{
+			mode = TPM_NONE;
+			numaLocalMemory = true;
+		}
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// class ThreadPlacementList - 已绑定 CPU 的线程列表 (用于诊断输出)
+
+	class ThreadPlacementList : public Singleton<ThreadPlacementList>
+	{
+	public:
+		bool apply(const ThreadPlacement& placement, int index, const std::string& owner);
+		void remove();
+		std::string getReport();
+
+	private:
+		struct Item
+		{
+			std::string owner;      // 线程的归属 (如 "event_loop_0")
+			IntegerArray cpus;      // 绑定的 CPU
+			int nodeId;             // CPU 所在的 NUMA 节点 (-1 表示跨节点)
+			bool memoryBound;       // 是否已设置优先从该节点分配内存
+		};
+		typedef std::map<THREAD_ID, Item> Items;
+
+		Items items_;
+		Mutex mutex_;
+	};
+
 	///////////////////////////////////////////////////////////////////////////////
 	// class ThreadPool - 线程池
 
@@ -334,12 +385,15 @@
 		void start(int threadCount);
 		void stop(int maxWaitSecs = TIMEOUT_INFINITE);
 
+		// 设置工作线程的 CPU 绑定 (须在 start() 之前调用)
+		void setPlacement(const ThreadPlacement& value, const std::string& name = "thread_pool");
+
 		void addTask(const Task& task);
 		bool isRunning() const { return isRunning_; }
 
 	private:
 		bool takeTask(Task& task);
-		void threadProc(Thread& thread);
+		void threadProc(Thread& thread, int index);
 
 	private:
 		Condition::Mutex mutex_;
@@ -347,6 +401,8 @@
 		std::deque<Task> tasks_;
 		ThreadList threadList_;
 		bool isRunning_;
+		ThreadPlacement placement_;
+		std::string name_;
 	};
 
 	///////////////////////////////////////////////////////////////////////////////
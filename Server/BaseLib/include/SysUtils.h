@@ -36,6 +36,7 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/syscall.h>
+#include <sched.h>
 #include <sys/stat.h>
 #include <iostream>
 #include <string>
@@ -63,6 +64,17 @@ struct FileFindItem
 
 typedef std::vector<FileFindItem> FileFindResult;
 
+// 逻辑 CPU 的拓扑信息
+struct CpuInfo
+{
+    int cpuId;              // 逻辑 CPU 编号
+    int coreId;             // 物理核编号 (在所属插槽内唯一)
+    int packageId;          // 插槽 (物理 CPU) 编号
+    int nodeId;             // NUMA 节点编号
+};
+
+typedef std::vector<CpuInfo> CpuInfoList;
+
 ///////////////////////////////////////////////////////////////////////////////
 // 杂项函数
 
@@ -376,6 +388,57 @@ UINT64 getTickDiff(UINT64 oldTicks, UINT64 newTicks);
 */
 void sleepSeconds(double seconds, bool allowInterrupt);
 
+//-----------------------------------------------------------------------------
+//-- CPU 拓扑及绑定:
+
+/*
+* 函数名： parseCpuList
+* 功能：   解析 CPU 列表字符串 (如 "0-3,8,10-11"，与 sysfs 中 cpulist 的格式相同)
+* 参数：   str  cpus
+* 返回值：
+*/
+void parseCpuList(const std::string& str, IntegerArray& cpus);
+
+/*
+* 函数名： getCpuTopology
+* 功能：   取得全部在线逻辑 CPU 的拓扑信息 (Linux 下读取 sysfs)
+* 参数：   cpus
+* 返回值：
+*/
+void getCpuTopology(CpuInfoList& cpus);
+
+/*
+* 函数名： getPhysicalCoreCpus
+* 功能：   每个物理核取一个逻辑 CPU (超线程的兄弟 CPU 被略过)，各 NUMA 节点交替排列
+* 参数：   cpus
+* 返回值：
+*/
+void getPhysicalCoreCpus(IntegerArray& cpus);
+
+/*
+* 函数名： getCpusNumaNode
+* 功能：   取得一组逻辑 CPU 共同所属的 NUMA 节点
+* 参数：   cpus
+* 返回值： NUMA 节点编号，CPU 分属不同节点或无法确定时返回 -1
+*/
+int getCpusNumaNode(const IntegerArray& cpus);
+
+/*
+* 函数名： setThreadAffinity
+* 功能：   将当前线程绑定到指定的逻辑 CPU 上
+* 参数：   cpus
+* 返回值： true 成功  false 失败
+*/
+bool setThreadAffinity(const IntegerArray& cpus);
+
+/*
+* 函数名： setThreadPreferredNode
+* 功能：   使当前线程此后分配的内存优先取自指定的 NUMA 节点 (仅 Linux)
+* 参数：   nodeId
+* 返回值： true 成功  false 失败
+*/
+bool setThreadPreferredNode(int nodeId);
+
 //-----------------------------------------------------------------------------
 //-- 随机数:
 /*
@@ -26,12 +26,12 @@
 //
 //   以下情况会立即双向关闭 (shutdown(true, true)) 连接:
 //   1. 连接上有错误发生 (errorOccurred())；
-//   2. 发送或接收超时 (checkTimeout())；
+//   2. 发送或接收超时 (onTaskTimeout())；
 //   3. 程序退出时关闭现存连接 (clearConnections())。
 //
 // * 连接对象 (TcpConnection) 采用 std::shared_ptr 管理，由以下几个角色持有:
 //   1. TcpEventLoop.
-//      由 TcpEventLoop::tcpConnMap_ 持有，TcpEventLoop::removeConnection() 时释放。
+//      由 TcpEventLoop::connections_ 持有，TcpEventLoop::removeConnection() 时释放。
 //      当调用 TcpConnection::setEventLoop(NULL) 时，将引发 removeConnection()。
 //      程序正常退出 (kill 或 App().setTerminated(true)) 时，将清理全部连接
 //      (TcpEventLoop::clearConnections())，从而使 TcpEventLoop 释放它持有的全部
@@ -72,6 +72,8 @@
 #include "EventLoop.h"
 #include "Singleton.h"
 
+#include <mutex>
+
 #ifdef _COMPILER_WIN
 #include <windows.h>
 #endif
@@ -84,6 +86,8 @@
 // 提前声明
 
 class IoBuffer;
+class SharedBuffer;
+class SendQueue;
 class TcpEventLoop;
 class TcpEventLoopList;
 class TcpConnection;
@@ -105,11 +109,28 @@ class MainTcpServer;
 
 #define DEF_TCP_CONT_MAX_BUFF_SIZE   1024*1024*64
 #define DEF_HEART_BEAT_TIME  60*1000
+#define DEF_TCP_MAX_RECV_BYTES_PER_EVENT  1024*256
+#define DEF_URING_QUEUE_DEPTH  1024
+#define DEF_URING_RECV_BUFFER_COUNT  512
+#define DEF_URING_RECV_BUFFER_SIZE  1024*8
+#define DEF_MAX_FRAME_SIZE  1024*1024*16
 ///////////////////////////////////////////////////////////////////////////////
 // 类型定义
 
 typedef std::shared_ptr<TcpConnection> TcpConnectionPtr;
 
+// 连接ID: 高 8 位为事件循环序号，中间 24 位为槽的代数，低 32 位为槽号。0 表示无效ID。
+typedef UINT64 TcpConnectionId;
+typedef std::vector<TcpConnectionId> TcpConnectionIds;
+
+// 数据包视图 (指向连接的接收缓存，仅在回调期间有效)
+struct TcpPacketView
+{
+    const char *data;
+    int bytes;
+};
+typedef std::vector<TcpPacketView> TcpPacketViews;
+
 ///////////////////////////////////////////////////////////////////////////////
 // interfaces
 
@@ -127,6 +148,18 @@ public:
 		int packetSize, const Context& context) = 0;
 	// TCP连接上的一个发送任务已完成
 	virtual void onTcpSendComplete(const TcpConnectionPtr& connection, const Context& context) = 0;
+	// 连续接收模式 (TcpConnection::recvContinuous()) 下，一次收到的全部完整数据包。
+	// 默认逐个转给 onTcpRecvComplete()。
+	virtual void onTcpRecvBatch(const TcpConnectionPtr& connection, const TcpPacketView *packets,
+		int count, const Context& context)
+	{
+		for (int i = 0; i < count; ++i)
+			onTcpRecvComplete(connection, (void*)packets[i].data, packets[i].bytes, context);
+	}
+	// TCP连接上待发送的数据量达到了高水位 (见 TcpWaterMarks)
+	virtual void onTcpHighWaterMark(const TcpConnectionPtr& connection, int pendingBytes) {}
+	// TCP连接上待发送的数据量越过高水位后，又回落到了低水位
+	virtual void onTcpWriteDrained(const TcpConnectionPtr& connection) {}
 };
 
 
@@ -134,9 +167,34 @@ public:
 typedef std::function<void (
     const char *data,   // 缓存中可用数据的首字节指针
     int bytes,          // 缓存中可用数据的字节数
-    int& retrieveBytes  // 返回分离出来的数据包大小，返回0表示现存数据中尚不足以分离出一个完整数据包
+    int& retrieveBytes  // 返回分离出来的数据包大小，返回0表示现存数据中尚不足以分离出一个完整数据包，
+                        // 返回负数表示数据格式错误 (连接将被断开)
 )> PacketSplitter;
 
+// 以普通函数实现的分包器
+typedef void (*PacketSplitterFunc)(const char *data, int bytes, int& retrieveBytes);
+
+// 可续扫描分包器的状态 (每个接收任务一份)
+// 备注: 偏移量均相对于缓存中可用数据的首字节，在取出数据包之前保持有效。
+struct SplitterState
+{
+public:
+    int scanOffset;     // 已扫描过且确认不含分界的字节数，下次从此处继续扫描
+    INT64 frameSize;    // 已从包头中解析出的数据包大小，-1 表示包头尚不完整
+public:
+    SplitterState() { reset(); }
+    void reset() { scanOffset = 0; frameSize = -1; }
+};
+
+// 可续扫描的分包器
+// 与 PacketSplitter 相同，但同一接收任务的多次调用共享 state，从而不必每次都从头扫描。
+typedef std::function<void (
+    const char *data,        // 缓存中可用数据的首字节指针
+    int bytes,               // 缓存中可用数据的字节数
+    SplitterState& state,    // 本接收任务的扫描状态
+    int& retrieveBytes       // 同 PacketSplitter
+)> ResumablePacketSplitter;
+
 ///////////////////////////////////////////////////////////////////////////////
 // 预定义分包器
 
@@ -145,6 +203,11 @@ void linePacketSplitter(const char *data, int bytes, int& retrieveBytes);
 void nullTerminatedPacketSplitter(const char *data, int bytes, int& retrieveBytes);
 void anyPacketSplitter(const char *data, int bytes, int& retrieveBytes);
 
+void resumableLinePacketSplitter(const char *data, int bytes, SplitterState& state, int& retrieveBytes);
+void resumableNullTerminatedPacketSplitter(const char *data, int bytes, SplitterState& state, int& retrieveBytes);
+
+ResumablePacketSplitter getResumablePacketSplitter(const PacketSplitter& packetSplitter);
+
 // 每次接收一个字节的分包器
 const PacketSplitter BYTE_PACKET_SPLITTER = &bytePacketSplitter;
 // 以 '\r'或'\n' 或其组合为分界字符的分包器
@@ -154,19 +217,257 @@ const PacketSplitter NULL_TERMINATED_PACKET_SPLITTER = &nullTerminatedPacketSpli
 // 无论收到多少字节都立即获取的分包器
 const PacketSplitter ANY_PACKET_SPLITTER = &anyPacketSplitter;
 
+// 以下为上述分包器的可续扫描版本。以 LINE_PACKET_SPLITTER 等提交接收任务时，
+// 会自动改用对应的可续扫描版本。
+const ResumablePacketSplitter RESUMABLE_LINE_PACKET_SPLITTER = &resumableLinePacketSplitter;
+const ResumablePacketSplitter RESUMABLE_NULL_TERMINATED_PACKET_SPLITTER = &resumableNullTerminatedPacketSplitter;
+
+///////////////////////////////////////////////////////////////////////////////
+// 长度字段分包器
+//
+// 说明:
+// * 适用于“固定长度的包头 + 包体”格式，包头中 LengthOffset 处有一个 LengthBytes
+//   (1/2/4/8) 字节的无符号长度字段。
+// * LengthIncludesHeader 为 true 表示长度字段的值为整个数据包的大小，否则为包头
+//   之后的数据大小。HeaderBytes 为包头大小，默认为长度字段的末尾。
+// * 数据包大小超过 MaxFrameSize (或小于包头) 时返回 -1，连接将被断开。
+// * 各参数在编译期确定，以函数指针提交接收任务，不经过 std::function 调用:
+//
+//   // 包头 8 字节，第 4 字节起为 4 字节大端长度，长度不含包头
+//   const PacketSplitter MY_SPLITTER = &lengthFieldPacketSplitter<4, 4, true, false, 8>;
+//   connection->recv(MY_SPLITTER);
+
+template <int LengthOffset, int LengthBytes, bool BigEndian = true,
+    bool LengthIncludesHeader = false, int HeaderBytes = LengthOffset + LengthBytes,
+    int MaxFrameSize = DEF_MAX_FRAME_SIZE>
+void lengthFieldPacketSplitter(const char *data, int bytes, int& retrieveBytes)
+{
+    static_assert(LengthBytes == 1 || LengthBytes == 2 || LengthBytes == 4 || LengthBytes == 8,
+        "LengthBytes must be 1, 2, 4 or 8");
+    static_assert(LengthOffset >= 0 && HeaderBytes >= LengthOffset + LengthBytes,
+        "the length field must lie within the header");
+    static_assert(MaxFrameSize >= HeaderBytes, "MaxFrameSize is smaller than the header");
+
+    retrieveBytes = 0;
+    if (bytes < HeaderBytes)
+        return;
+
+    const BYTE *p = (const BYTE*)data + LengthOffset;
+    UINT64 length = 0;
+    for (int i = 0; i < LengthBytes; ++i)
+        length |= (UINT64)p[i] << (8 * (BigEndian ? LengthBytes - 1 - i : i));
+
+    if (length > (UINT64)MaxFrameSize)
+    {
+        retrieveBytes = -1;
+        return;
+    }
+
+    UINT64 frameSize = (LengthIncludesHeader ? length : length + HeaderBytes);
+    if (frameSize < (UINT64)HeaderBytes || frameSize > (UINT64)MaxFrameSize)
+        retrieveBytes = -1;
+    else if ((UINT64)bytes >= frameSize)
+        retrieveBytes = (int)frameSize;
+}
+
+//-----------------------------------------------------------------------------
+// 变长整数 (varint) 长度前缀分包器
+//
+// 说明:
+// * 数据包格式为 “LengthOffset 字节的固定前缀 + varint 长度 + 包体”，varint 为
+//   protobuf 所用的 base-128 编码 (每字节低 7 位有效，最高位为 1 表示后续还有字节)，
+//   长度值不含前缀及 varint 自身。
+// * 包体超过 MaxFrameSize 或 varint 超过 5 字节时返回 -1。
+
+template <int LengthOffset = 0, int MaxFrameSize = DEF_MAX_FRAME_SIZE>
+void varintPacketSplitter(const char *data, int bytes, int& retrieveBytes)
+{
+    const int MAX_VARINT_BYTES = 5;
+
+    retrieveBytes = 0;
+
+    const BYTE *p = (const BYTE*)data + LengthOffset;
+    int available = bytes - LengthOffset;
+    UINT64 length = 0;
+
+    for (int i = 0; i < MAX_VARINT_BYTES; ++i)
+    {
+        if (i >= available)
+            return;
+
+        length |= (UINT64)(p[i] & 0x7F) << (7 * i);
+        if ((p[i] & 0x80) == 0)
+        {
+            UINT64 frameSize = LengthOffset + (i + 1) + length;
+            if (length > (UINT64)MaxFrameSize)
+                retrieveBytes = -1;
+            else if ((UINT64)bytes >= frameSize)
+                retrieveBytes = (int)frameSize;
+            return;
+        }
+    }
+
+    retrieveBytes = -1;
+}
+
+// 常用的长度字段分包器 (长度字段位于数据包开头，且不含自身)
+const PacketSplitter UINT16_BE_LENGTH_PACKET_SPLITTER = &lengthFieldPacketSplitter<0, 2, true>;
+const PacketSplitter UINT16_LE_LENGTH_PACKET_SPLITTER = &lengthFieldPacketSplitter<0, 2, false>;
+const PacketSplitter UINT32_BE_LENGTH_PACKET_SPLITTER = &lengthFieldPacketSplitter<0, 4, true>;
+const PacketSplitter UINT32_LE_LENGTH_PACKET_SPLITTER = &lengthFieldPacketSplitter<0, 4, false>;
+const PacketSplitter VARINT_LENGTH_PACKET_SPLITTER = &varintPacketSplitter<>;
+
 
 
+///////////////////////////////////////////////////////////////////////////////
+// class IoServiceOptions - IoService 的创建参数
+
+struct IoServiceOptions
+{
+public:
+    bool edgeTriggered;           // 是否以边缘触发 (EPOLLET) 模式监视连接 (仅 Linux)
+    int maxRecvBytesPerEvent;     // 边缘触发模式下，每次可接收事件最多读取的字节数 (保证各连接间的公平性)
+    ThreadPlacement placement;    // 各事件循环线程的 CPU 绑定
+
+    // 事件循环的 I/O 后端 (仅 Linux)
+    enum IO_BACKEND
+    {
+        IOB_EPOLL = 0,            // epoll (就绪通知)
+        IOB_URING = 1,            // io_uring (完成通知)，内核不支持时自动改用 epoll
+    };
+
+    IO_BACKEND ioBackend;
+    int uringQueueDepth;          // io_uring 提交队列的长度
+    int uringRecvBufferCount;     // 每个事件循环的接收缓存环中缓存块的个数
+    int uringRecvBufferSize;      // 接收缓存块的字节数
+public:
+    IoServiceOptions()
+    {
+        edgeTriggered = false;
+        maxRecvBytesPerEvent = DEF_TCP_MAX_RECV_BYTES_PER_EVENT;
+        ioBackend = IOB_EPOLL;
+        uringQueueDepth = DEF_URING_QUEUE_DEPTH;
+        uringRecvBufferCount = DEF_URING_RECV_BUFFER_COUNT;
+        uringRecvBufferSize = DEF_URING_RECV_BUFFER_SIZE;
+    }
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // class TcpInspectInfo
 
 class TcpInspectInfo : public Singleton<TcpInspectInfo>
 {
+public:
+    void addLoopList(TcpEventLoopList *loopList);
+    void removeLoopList(TcpEventLoopList *loopList);
+    std::string getLoopLoadReport();
+
 public:
     AtomicInt tcpConnCreateCount;    // TcpConnection 对象的创建次数
     AtomicInt tcpConnDestroyCount;   // TcpConnection 对象的销毁次数
     AtomicInt errorOccurredCount;    // TcpConnection::errorOccurred() 的调用次数
     AtomicInt addConnCount;          // TcpEventLoop::addConnection() 的调用次数
     AtomicInt removeConnCount;       // TcpEventLoop::removeConnection() 的调用次数
+    AtomicInt connectCount;          // TcpConnector::connect() 发起的连接数
+    AtomicInt connectFailedCount;    // TcpConnector 连接失败 (含超时) 的次数
+    AtomicInt connectTimeoutCount;   // TcpConnector 连接超时的次数
+    AtomicInt epollCtlCount;         // 实际执行 epoll_ctl() 的次数
+    AtomicInt epollCtlSkippedCount;  // 因事件掩码未改变而省去的 epoll_ctl() 次数
+    AtomicInt directSendCount;       // postSendTask() 中直接发送成功 (无需等待可发送事件) 的次数
+    AtomicInt sendSyscallCount;      // 发送连接数据时调用 sendmsg() 的次数
+    AtomicInt sendBatchCount;        // TcpConnection::beginBatch() 开始的批量发送次数
+    AtomicInt sendBatchTaskCount;    // 在批量发送范围内提交的发送任务数
+    AtomicInt sendBatchFlushCount;   // 批量发送的 flush 次数 (含本轮事件循环末尾的自动 flush)
+    AtomicInt sendFileCount;         // TcpConnection::sendFile() 提交的文件发送任务数
+    AtomicInt sendFileSyscallCount;  // 发送文件时调用 sendfile()/splice() 的次数
+    AtomicInt sendFileSpliceCount;   // 因 sendfile() 不支持该文件而改用 splice() 的次数
+    AtomicInt wakeupCount;           // 实际写 eventfd 唤醒事件循环的次数
+    AtomicInt wakeupSkippedCount;    // 因已有未处理的唤醒而省去的写 eventfd 次数
+    AtomicInt bufferBlockReuseCount; // IoBuffer 从块池中复用存储块的次数
+    AtomicInt bufferBlockAllocCount; // IoBuffer 向系统申请存储块的次数
+    AtomicInt sendHighWaterCount;    // 发送缓存越过高水位的次数
+    AtomicInt sendDrainedCount;      // 发送缓存回落到低水位的次数
+    AtomicInt sendByIdCount;         // 按连接ID投递的发送次数
+    AtomicInt sendByIdDroppedCount;  // 按连接ID投递时，因连接已不存在而丢弃的次数
+    AtomicInt uringEnterCount;       // io_uring_enter() 的调用次数
+    AtomicInt uringCompletionCount;  // 处理的 io_uring 完成事件数
+    AtomicInt uringRecvNoBufferCount;  // 因接收缓存环用尽而中止 multishot recv 的次数
+    AtomicInt framingErrorCount;     // 分包器报告数据格式错误 (进而断开连接) 的次数
+
+private:
+    std::vector<TcpEventLoopList*> loopLists_;  // 现存的事件循环列表 (用于输出各事件循环的负载)
+    Mutex loopListsMutex_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// class TcpWaterMarks - TCP连接的缓存水位设置
+//
+// 说明:
+// * 发送缓存中待发送的数据量达到 sendHighWaterMark 时回调 onTcpHighWaterMark()，
+//   之后回落至 sendLowWaterMark 及以下时回调 onTcpWriteDrained()。生产者可据此
+//   暂停和恢复发送。两个回调均委托到事件循环中执行，不会在 send() 内部被调用。
+//   sendHighWaterMark 为 0 表示不检查发送水位。
+// * pauseRecvOnSendHigh 为 true 时，越过发送高水位期间暂停接收，从而将背压传递
+//   给对端 (对端不读取应答时，也不再读取它的请求)。
+// * 接收缓存中的数据达到 recvHighWaterMark 且没有接收任务时暂停接收，之后有接收
+//   任务等待数据或缓存回落至 recvLowWaterMark 及以下时恢复接收。
+//   recvHighWaterMark 为 0 表示取 max(16KB, 连接的最大缓存大小)，
+//   recvLowWaterMark 为 0 表示与 recvHighWaterMark 相同。
+
+struct TcpWaterMarks
+{
+public:
+    int sendHighWaterMark;        // 发送高水位 (字节)
+    int sendLowWaterMark;         // 发送低水位 (字节)
+    bool pauseRecvOnSendHigh;     // 越过发送高水位期间是否暂停接收
+    int recvHighWaterMark;        // 接收高水位 (字节)
+    int recvLowWaterMark;         // 接收低水位 (字节)
+public:
+    TcpWaterMarks()
+    {
+        sendHighWaterMark = 0;
+        sendLowWaterMark = 0;
+        pauseRecvOnSendHigh = false;
+        recvHighWaterMark = 0;
+        recvLowWaterMark = 0;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// class IoBufferPool - IoBuffer 存储块池
+//
+// 说明:
+// * 块大小按 2 的幂分级 (MIN_BLOCK_SIZE ~ MAX_POOLED_BLOCK_SIZE)，每级维护一个
+//   空闲块列表。超过 MAX_POOLED_BLOCK_SIZE 的块不入池，直接向系统申请和释放。
+// * 每个 TcpEventLoop 持有一个块池，只在事件循环线程中使用，因此无需加锁。
+
+class IoBufferPool : noncopyable
+{
+public:
+    enum { MIN_BLOCK_SIZE = 1024 };
+    enum { MAX_POOLED_BLOCK_SIZE = 1024*256 };
+    enum { MAX_CACHED_BYTES_PER_CLASS = 1024*1024*4 };  // 每级最多缓存的空闲字节数
+
+public:
+    IoBufferPool();
+    ~IoBufferPool();
+
+    char* allocate(int minSize, int& blockSize);
+    void release(char *block, int blockSize);
+    void clear();
+
+    int getCachedBytes() const { return cachedBytes_; }
+
+    static int getBlockSize(int minSize);
+
+private:
+    static int getSizeClass(int blockSize);
+
+private:
+    typedef std::vector<char*> FreeList;
+
+    std::vector<FreeList> freeLists_;
+    int cachedBytes_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -177,9 +478,13 @@ public:
 // |                 |     (CONTENT)    |                  |
 // +-----------------+------------------+------------------+
 // |                 |                  |                  |
-// 0     <=     readerIndex   <=   writerIndex    <=    size
+// 0     <=     readerIndex   <=   writerIndex    <=    capacity
+//
+// 说明:
+// * 存储块在首次写入时才申请，可读数据被取尽后即归还，因此空闲连接不占用缓存。
+// * 指定了块池 (setPool) 时从块池中申请存储块，否则直接向系统申请。
 
-class IoBuffer
+class IoBuffer : noncopyable
 {
 public:
     enum { INITIAL_SIZE = 1024 };
@@ -189,8 +494,9 @@ public:
     ~IoBuffer();
 
     int getReadableBytes() const { return writerIndex_ - readerIndex_; }
-    int getWritableBytes() const { return (int)buffer_.size() - writerIndex_; }
+    int getWritableBytes() const { return capacity_ - writerIndex_; }
     int getUselessBytes() const { return readerIndex_; }
+    int getCapacity() const { return capacity_; }
 
     void append(const std::string& str);
     void append(const void *data, int bytes);
@@ -203,42 +509,221 @@ public:
     void swap(IoBuffer& rhs);
     const char* peek() const { return getBufferPtr() + readerIndex_; }
 
+    // 供直接写入 (如 readv) 使用: 先保证可写空间，写入后再提交写入的字节数
+    void reserveWritable(int bytes);
+    char* getWritePtr() { return getWriterPtr(); }
+    void commitWrite(int bytes);
+
+    void setPool(IoBufferPool *pool);
+    void shrinkIfIdle();
+
 private:
-    char* getBufferPtr() const { return (char*)&*buffer_.begin(); }
+    char* getBufferPtr() const { return buffer_; }
     char* getWriterPtr() const { return getBufferPtr() + writerIndex_; }
     void makeSpace(int moreBytes);
+    void releaseStorage();
+
+    static char* allocateBlock(IoBufferPool *pool, int minSize, int& blockSize);
+    static void releaseBlock(IoBufferPool *pool, char *block, int blockSize);
 
 private:
-    std::vector<char> buffer_;
+    char *buffer_;
+    int capacity_;
     int readerIndex_;
     int writerIndex_;
+    IoBufferPool *pool_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
-// class TcpEventLoop - 事件循环类
+// class SharedBuffer - 引用计数的只读数据缓存
+//
+// 说明:
+// * 创建时复制 (或接管) 一次数据，此后对象的复制只增加引用计数。
+// * 数据创建后不可修改，因此可在线程间传递，或同时投递给多个连接发送。
+// * 数据在最后一个持有者 (包括尚未发送完毕的发送队列) 释放后销毁。
 
-class TcpEventLoop : public OsEventLoop
+class SharedBuffer
 {
 public:
-    typedef std::map<std::string, TcpConnectionPtr> TcpConnectionMap;  // <connectionName, TcpConnectionPtr>
+    SharedBuffer() {}
+    SharedBuffer(const void *data, int size) :
+        data_(std::make_shared<std::string>((const char*)data, size)) {}
+    explicit SharedBuffer(const std::string& str) :
+        data_(std::make_shared<std::string>(str)) {}
+    explicit SharedBuffer(std::string&& str) :
+        data_(std::make_shared<std::string>(std::move(str))) {}
+
+    const char* getData() const { return data_ ? data_->data() : NULL; }
+    int getSize() const { return data_ ? (int)data_->size() : 0; }
+    bool isEmpty() const { return getSize() == 0; }
+
+private:
+    std::shared_ptr<const std::string> data_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// class SendQueue - 分段式发送队列
+//
+// 说明:
+// * 数据以若干段 (segment) 保存，追加数据时不会移动已有数据。
+// * 小块数据会合并到末尾段中 (末尾段预留了 COALESCE_SIZE 字节的空间)，
+//   大块数据则单独成段。
+// * SharedBuffer 直接以引用方式成段，不复制数据 (过小的除外)。
+// * 可一次取出多段数据的 iovec，供 writev/sendmsg 聚集发送。
+
+class SendQueue
+{
+public:
+    enum { COALESCE_SIZE = 1024*16 };
+    enum { SHARED_COPY_SIZE = 256 };   // 小于此大小的 SharedBuffer 直接复制合并
 
+public:
+    SendQueue() : bytes_(0) {}
+
+    void append(const void *data, int bytes);
+    void append(const SharedBuffer& buffer, int offset = 0);
+    void retrieve(int bytes);
+    void clear();
+
+    int getBytes() const { return bytes_; }
+    bool isEmpty() const { return bytes_ == 0; }
+    int getSegmentCount() const { return (int)segments_.size(); }
+
+#ifdef _COMPILER_LINUX
+    int fillIoVecs(struct iovec *iov, int maxCount, int& totalBytes, int maxBytes = -1) const;
+#endif
+
+private:
+    struct Segment
+    {
+        std::string data;         // 自有数据
+        SharedBuffer shared;      // 引用的共享数据 (非空时忽略 data)
+        int readerIndex;
+
+        Segment() : readerIndex(0) {}
+        bool isShared() const { return !shared.isEmpty(); }
+        const char* getPtr() const { return isShared() ? shared.getData() : data.data(); }
+        int getSize() const { return isShared() ? shared.getSize() : (int)data.size(); }
+        int getReadableBytes() const { return getSize() - readerIndex; }
+    };
+
+    typedef std::deque<Segment> Segments;
+
+private:
+    Segments segments_;
+    int bytes_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// class TcpConnectionTable - 事件循环中的连接表 (slot map)
+//
+// 说明:
+// * 连接存放在连续的槽中，释放的槽以链表串起并优先复用，因此槽数组保持紧凑。
+// * 每个槽有一个代数 (generation)，槽每被释放一次代数即加一。连接ID中含有槽号和
+//   代数，槽被复用后，旧的连接ID不会误指新连接。
+// * 非线程安全，只能在所属事件循环线程中使用。
+
+class TcpConnectionTable : noncopyable
+{
+public:
+    enum { GENERATION_BITS = 24 };
+    enum { MAX_LOOP_INDEX = 0xFF };
+
+public:
+    TcpConnectionTable();
+
+    TcpConnectionId add(const TcpConnectionPtr& connection, int loopIndex);
+    void remove(TcpConnectionId connId);
+    TcpConnectionPtr find(TcpConnectionId connId) const;
+    void clear();
+
+    void getConnections(std::vector<TcpConnectionPtr>& connections) const;
+    int getCount() const { return count_; }
+    bool isEmpty() const { return count_ == 0; }
+
+    static TcpConnectionId makeId(int loopIndex, UINT generation, UINT slot);
+    static int getLoopIndex(TcpConnectionId connId) { return (int)(connId >> 56); }
+    static UINT getGeneration(TcpConnectionId connId) { return (UINT)(connId >> 32) & ((1 << GENERATION_BITS) - 1); }
+    static UINT getSlot(TcpConnectionId connId) { return (UINT)(connId & 0xFFFFFFFF); }
+
+private:
+    struct Slot
+    {
+        TcpConnectionPtr connection;
+        UINT generation;
+        int nextFree;       // 空闲链表中的下一个槽 (-1 表示无)
+
+        Slot() : generation(1), nextFree(-1) {}
+    };
+
+    typedef std::vector<Slot> Slots;
+
+private:
+    Slots slots_;
+    int freeHead_;
+    int count_;
+};
+
+// 连接ID中的事件循环序号只占 8 位
+static_assert(EventLoopList::MAX_LOOP_COUNT - 1 <= TcpConnectionTable::MAX_LOOP_INDEX,
+    "Too many event loops for the loop index in TcpConnectionId");
+
+///////////////////////////////////////////////////////////////////////////////
+// class TcpEventLoop - 事件循环类
+
+class TcpEventLoop : public OsEventLoop
+{
 public:
     TcpEventLoop();
     virtual ~TcpEventLoop();
 
 	void addConnection(TcpConnection *connection,TcpCallbacks* _callback);
     void removeConnection(TcpConnection *connection);
+    void attachConnection(TcpConnection *connection);
+    void assignConnection(TcpConnection *connection);
     void clearConnections();
 
+    // 负载信息 (可在任意线程中读取)
+    int getLoadConnCount() const;
+    INT64 getQueuedSendBytes() const { return queuedSendBytes_.load(std::memory_order_relaxed); }
+    int getLatencyMicros() const;
+    void addQueuedSendBytes(int delta);
+    void markAssigned() { assignedConnCount_.increment(); }
+    void cancelAssigned() { assignedConnCount_.decrement(); }
+
+    IoBufferPool* getBufferPool() { return &bufferPool_; }
+    TimingWheel& getTimingWheel() { return timingWheel_; }
+
+    int getLoopIndex() const { return loopIndex_; }
+    void setLoopIndex(int value) { loopIndex_ = value; }
+    int getConnectionCount() const { return connections_.getCount(); }
+    TcpConnectionPtr findConnection(TcpConnectionId connId) const { return connections_.find(connId); }
+
+    void sendToConnection(TcpConnectionId connId, const SharedBuffer& buffer,
+        const Context& context, int timeout);
+    void sendToConnections(const std::shared_ptr<TcpConnectionIds>& connIds,
+        const SharedBuffer& buffer, const Context& context, int timeout);
+
 protected:
     virtual void runLoop(Thread *thread);
+    virtual int calcLoopWaitTimeout();
+    virtual void endLoopWait();
+    virtual void processExpiredTimers();
     virtual void registerConnection(TcpConnection *connection) = 0;
     virtual void unregisterConnection(TcpConnection *connection) = 0;
 
 private:
-    void checkTimeout();
-private:
-    TcpConnectionMap tcpConnMap_;
+    TimingWheel timingWheel_;              // 各连接收发任务的超时定时
+    IoBufferPool bufferPool_;              // 本事件循环中各连接共用的缓存块池 (须晚于连接销毁)
+    TcpConnectionTable connections_;       // 本事件循环中的全部连接
+    int loopIndex_;                        // 在 TcpEventLoopList 中的序号
+
+    std::atomic<int> connCount_;           // 连接数 (connections_.getCount() 的副本，供其它线程读取)
+    AtomicInt assignedConnCount_;          // 已分派给本事件循环但尚未加入的连接数
+    std::atomic<INT64> queuedSendBytes_;   // 各连接发送队列中的数据总量
+    std::atomic<int> latencyMicros_;       // 每轮事件处理耗时的滑动平均值 (微秒)
+    std::atomic<INT64> lastBusyMicros_;    // 最近一轮事件处理结束的时刻 (微秒)
+    INT64 busyStartMicros_;                // 本轮事件处理开始的时刻 (微秒)
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -247,26 +732,57 @@ private:
 class TcpEventLoopList : public EventLoopList
 {
 public:
-    explicit TcpEventLoopList(int loopCount);
+    // 新连接分派给哪个事件循环的策略
+    enum LOOP_ASSIGN_POLICY
+    {
+        LAP_ROUND_ROBIN        = 0,   // 轮流分派 (缺省)
+        LAP_LEAST_CONNECTIONS  = 1,   // 分派给连接数最少的事件循环
+        LAP_LEAST_QUEUED_BYTES = 2,   // 分派给待发送数据最少的事件循环
+        LAP_LOWEST_LATENCY     = 3,   // 分派给最近每轮处理耗时最短的事件循环
+        LAP_PEER_HASH          = 4,   // 按对端 IP 散列，同一对端的连接总是分派给同一事件循环
+    };
+
+public:
+    explicit TcpEventLoopList(int loopCount, const IoServiceOptions& options = IoServiceOptions());
     virtual ~TcpEventLoopList();
 
-    bool registerToEventLoop(BaseTcpConnection *connection, int eventLoopIndex = -1);
+    bool registerToEventLoop(BaseTcpConnection *connection, int eventLoopIndex = -1,
+        LOOP_ASSIGN_POLICY policy = LAP_ROUND_ROBIN);
+    int selectEventLoop(BaseTcpConnection *connection, LOOP_ASSIGN_POLICY policy);
+    int selectEventLoop(const InetAddress& peerAddr, LOOP_ASSIGN_POLICY policy);
+    TcpEventLoop* reserveEventLoop(const InetAddress& peerAddr, LOOP_ASSIGN_POLICY policy);
+    std::string getLoadReport();
+
+    static const char* getPolicyName(LOOP_ASSIGN_POLICY policy);
 
     TcpEventLoop* getItem(int index) { return (TcpEventLoop*)EventLoopList::getItem(index); }
     TcpEventLoop* operator[] (int index) { return getItem(index); }
 
 protected:
     virtual EventLoop* createEventLoop();
+private:
+    IoServiceOptions options_;
+    AtomicInt rrIndex_;            // 轮流分派的计数
 };
 
 
 class IoService
 {
 public:
-	IoService(int loopCount);
+	IoService(int loopCount, const IoServiceOptions& options = IoServiceOptions());
 	virtual ~IoService();
 
-	bool registerToEventLoop(BaseTcpConnection *connection, int eventLoopIndex = -1);
+	bool registerToEventLoop(BaseTcpConnection *connection, int eventLoopIndex = -1,
+		TcpEventLoopList::LOOP_ASSIGN_POLICY policy = TcpEventLoopList::LAP_ROUND_ROBIN);
+
+	// 按连接ID发送数据 (线程安全)，连接已不存在时数据被丢弃
+	bool send(TcpConnectionId connId, const SharedBuffer& buffer,
+		const Context& context = EMPTY_CONTEXT, int timeout = TIMEOUT_INFINITE);
+	bool send(TcpConnectionId connId, const void *buffer, size_t size,
+		const Context& context = EMPTY_CONTEXT, int timeout = TIMEOUT_INFINITE);
+	// 将同一份数据发送给多个连接 (线程安全)，数据只复制一次
+	void sendMany(const TcpConnectionIds& connIds, const SharedBuffer& buffer,
+		const Context& context = EMPTY_CONTEXT, int timeout = TIMEOUT_INFINITE);
 
 	TcpEventLoopList& GetTcpEventLoopList() {
 		return eventLoopList_;
@@ -279,7 +795,7 @@ private:
 	TcpEventLoopList eventLoopList_;
 };
 
-std::shared_ptr<IoService> CreateIOService(int loopCount);
+std::shared_ptr<IoService> CreateIOService(int loopCount, const IoServiceOptions& options = IoServiceOptions());
 ///////////////////////////////////////////////////////////////////////////////
 // class TcpConnection - Proactor模型下的TCP连接
 
@@ -291,10 +807,10 @@ public:
     struct SendTask
     {
     public:
-        int bytes;
+        INT64 bytes;
         Context context;
         int timeout;
-        UINT startTicks;
+        UINT64 startTicks;   // 成为队首任务 (开始计时) 的时刻，0 表示尚未开始
     public:
         SendTask()
         {
@@ -308,14 +824,30 @@ public:
     {
     public:
         PacketSplitter packetSplitter;
+        PacketSplitterFunc splitterFunc;            // packetSplitter 为普通函数时直接调用，省去 std::function 的间接调用
+        ResumablePacketSplitter resumableSplitter;  // 非空时代替 packetSplitter
+        SplitterState splitterState;
         Context context;
         int timeout;
-        UINT startTicks;
+        UINT64 startTicks;   // 成为队首任务 (开始计时) 的时刻，0 表示尚未开始
+        bool continuous;     // 是否为连续接收任务 (取出数据包后仍留在队首)
     public:
         RecvTask()
         {
+            splitterFunc = NULL;
             timeout = 0;
             startTicks = 0;
+            continuous = false;
+        }
+
+        void splitPacket(const char *data, int bytes, int& retrieveBytes)
+        {
+            if (splitterFunc)
+                splitterFunc(data, bytes, retrieveBytes);
+            else if (resumableSplitter)
+                resumableSplitter(data, bytes, splitterState, retrieveBytes);
+            else
+                packetSplitter(data, bytes, retrieveBytes);
         }
     };
 
@@ -334,14 +866,48 @@ public:
         int timeout = TIMEOUT_INFINITE
         );
 
+    void send(
+        const SharedBuffer& buffer,
+        const Context& context = EMPTY_CONTEXT,
+        int timeout = TIMEOUT_INFINITE
+        );
+
+    void sendFile(
+        HANDLE fileHandle,
+        INT64 offset,
+        INT64 length,
+        const Context& context = EMPTY_CONTEXT,
+        int timeout = TIMEOUT_INFINITE
+        );
+
     void recv(
         const PacketSplitter& packetSplitter = ANY_PACKET_SPLITTER,
         const Context& context = EMPTY_CONTEXT,
         int timeout = TIMEOUT_INFINITE
         );
 
+    void recv(
+        const ResumablePacketSplitter& packetSplitter,
+        const Context& context = EMPTY_CONTEXT,
+        int timeout = TIMEOUT_INFINITE
+        );
+
+    void recvContinuous(
+        const PacketSplitter& packetSplitter,
+        const Context& context = EMPTY_CONTEXT
+        );
+    void stopContinuousRecv();
+
+    void beginBatch();
+    void flush();
+
+    void setWaterMarks(const TcpWaterMarks& value);
+    const TcpWaterMarks& getWaterMarks() const { return waterMarks_; }
+    bool isSendHighWater() const { return sendHighWater_; }
+
     bool isFromClient() const { return (tcpServer_ == NULL);}
     bool isFromServer() const { return (tcpServer_ != NULL);}
+    TcpConnectionId getConnectionId() const { return connectionId_.load(std::memory_order_acquire); }
     const std::string& getConnectionName() const;
     int getServerIndex() const;
     int getServerPort() const;
@@ -350,27 +916,57 @@ public:
 protected:
     virtual void doDisconnect();
     virtual void eventLoopChanged() {}
+    virtual void setBufferPool(IoBufferPool *pool);
     virtual void postSendTask(const void *buffer, int size, const Context& context, int timeout) = 0;
-    virtual void postRecvTask(const PacketSplitter& packetSplitter, const Context& context, int timeout) = 0;
+    virtual void postSharedSendTask(const SharedBuffer& buffer, const Context& context, int timeout);
+    virtual void postSendFileTask(HANDLE fileHandle, INT64 offset, INT64 length,
+        const Context& context, int timeout) = 0;
+    virtual void postRecvTask(const RecvTask& task) = 0;
+    virtual int getPendingSendBytes() const = 0;
+    virtual void sendWaterMarkChanged() {}
+    virtual void recvTaskQueueChanged() {}
+    virtual void doBeginBatch() {}
+    virtual void doFlush() {}
 
 protected:
+    void afterSendQueueChanged();
+    void checkSendWaterMark();
+    bool isRecvPausedBySend() const { return sendHighWater_ && waterMarks_.pauseRecvOnSendHigh; }
+    int getRecvHighWaterMark() const;
+    int getRecvLowWaterMark() const;
+
     void errorOccurred();
-    void checkTimeout(UINT curTicks);
+    void framingErrorOccurred();
+    int retrievePacketBatch(RecvTask& task, const char *buffer, int bytes);
+    void updateSendTimer();
+    void updateRecvTimer();
     void setEventLoop(TcpEventLoop *eventLoop);
     TcpEventLoop* getEventLoop() { return eventLoop_; }
 
 private:
     void init();
+    void buildConnectionName() const;
+    void onTaskTimeout(bool isSendTask);
+    void submitRecvTask(const RecvTask& task);
+    void stopContinuousRecvInLoop();
+    static void setRecvTaskSplitter(RecvTask& task, const PacketSplitter& packetSplitter);
 
 protected:
     TcpServer *tcpServer_;                // 所属 TcpServer
     TcpEventLoop *eventLoop_;             // 所属 TcpEventLoop
-    mutable std::string connectionName_;       // 连接名称
-    IoBuffer sendBuffer_;                 // 数据发送缓存
+    std::atomic<TcpConnectionId> connectionId_;  // 连接ID (在事件循环线程中分配，可在任意线程中读取)
+    mutable std::string connectionName_;       // 连接名称 (取得连接ID后首次取用时生成)
+    mutable std::once_flag connectionNameFlag_;
     IoBuffer recvBuffer_;                 // 数据接收缓存
     SendTaskQueue sendTaskQueue_;         // 发送任务队列
     RecvTaskQueue recvTaskQueue_;         // 接收任务队列
     bool isErrorOccurred_;                // 连接上是否发生了错误
+    TcpWaterMarks waterMarks_;            // 缓存水位设置
+    bool sendHighWater_;                  // 待发送的数据量是否已越过高水位 (尚未回落到低水位)
+    int reportedSendBytes_;               // 已计入所属事件循环 queuedSendBytes_ 的待发送字节数
+    TimingWheel::Entry sendTimer_;        // 队首发送任务的超时定时
+    TimingWheel::Entry recvTimer_;        // 队首接收任务的超时定时
+    TcpPacketViews recvBatch_;            // 连续接收模式下本次取出的数据包 (复用存储)
 	TcpCallbacks* m_callback;			  // 回调接口
 	int	  m_maxbuffszie;
     friend class TcpEventLoop;
@@ -389,7 +985,9 @@ public:
 protected:
     virtual BaseTcpConnection* createConnection();
 private:
-    bool registerToEventLoop(std::shared_ptr<IoService> service_, int index = -1);
+    bool registerToEventLoop(std::shared_ptr<IoService> service_, int index = -1,
+        TcpEventLoopList::LOOP_ASSIGN_POLICY policy = TcpEventLoopList::LAP_ROUND_ROBIN);
+    void assignToEventLoop(TcpEventLoop *eventLoop);
 private:
     friend class TcpConnector;
 
@@ -402,11 +1000,30 @@ private:
 
 class TcpServer : public BaseTcpServer
 {
+public:
+    enum ACCEPT_MODE
+    {
+        AM_LISTENER_THREAD = 0,   // 由单独的监听线程接受连接，再轮流分派给各事件循环 (缺省)
+        AM_REUSE_PORT      = 1,   // 每个事件循环各持有一个 SO_REUSEPORT 监听套接字 (仅 Linux)
+    };
+
 public:
     explicit TcpServer(std::shared_ptr<IoService> service,
 				TcpCallbacks* _callback,
 				WORD port,
 				int maxbuffsize = DEF_TCP_CONT_MAX_BUFF_SIZE);
+    virtual ~TcpServer();
+
+    ACCEPT_MODE getAcceptMode() const { return acceptMode_; }
+    void setAcceptMode(ACCEPT_MODE value);
+
+    // 新接受的连接分派给事件循环的策略 (AM_REUSE_PORT 模式下连接由接受它的事件循环处理，不适用)
+    TcpEventLoopList::LOOP_ASSIGN_POLICY getLoopAssignPolicy() const { return loopAssignPolicy_; }
+    void setLoopAssignPolicy(TcpEventLoopList::LOOP_ASSIGN_POLICY value) { loopAssignPolicy_ = value; }
+
+    // 新接受的连接所采用的缓存水位设置
+    const TcpWaterMarks& getWaterMarks() const { return waterMarks_; }
+    void setWaterMarks(const TcpWaterMarks& value) { waterMarks_ = value; }
 
     int getConnectionCount() const {
 		return connCount_.get(); 
@@ -419,6 +1036,8 @@ public:
 		return m_callback;
 	}
 protected:
+    virtual void startListenerThread();
+    virtual void stopListenerThread();
     virtual BaseTcpConnection* createConnection(SOCKET socketHandle);
     virtual void acceptConnection(BaseTcpConnection *connection);
 
@@ -426,8 +1045,32 @@ private:
     void incConnCount() { connCount_.increment(); }
     void decConnCount() { connCount_.decrement(); }
 
+#ifdef _COMPILER_LINUX
+    void startAcceptors();
+    void stopAcceptors();
+    void watchAcceptor(LinuxTcpEventLoop *eventLoop, int index);
+    void acceptInLoop(LinuxTcpEventLoop *eventLoop, int index, EpollObject::EVENT_TYPE eventType);
+    void acceptedInLoop(LinuxTcpEventLoop *eventLoop, SOCKET handle);
+    void removeAcceptor(LinuxTcpEventLoop *eventLoop, int index, Semaphore *semaphore);
+#endif
+
 private:
 	std::shared_ptr<IoService> m_IoService;
+    ACCEPT_MODE acceptMode_;
+    TcpEventLoopList::LOOP_ASSIGN_POLICY loopAssignPolicy_;
+    TcpWaterMarks waterMarks_;
+    std::vector<SOCKET> acceptorHandles_;  // 各事件循环持有的监听套接字 (AM_REUSE_PORT)
+#ifdef _COMPILER_LINUX
+    // 各监听套接字的退避状态 (与 acceptorHandles_ 一一对应，仅在所属事件循环线程中访问)
+    struct AcceptorState
+    {
+        TimerId backOffTimer;     // 暂停接受连接后恢复监视的定时器 (0 表示未暂停)
+        AcceptErrorLog errorLog;
+
+        AcceptorState() : backOffTimer(0) {}
+    };
+    std::vector<AcceptorState> acceptorStates_;
+#endif
     mutable AtomicInt connCount_;
 	int				maxbufsize_;
 	TcpCallbacks* m_callback;
@@ -437,6 +1080,12 @@ private:
 
 ///////////////////////////////////////////////////////////////////////////////
 // class TcpConnector - TCP连接器类
+//
+// 说明:
+// * Linux 下，每个连接先按 loopAssignPolicy 选定事件循环，在该事件循环线程中发起
+//   非阻塞式 connect()，并将套接字加入其 epoll (或 io_uring) 的监视，可写时即完成，
+//   随后连接直接加入该事件循环。超时由该事件循环的定时器队列负责。
+// * Windows 下仍由一个工作者线程轮询各连接的状态。
 
 class TcpConnector : noncopyable
 {
@@ -445,6 +1094,7 @@ public:
         const InetAddress& peerAddr, const Context& context)> CompleteCallback;
 
 private:
+#ifdef _COMPILER_WIN
     typedef std::vector<SOCKET> FdList;
 
 	struct TaskItem
@@ -455,6 +1105,8 @@ private:
         CompleteCallback completeCallback;
         ASYNC_CONNECT_STATE state;
         Context context;
+        int timeout;                  // 连接超时 (毫秒)
+        UINT64 startTicks;            // 发起连接的时刻
     };
 
     typedef ObjectList<TaskItem> TaskList;
@@ -471,6 +1123,27 @@ private:
     };
 
     friend class WorkerThread;
+#endif
+
+#ifdef _COMPILER_LINUX
+    // 一次在事件循环中进行的异步连接
+    struct ConnectTask
+    {
+        ConnectTask(TcpCallbacks* _callback, int maxbuffsize) : tcpClient(_callback, maxbuffsize) {}
+        TcpClient tcpClient;
+        InetAddress peerAddr;
+        CompleteCallback completeCallback;
+        Context context;
+        int timeout;                  // 连接超时 (毫秒)
+        LinuxTcpEventLoop *eventLoop; // 连接所属的事件循环
+        TimerId timerId;              // 超时定时器 (0 表示无)
+        bool watching;                // 套接字是否在事件循环的监视中
+        int generation;               // 发起连接时连接器的代数
+        std::shared_ptr<AtomicInt> connectorGeneration;  // 连接器的当前代数 (clear() 时递增)
+    };
+
+    typedef std::shared_ptr<ConnectTask> ConnectTaskPtr;
+#endif
 
 public:
     TcpConnector(std::shared_ptr<IoService> service_);
@@ -480,10 +1153,20 @@ public:
 		TcpCallbacks* _callback,
         const CompleteCallback& completeCallback,
         const Context& context = EMPTY_CONTEXT,
-		int maxbuffsize = DEF_TCP_CONT_MAX_BUFF_SIZE);
+		int maxbuffsize = DEF_TCP_CONT_MAX_BUFF_SIZE,
+        int timeout = TIMEOUT_INFINITE);
     void clear();
 
+    // 连接成功后分派给事件循环的策略
+    TcpEventLoopList::LOOP_ASSIGN_POLICY getLoopAssignPolicy() const { return loopAssignPolicy_; }
+    void setLoopAssignPolicy(TcpEventLoopList::LOOP_ASSIGN_POLICY value) { loopAssignPolicy_ = value; }
+
+    // 新建套接字在 connect() 之前应用的调优参数 (对此后发起的连接生效)
+    const SocketTuning& getSocketTuning() const { return socketTuning_; }
+    void setSocketTuning(const SocketTuning& value) { AutoLocker locker(mutex_); socketTuning_ = value; }
+
 private:
+#ifdef _COMPILER_WIN
     void start();
     void stop();
     void work(WorkerThread& thread);
@@ -491,14 +1174,31 @@ private:
     void tryConnect();
     void getPendingFdsFromTaskList(int& fromIndex, FdList& fds);
     void checkAsyncConnectState(const FdList& fds, FdList& connectedFds, FdList& failedFds);
+    void checkTimeout();
     TaskItem* findTask(SOCKET fd);
     void invokeCompleteCallback();
+#endif
+
+#ifdef _COMPILER_LINUX
+    static void connectInLoop(const ConnectTaskPtr& task);
+    static void onConnectEvent(const ConnectTaskPtr& task, EpollObject::EVENT_TYPE eventType);
+    static void onConnectTimeout(const ConnectTaskPtr& task);
+    static void finishConnect(const ConnectTaskPtr& task, bool success);
+    static bool isTaskCancelled(const ConnectTaskPtr& task);
+#endif
 
 private:
+#ifdef _COMPILER_WIN
     TaskList taskList_;
-    Mutex mutex_;
     WorkerThread *thread_;
+#endif
+#ifdef _COMPILER_LINUX
+    std::shared_ptr<AtomicInt> generation_;
+#endif
+    Mutex mutex_;
 	std::shared_ptr<IoService> m_IoService;
+    TcpEventLoopList::LOOP_ASSIGN_POLICY loopAssignPolicy_;
+    SocketTuning socketTuning_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -516,8 +1216,14 @@ public:
 
 protected:
     virtual void eventLoopChanged();
+    virtual void setBufferPool(IoBufferPool *pool);
     virtual void postSendTask(const void *buffer, int size, const Context& context, int timeout);
-    virtual void postRecvTask(const PacketSplitter& packetSplitter, const Context& context, int timeout);
+    virtual void postSendFileTask(HANDLE fileHandle, INT64 offset, INT64 length,
+        const Context& context, int timeout);
+    virtual void postRecvTask(const RecvTask& task);
+    virtual int getPendingSendBytes() const { return sendBuffer_.getReadableBytes(); }
+    virtual void sendWaterMarkChanged();
+    virtual void recvTaskQueueChanged();
 
 private:
     void init();
@@ -530,11 +1236,13 @@ private:
     static void onIocpCallback(const TcpConnectionPtr& thisObj, const IocpTaskData& taskData);
     void onSendCallback(const IocpTaskData& taskData);
     void onRecvCallback(const IocpTaskData& taskData);
+    bool retrieveRecvedPackets();
 
 private:
+    IoBuffer sendBuffer_;  // 数据发送缓存
     bool isSending_;       // 是否已向IOCP提交发送任务但尚未收到回调通知
     bool isRecving_;       // 是否已向IOCP提交接收任务但尚未收到回调通知
-    int bytesSent_;        // 自从上次发送任务完成回调以来共发送了多少字节
+    INT64 bytesSent_;      // 自从上次发送任务完成回调以来共发送了多少字节
     int bytesRecved_;      // 自从上次接收任务完成回调以来共接收了多少字节
 };
 
@@ -567,14 +1275,41 @@ protected:
 
 class LinuxTcpConnection : public TcpConnection
 {
+public:
+    enum { MIN_RECV_SIZE_HINT = 1024*4 };    // recvSizeHint_ 的下限
+    enum { MAX_RECV_SIZE_HINT = 1024*256 };  // recvSizeHint_ 的上限
+    enum { MAX_BATCH_BYTES = 1024*64 };      // 批量发送时，发送队列积压到此字节数即先行发送
+    enum { MAX_FILE_CHUNK_BYTES = 1024*1024 };  // 每次 sendfile()/splice() 最多发送的字节数
+
+    // 发送队列中的一段文件数据
+    struct FileSegment
+    {
+        HANDLE fileHandle;
+        INT64 offset;            // 下次读取的文件位置
+        INT64 bytes;             // 尚未从文件中读出的字节数
+        int queuedBytesBefore;   // 须先于此段发出的 sendQueue_ 中的字节数
+        bool useSplice;          // 是否改用 splice() (sendfile() 不支持该文件时)
+    };
+
+    typedef std::deque<FileSegment> FileSegments;
+
 public:
     LinuxTcpConnection(TcpCallbacks* _callback,int _maxbuffsize);
     LinuxTcpConnection(TcpCallbacks* _callback, int _maxbuffsize,TcpServer *tcpServer, SOCKET socketHandle);
+    virtual ~LinuxTcpConnection();
 
 protected:
     virtual void eventLoopChanged();
     virtual void postSendTask(const void *buffer, int size, const Context& context, int timeout);
-    virtual void postRecvTask(const PacketSplitter& packetSplitter, const Context& context, int timeout);
+    virtual void postSharedSendTask(const SharedBuffer& buffer, const Context& context, int timeout);
+    virtual void postSendFileTask(HANDLE fileHandle, INT64 offset, INT64 length,
+        const Context& context, int timeout);
+    virtual void postRecvTask(const RecvTask& task);
+    virtual int getPendingSendBytes() const { return sendQueue_.getBytes(); }
+    virtual void sendWaterMarkChanged();
+    virtual void recvTaskQueueChanged();
+    virtual void doBeginBatch();
+    virtual void doFlush();
 
 private:
     void init();
@@ -586,14 +1321,41 @@ private:
 
     void trySend();
     void tryRecv();
-
+    void processRecvData(const char *data, int bytes);
+    void resumeRecvIfNeeded();
+    void adjustRecvSizeHint(int bytesRecved);
+
+    bool hasPendingSend() const { return !sendQueue_.isEmpty() || !fileSegments_.empty(); }
+    void addSendTask(INT64 size, const Context& context, int timeout);
+    int tryDirectSend(const void *buffer, int size);
+    int sendQueuedData(struct iovec *iov, int maxIovCount, bool& blocked);
+    int sendFileSegment(bool& blocked);
+    int spliceFileSegment(FileSegment& segment, int maxBytes, bool& blocked);
+    int fileSendFailed(int errorCode);
+    void retrieveQueuedData(int bytes);
+    void afterBatchSendTask();
+    void flushSendQueue(bool moreToCome);
+    void scheduleSendComplete();
+    void processSendComplete();
     bool tryRetrievePacket();
     static void afterPostRecvTask(const TcpConnectionPtr& thisObj);
+    static void afterDirectSend(const TcpConnectionPtr& thisObj);
+    static void afterBatchEnd(const TcpConnectionPtr& thisObj);
+    static void afterRecvBudgetExhausted(const TcpConnectionPtr& thisObj);
 
 private:
-    int bytesSent_;                  // 自从上次发送任务完成回调以来共发送了多少字节
+    SendQueue sendQueue_;            // 数据发送队列
+    FileSegments fileSegments_;      // 待发送的文件数据 (与 sendQueue_ 按提交顺序交错发送)
+    int splicePipe_[2];              // splice() 使用的管道 (首次需要时创建)
+    int splicePipeBytes_;            // 管道中尚未发出的字节数
+    int recvSizeHint_;               // 下次直接读入 recvBuffer_ 的预期字节数 (根据历史读取量自适应调整)
+    INT64 bytesSent_;                // 自从上次发送任务完成回调以来共发送了多少字节
     bool enableSend_;                // 是否监视可发送事件
     bool enableRecv_;                // 是否监视可接收事件
+    bool sendCompletePending_;       // 是否已安排在本轮事件循环末尾执行发送完成回调
+    bool batching_;                  // 是否处于批量发送范围内 (beginBatch() 之后、flush() 之前)
+    bool batchFlushPending_;         // 是否已安排在本轮事件循环末尾自动 flush
+    bool sendMorePending_;           // 以 MSG_MORE 发出的数据是否可能仍积压在内核中未推送
 
     friend class LinuxTcpEventLoop;
 };
@@ -604,17 +1366,30 @@ private:
 class LinuxTcpEventLoop : public TcpEventLoop
 {
 public:
-    LinuxTcpEventLoop();
+    LinuxTcpEventLoop(const IoServiceOptions& options = IoServiceOptions());
     virtual ~LinuxTcpEventLoop();
 
     void updateConnection(TcpConnection *connection, bool enableSend, bool enableRecv);
 
+    bool isUringEnabled() const { return uringObject_ != NULL; }
+    bool isEdgeTriggered() const { return !isUringEnabled() && epollObject_->isEdgeTriggered(); }
+    int getMaxRecvBytesPerEvent() const { return maxRecvBytesPerEvent_; }
+
+    void watchHandle(SOCKET handle, bool enableSend, bool enableRecv,
+        const EpollObject::HandleEventCallback& callback);
+    void watchAccept(SOCKET handle, const UringObject::AcceptCallback& callback);
+    void unwatchHandle(SOCKET handle);
+
 protected:
     virtual void registerConnection(TcpConnection *connection);
     virtual void unregisterConnection(TcpConnection *connection);
 
 private:
     void onEpollNotifyEvent(BaseTcpConnection *connection, EpollObject::EVENT_TYPE eventType);
+    void onUringRecvData(BaseTcpConnection *connection, const char *data, int bytes);
+
+private:
+    int maxRecvBytesPerEvent_;       // 边缘触发模式下，每次可接收事件最多读取的字节数
 };
 
 ///////////////////////////////////////////////////////////////////////////////
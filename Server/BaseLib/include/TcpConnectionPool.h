@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+// TcpConnectionPool.h
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _TCP_CONNECTION_POOL_H_
+#define _TCP_CONNECTION_POOL_H_
+
+#include "Options.h"
+#include "UtilClass.h"
+#include "BaseSocket.h"
+#include "TCPServer.h"
+
+#include <map>
+#include <set>
+
+///////////////////////////////////////////////////////////////////////////////
+// 提前声明
+
+class TcpConnectionPool;
+
+///////////////////////////////////////////////////////////////////////////////
+// class TcpConnectionPoolOptions - 连接池的设置
+
+struct TcpConnectionPoolOptions
+{
+public:
+    int minConnections;           // 每个端点保持的最少连接数
+    int maxConnections;           // 每个端点的最多连接数
+    int connectTimeout;           // 连接超时 (毫秒)
+    int healthCheckInterval;      // 健康检查及补充连接的周期 (毫秒)
+    int reconnectBaseDelay;       // 重连退避的初始延迟 (毫秒)
+    int reconnectMaxDelay;        // 重连退避的最大延迟 (毫秒)
+    int minStableTime;            // 连接存活不足此时间 (毫秒) 即断开时，视为一次连接失败
+    int maxBuffSize;              // 连接的最大缓存大小
+public:
+    TcpConnectionPoolOptions()
+    {
+        minConnections = 1;
+        maxConnections = 8;
+        connectTimeout = 3000;
+        healthCheckInterval = 1000;
+        reconnectBaseDelay = 100;
+        reconnectMaxDelay = 30 * 1000;
+        minStableTime = 1000;
+        maxBuffSize = DEF_TCP_CONT_MAX_BUFF_SIZE;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// class TcpConnectionPool - 出站连接池
+//
+// 说明:
+// * 按端点 (InetAddress) 保持 minConnections 至 maxConnections 条已建立的连接。
+//   acquire() 交出当前借出次数最少的连接 (连接可同时借给多个使用者)，用完后以
+//   release() 归还。某端点的全部连接均已借出且未达上限时，追加建立一条连接。
+// * 连接均经由 TcpConnector 建立，由 IoService 的事件循环驱动。连接上的回调转给
+//   构造时指定的 callback，连接的加入与断开由连接池记录后同样转给 callback。
+//   建立时端点已被移除或连接数已达上限的连接被直接断开，不会转给 callback。
+// * 第一个事件循环的定时器每隔 healthCheckInterval 检查一次各连接 (套接字错误、
+//   TCP 状态及用户指定的 HealthProbe)，断开不健康的连接，并补足各端点的连接。
+// * 连接失败后按指数退避重连 (reconnectBaseDelay 起每次加倍，至多 reconnectMaxDelay)，
+//   每次的延迟随机取 [delay/2, delay]，以免对端重启后大量连接同时重连。已建立的
+//   连接断开时，同样随机延迟后才补充连接；若连接存活不足 minStableTime 即断开
+//   (如对端接受连接后立即关闭)，则计为一次失败。存在失败记录时每次只试探一条
+//   连接，直至有连接稳定存活 minStableTime 后才清除失败记录。
+// * 连接池的回调接口会被各连接引用，故须在 IoService 停止后 (或其连接全部断开后)
+//   再销毁连接池。
+
+class TcpConnectionPool :
+    noncopyable,
+    public TcpCallbacks
+{
+public:
+    // 健康检查 (在第一个事件循环线程中调用)，返回 false 表示应断开该连接
+    typedef std::function<bool (const TcpConnectionPtr& connection)> HealthProbe;
+
+private:
+    struct PoolEntry
+    {
+        TcpConnectionPtr connection;
+        int leaseCount;               // 当前借出次数
+        UINT64 connectedTicks;        // 加入连接池的时刻
+    };
+
+    typedef std::vector<PoolEntry> PoolEntries;
+
+    // 一个端点的连接
+    struct Endpoint
+    {
+        InetAddress peerAddr;
+        PoolEntries entries;          // 已建立的连接
+        int dialingCount;             // 正在建立的连接数
+        int failureCount;             // 连续连接失败的次数
+        UINT64 nextDialTicks;         // 此时刻之前不再发起新连接 (退避)
+        UINT rrIndex;                 // 借出次数相同时轮流选择的计数
+    };
+
+    typedef std::map<UINT64, Endpoint*> EndpointMap;
+
+    // 待发起的连接 (端点及连接数)
+    typedef std::vector<std::pair<InetAddress, int> > DialList;
+
+    typedef std::set<TcpConnection*> ConnectionSet;
+
+public:
+    TcpConnectionPool(std::shared_ptr<IoService> service, TcpCallbacks *callback,
+        const TcpConnectionPoolOptions& options = TcpConnectionPoolOptions());
+    virtual ~TcpConnectionPool();
+
+    void addEndpoint(const InetAddress& peerAddr);
+    void removeEndpoint(const InetAddress& peerAddr);
+
+    TcpConnectionPtr acquire(const InetAddress& peerAddr);
+    void release(const TcpConnectionPtr& connection);
+
+    void setHealthProbe(const HealthProbe& probe);
+    void setSocketTuning(const SocketTuning& value) { connector_.setSocketTuning(value); }
+    const TcpConnectionPoolOptions& getOptions() const { return options_; }
+
+    int getConnectionCount(const InetAddress& peerAddr);
+    std::string getStatusReport();
+
+protected:
+    // TcpCallbacks
+    virtual void onTcpConnected(const TcpConnectionPtr& connection);
+    virtual void onTcpDisconnected(const TcpConnectionPtr& connection);
+    virtual void onTcpRecvComplete(const TcpConnectionPtr& connection, void *packetBuffer,
+        int packetSize, const Context& context);
+    virtual void onTcpSendComplete(const TcpConnectionPtr& connection, const Context& context);
+    virtual void onTcpRecvBatch(const TcpConnectionPtr& connection, const TcpPacketView *packets,
+        int count, const Context& context);
+    virtual void onTcpHighWaterMark(const TcpConnectionPtr& connection, int pendingBytes);
+    virtual void onTcpWriteDrained(const TcpConnectionPtr& connection);
+
+private:
+    void onConnectComplete(bool success, TcpConnection *connection,
+        const InetAddress& peerAddr, const Context& context);
+    void onHealthCheckTimer();
+    bool isConnectionHealthy(const TcpConnectionPtr& connection, const HealthProbe& probe);
+    bool removeEntry(const TcpConnectionPtr& connection);
+    int prepareDial(Endpoint& endpoint, int count);
+    void dial(const InetAddress& peerAddr, int count);
+    void dial(const DialList& dialList);
+    void disconnectEntries(const PoolEntries& entries);
+    UINT64 calcBackoffDelay(int failureCount);
+
+    Endpoint* findEndpoint(const InetAddress& peerAddr);
+    static UINT64 makeEndpointKey(const InetAddress& peerAddr);
+    static void cancelTimerInLoop(EventLoop *eventLoop, TimerId timerId, Semaphore *semaphore);
+
+private:
+    std::shared_ptr<IoService> ioService_;
+    TcpCallbacks *callback_;          // 连接上的回调转给此接口
+    TcpConnectionPoolOptions options_;
+    TcpConnector connector_;
+    EndpointMap endpoints_;
+    ConnectionSet acceptedConnections_;  // 已被连接池接纳 (已转给 callback_) 且尚未断开的连接
+    HealthProbe healthProbe_;
+    EventLoop *timerLoop_;            // 健康检查定时器所在的事件循环
+    TimerId healthCheckTimerId_;
+    Mutex mutex_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // _TCP_CONNECTION_POOL_H_
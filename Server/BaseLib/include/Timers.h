@@ -72,6 +72,70 @@ private:
     TimerIds cancelingTimers_;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// class TimingWheel - 哈希时间轮 (每格 1 毫秒)
+//
+// 说明:
+// * 定时项 (Entry) 由使用者嵌入自身对象中，布置和撤销均为 O(1)，不分配内存。
+// * 到期时刻为 expireTicks 的定时项挂在第 (expireTicks % 槽数) 个槽上，超过一圈
+//   的定时项在扫过该槽时跳过，直至真正到期。
+// * 以位图记录非空槽，据此计算事件循环的等待时间。
+// * 非线程安全，只能在所属事件循环线程中使用。
+// * 须以单调递增的毫秒计数驱动 (时间倒退时定时项不会到期)。
+
+class TimingWheel : noncopyable
+{
+public:
+    enum { DEF_SLOT_COUNT = 4096 };  // 须为 2 的幂，缺省约 4 秒一圈
+
+    class Entry : noncopyable
+    {
+    public:
+        Entry() : prev_(NULL), next_(NULL), wheel_(NULL), slot_(-1), expireTicks_(0) {}
+        ~Entry() { cancel(); }
+
+        void setCallback(const Functor& callback) { callback_ = callback; }
+        bool isArmed() const { return wheel_ != NULL; }
+        UINT64 getExpireTicks() const { return expireTicks_; }
+        void cancel() { if (wheel_) wheel_->disarm(this); }
+
+    private:
+        Entry *prev_;
+        Entry *next_;
+        TimingWheel *wheel_;
+        int slot_;
+        UINT64 expireTicks_;
+        Functor callback_;
+
+        friend class TimingWheel;
+    };
+
+public:
+    explicit TimingWheel(UINT64 curTicks, int slotCount = DEF_SLOT_COUNT);
+    ~TimingWheel();
+
+    void arm(Entry *entry, UINT64 expireTicks);
+    void disarm(Entry *entry);
+    void processExpired(UINT64 curTicks);
+    int getWaitTimeout(UINT64 curTicks) const;
+
+    int getCount() const { return count_; }
+    bool isEmpty() const { return count_ == 0; }
+
+private:
+    void link(Entry *head, Entry *entry);
+    void unlink(Entry *entry);
+    void setSlotBit(int slot, bool value);
+    int findNextSlotDistance(int startSlot) const;
+
+private:
+    std::vector<Entry*> slots_;        // 各槽的链表头 (哨兵)
+    std::vector<UINT64> slotBits_;     // 非空槽位图
+    int slotMask_;
+    UINT64 currentTicks_;              // 已处理至此时刻 (含)
+    int count_;                        // 已布置的定时项数
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // class TimerManager
 
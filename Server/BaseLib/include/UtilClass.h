@@ -10,6 +10,7 @@
 #include "SysUtils.h"
 #include "BaseMutex.h"
 #include <deque>
+#include <atomic>
 
 #ifdef _COMPILER_WIN
 #include <stdio.h>
@@ -245,6 +246,90 @@ private:
 	std::deque<T> queue_;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// class MpscQueue - 无锁多生产者单消费者队列 (无界)
+//
+// 说明:
+// 1. 基于 Dmitry Vyukov 的侵入式 MPSC 队列算法。push() 可在任意线程中并发调用，
+//    pop()/popAll()/isEmpty() 只能由唯一的消费者线程调用。
+// 2. push() 仅包含一次原子交换，不会阻塞；某个生产者恰好执行到一半时，消费者
+//    暂时取不到它及其后的元素，此时 isEmpty() 返回 true (即 isEmpty() 表示当前
+//    能否取出元素)。该生产者在 push() 返回后方可得知队列非空，故可据此在 push()
+//    之后通知消费者，而消费者不必为尚未链接的元素空转等待。
+
+template<typename T>
+class MpscQueue : noncopyable
+{
+public:
+	MpscQueue()
+	{
+		Node *stub = new Node();
+		head_.store(stub, std::memory_order_relaxed);
+		tail_ = stub;
+	}
+
+	~MpscQueue()
+	{
+		T item;
+		while (pop(item)) {}
+		delete tail_;
+	}
+
+	void push(const T& item)
+	{
+		Node *node = new Node(item);
+		Node *prev = head_.exchange(node, std::memory_order_seq_cst);
+		prev->next.store(node, std::memory_order_seq_cst);
+	}
+
+	bool pop(T& item)
+	{
+		Node *tail = tail_;
+		Node *next = tail->next.load(std::memory_order_acquire);
+		if (next == NULL)
+			return false;
+
+		// next 成为新的哨兵节点，原哨兵节点释放
+		item = std::move(next->item);
+		next->item = T();
+		tail_ = next;
+		delete tail;
+		return true;
+	}
+
+	// 取出当前队列中的全部元素，追加到 items 中，返回取出的个数
+	int popAll(std::vector<T>& items)
+	{
+		int count = 0;
+		T item;
+		while (pop(item))
+		{
+			items.push_back(std::move(item));
+			++count;
+		}
+		return count;
+	}
+
+	bool isEmpty() const
+	{
+		return tail_->next.load(std::memory_order_seq_cst) == NULL;
+	}
+
+private:
+	struct Node
+	{
+		std::atomic<Node*> next;
+		T item;
+
+		Node() { next.store(NULL, std::memory_order_relaxed); }
+		explicit Node(const T& value) : item(value) { next.store(NULL, std::memory_order_relaxed); }
+	};
+
+private:
+	std::atomic<Node*> head_;    // 生产者端 (最后压入的节点)
+	Node *tail_;                 // 消费者端 (哨兵节点，其 next 为队首元素)
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // class SignalMasker - 信号屏蔽类
 
@@ -12,6 +12,7 @@
 
 #ifdef _COMPILER_LINUX
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #endif
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -19,6 +20,7 @@
 
 #ifdef _COMPILER_LINUX
 class EpollObject;
+class AcceptErrorLog;
 #endif
 
 // 提前声明
@@ -45,9 +47,36 @@ public:
     };
 
     typedef std::vector<struct epoll_event> EventList;
-    typedef int EventPipe[2];
+
+    // 每个文件描述符在 EPoll 中的注册状态
+    struct HandleState
+    {
+        void *param;              // 注册时的 epoll_event.data.ptr
+        UINT appliedEvents;       // 已提交给内核的事件掩码
+        UINT wantedEvents;        // 期望的事件掩码 (尚未提交时与 appliedEvents 不同)
+        bool registered;          // 是否已注册到 EPoll 中
+        bool pending;             // 是否在 pendingHandles_ 中等待提交
+        bool rearm;               // 边缘触发下重新打开了接收，即使掩码未变也须提交
+
+        HandleState() : param(NULL), appliedEvents(0), wantedEvents(0), registered(false), pending(false), rearm(false) {}
+    };
+
+    typedef std::vector<HandleState> HandleStateList;
+    typedef std::vector<int> HandleList;
 
     typedef std::function<void (BaseTcpConnection *connection, EVENT_TYPE eventType)> NotifyEventCallback;
+    typedef std::function<void (EVENT_TYPE eventType)> HandleEventCallback;
+
+    // 非连接类文件描述符 (如监听套接字) 的监视者
+    struct HandleWatcher
+    {
+        int handle;
+        bool active;
+        HandleEventCallback callback;
+    };
+
+    typedef std::map<int, HandleWatcher*> HandleWatcherMap;
+    typedef std::vector<HandleWatcher*> HandleWatcherList;
 
 public:
     EpollObject(EventLoop *eventLoop);
@@ -60,27 +89,73 @@ public:
     void updateConnection(BaseTcpConnection *connection, bool enableSend, bool enableRecv);
     void removeConnection(BaseTcpConnection *connection);
 
+    void watchHandle(int handle, bool enableSend, bool enableRecv, const HandleEventCallback& callback);
+    void unwatchHandle(int handle);
+
     void setNotifyEventCallback(const NotifyEventCallback& callback);
 
+    void setEdgeTriggered(bool value) { edgeTriggered_ = value; }
+    bool isEdgeTriggered() const { return edgeTriggered_; }
+
+    static EVENT_TYPE getEventType(UINT events);
+
 private:
     void createEpoll();
     void destroyEpoll();
-    void createPipe();
-    void destroyPipe();
+    void createWakeupFd();
+    void destroyWakeupFd();
 
+    UINT makeEvents(void *param, bool enableSend, bool enableRecv) const;
+    HandleState* getHandleState(int handle, bool autoCreate);
+    void flushPendingChanges();
     void epollControl(int operation, void *param, int handle, bool enableSend, bool enableRecv);
+    bool epollControl(int operation, void *param, int handle, UINT events);
 
-    void processPipeEvent();
+    void processWakeupEvent();
     void processEvents(int eventCount);
+    void clearRetiredWatchers();
 
 private:
     EventLoop *eventLoop_;        // 所属 EventLoop
     int epollFd_;                 // EPoll 的文件描述符
     EventList events_;            // 存放 epoll_wait() 返回的事件
-    EventPipe pipeFds_;           // 用于唤醒 epoll_wait() 的管道
+    int wakeupFd_;                // 用于唤醒 epoll_wait() 的 eventfd
+    AtomicInt wakeupPending_;     // 是否已有尚未被处理的唤醒 (非 0 表示有)
+    bool edgeTriggered_;          // 连接是否采用边缘触发 (EPOLLET) 模式
+    HandleStateList handleStates_;  // 以文件描述符为下标的注册状态表
+    HandleList pendingHandles_;   // 事件掩码已改变、等待在下次 epoll_wait() 前提交的文件描述符
+    HandleWatcherMap watchers_;   // 被监视的非连接类文件描述符 (handle -> watcher)
+    HandleWatcherList retiredWatchers_;  // 已取消监视、等待释放的 watcher
     NotifyEventCallback onNotifyEvent_;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// 监听套接字接受连接失败时的退避
+// 备注:
+//   因资源不足 (EMFILE/ENFILE/ENOBUFS/ENOMEM) 而失败时，待接受的连接仍在队列中，
+//   监听套接字会持续就绪，若立即重试则事件循环空转。故此时暂停接受连接
+//   ACCEPT_BACKOFF_MS 毫秒后再恢复，错误日志也按 ACCEPT_ERROR_LOG_INTERVAL 限流。
+
+const int ACCEPT_BACKOFF_MS            = 100;    // 暂停接受连接的时长 (毫秒)
+const int ACCEPT_ERROR_LOG_INTERVAL    = 5000;   // 两次记录错误日志的最小间隔 (毫秒)
+
+bool isAcceptResourceError(int errorCode);
+
+///////////////////////////////////////////////////////////////////////////////
+// class AcceptErrorLog - 监听套接字的错误日志限流
+
+class AcceptErrorLog
+{
+public:
+    AcceptErrorLog() : lastLogTicks_(0), suppressedCount_(0) {}
+
+    void log(int errorCode, bool backOff);
+
+private:
+    UINT64 lastLogTicks_;         // 上次记录日志的时刻 (0 表示尚未记录)
+    int suppressedCount_;         // 此后被略去的错误次数
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #endif 
@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////////////
+// linux_uring.h
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _LINUX_URING_H_
+#define _LINUX_URING_H_
+
+#include "Options.h"
+#include "UtilClass.h"
+#include "BaseSocket.h"
+#include "linux_epoll.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// classes
+
+#ifdef _COMPILER_LINUX
+class UringObject;
+#endif
+
+// 提前声明
+class EventLoop;
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef _COMPILER_LINUX
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+///////////////////////////////////////////////////////////////////////////////
+// class UringObject - Linux io_uring 功能封装
+// 备注:
+//   接口与 EpollObject 相同，区别在于:
+//   1. 连接的接收基于完成通知: 每个连接提交一个 multishot recv，内核直接将数据
+//      写入事件循环的接收缓存环 (provided buffer ring)，无需可读后再调用 recv()。
+//   2. 监听套接字使用 multishot accept。
+//   3. 本轮事件循环中累积的请求 (SQE) 与等待在同一次 io_uring_enter() 中提交。
+//   接收缓存优先以缓存环 (IORING_REGISTER_PBUF_RING) 提供给内核，若内核不支持
+//   或实测不可用，则改用传统的 IORING_OP_PROVIDE_BUFFERS 逐块归还。
+//   发送仍先直接调用 send()，仅当内核发送缓存已满时才提交 POLLOUT 请求等待可写。
+
+class UringObject
+{
+public:
+    typedef EpollObject::EVENT_TYPE EVENT_TYPE;
+    typedef EpollObject::NotifyEventCallback NotifyEventCallback;
+    typedef EpollObject::HandleEventCallback HandleEventCallback;
+
+    // bytes > 0 表示收到的数据，否则表示连接已关闭或发生错误
+    typedef std::function<void (BaseTcpConnection *connection, const char *data, int bytes)> RecvDataCallback;
+    typedef std::function<void (SOCKET handle)> AcceptCallback;
+
+    // 请求的类型 (存放于 user_data 的高 8 位)
+    enum OP_TYPE
+    {
+        OP_WAKEUP     = 1,   // 读 eventfd
+        OP_RECV       = 2,   // 连接的 multishot recv
+        OP_SEND_POLL  = 3,   // 等待连接可发送 (单次 POLLOUT)
+        OP_WATCH      = 4,   // 非连接类文件描述符的 multishot poll
+        OP_ACCEPT     = 5,   // 监听套接字的 multishot accept
+        OP_CANCEL     = 6,   // 取消请求
+        OP_PROVIDE    = 7,   // 归还接收缓存块 (仅传统方式)
+    };
+
+    // 非连接类文件描述符的监视者
+    struct HandleWatcher
+    {
+        bool accept;                  // 是否为 multishot accept (否则为 multishot poll)
+        UINT events;                  // 监视的事件掩码
+        HandleEventCallback callback;
+        AcceptCallback acceptCallback;
+        AcceptErrorLog errorLog;      // accept 错误日志的限流
+    };
+
+    // 每个文件描述符的请求状态
+    struct HandleState
+    {
+        BaseTcpConnection *connection;  // 所属连接 (非连接类时为 NULL)
+        HandleWatcher *watcher;         // 监视者 (连接时为 NULL)
+        UINT generation;                // 每次注册或注销时递增，用于识别过期的完成事件
+        bool wantSend;                  // 是否监视可发送
+        bool wantRecv;                  // 是否接收数据
+        bool sendArmed;                 // POLLOUT 请求是否仍在内核中
+        bool recvArmed;                 // multishot 请求 (recv/poll/accept) 是否仍在内核中
+        bool recvCancelling;            // 是否已提交对 multishot recv 的取消
+        bool pending;                   // 是否在 pendingHandles_ 中等待提交
+
+        HandleState() :
+            connection(NULL), watcher(NULL), generation(0), wantSend(false), wantRecv(false),
+            sendArmed(false), recvArmed(false), recvCancelling(false), pending(false) {}
+    };
+
+    typedef std::vector<HandleState> HandleStateList;
+    typedef std::vector<int> HandleList;
+    typedef std::vector<HandleWatcher*> HandleWatcherList;
+
+public:
+    UringObject(EventLoop *eventLoop);
+    ~UringObject();
+
+    bool init(int queueDepth, int recvBufferCount, int recvBufferSize);
+
+    void poll();
+    void wakeup();
+
+    void addConnection(BaseTcpConnection *connection, bool enableSend, bool enableRecv);
+    void updateConnection(BaseTcpConnection *connection, bool enableSend, bool enableRecv);
+    void removeConnection(BaseTcpConnection *connection);
+
+    void watchHandle(int handle, bool enableSend, bool enableRecv, const HandleEventCallback& callback);
+    void watchAccept(int handle, const AcceptCallback& callback);
+    void unwatchHandle(int handle);
+
+    void setNotifyEventCallback(const NotifyEventCallback& callback) { onNotifyEvent_ = callback; }
+    void setRecvDataCallback(const RecvDataCallback& callback) { onRecvData_ = callback; }
+
+private:
+    bool setupRing(int queueDepth);
+    bool setupRecvBuffers(int recvBufferCount, int recvBufferSize);
+    bool registerBufferRing();
+    void unregisterBufferRing();
+    void provideAllRecvBuffers();
+    int probeMultishotRecv();
+    void destroy();
+
+    io_uring_sqe* getSqe();
+    int submit(int waitCount, int timeout);
+    bool popCompletion(UINT64& userData, int& result, UINT& flags);
+    void flushPendingChanges();
+    void processWakeupEvent();
+    void processCompletions();
+    void processCompletion(UINT64 userData, int result, UINT flags);
+
+    HandleState* getHandleState(int handle, bool autoCreate);
+    HandleState* findHandleState(UINT64 userData);
+    void markPending(int handle, HandleState& state);
+    void resetHandleState(int handle, HandleState& state);
+    void retireWatcher(HandleState& state);
+    void clearRetiredWatchers();
+
+    void armWakeup();
+    void armRecv(int handle, HandleState& state);
+    void armSendPoll(int handle, HandleState& state);
+    void armWatcher(int handle, HandleState& state);
+    void rearmWatcher(UINT64 userData);
+    void cancelRequest(UINT64 userData, int handle, UINT generation);
+    void cancelHandle(int handle, UINT generation);
+
+    char* getRecvBuffer(int bufferId) { return recvBuffers_ + (size_t)bufferId * recvBufferSize_; }
+    void recycleRecvBuffer(int bufferId);
+
+    static UINT64 makeUserData(OP_TYPE opType, UINT generation, int handle);
+
+private:
+    EventLoop *eventLoop_;        // 所属 EventLoop
+    int ringFd_;                  // io_uring 的文件描述符
+    UINT features_;               // 内核支持的特性 (IORING_FEAT_XXX)
+
+    // 提交队列 (SQ)
+    void *sqRingPtr_;
+    size_t sqRingSize_;
+    UINT *sqHead_;
+    UINT *sqTail_;
+    UINT sqMask_;
+    UINT sqEntries_;
+    UINT sqLocalTail_;            // 已填写但尚未提交的 SQE 的尾部
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    // 完成队列 (CQ)
+    void *cqRingPtr_;
+    size_t cqRingSize_;
+    UINT *cqHead_;
+    UINT *cqTail_;
+    UINT cqMask_;
+    io_uring_cqe *cqes_;
+
+    // 接收缓存环 (provided buffer ring)
+    io_uring_buf_ring *bufRing_;
+    size_t bufRingSize_;
+    char *recvBuffers_;
+    int recvBufferCount_;
+    int recvBufferSize_;
+    WORD bufRingTail_;
+    bool legacyBuffers_;          // 是否以 IORING_OP_PROVIDE_BUFFERS 提供接收缓存
+
+    int wakeupFd_;                // 用于唤醒 io_uring_enter() 的 eventfd
+    UINT64 wakeupValue_;          // 读 eventfd 的目标
+    AtomicInt wakeupPending_;     // 是否已有尚未被处理的唤醒 (非 0 表示有)
+
+    HandleStateList handleStates_;  // 以文件描述符为下标的请求状态表
+    HandleList pendingHandles_;   // 状态已改变、等待在下次 io_uring_enter() 前提交请求的文件描述符
+    HandleWatcherList retiredWatchers_;  // 已取消监视、等待释放的 watcher
+    NotifyEventCallback onNotifyEvent_;
+    RecvDataCallback onRecvData_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
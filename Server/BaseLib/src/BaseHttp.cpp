@@ -1506,16 +1506,35 @@ void HttpServer::onTcpSendComplete(const TcpConnectionPtr& connection, const Con
     case SRS_SENDING_RES_HEADERS:
     case SRS_SENDING_CONTENT:
         {
-            connContext->sendResState = SRS_SENDING_CONTENT;
-
             Stream *contentStream = connContext->httpResponse.getContentStream();
 
+#ifdef _COMPILER_LINUX
+            // A file content stream is handed to the kernel as a whole (sendfile),
+            // instead of being read and sent block by block through user space.
+            FileStream *fileStream = (connContext->sendResState == SRS_SENDING_RES_HEADERS) ?
+                dynamic_cast<FileStream*>(contentStream) : NULL;
+            if (fileStream != NULL && fileStream->isOpen())
+            {
+                INT64 position = fileStream->getPosition();
+                INT64 size = fileStream->getSize();
+                if (size > position)
+                {
+                    connContext->sendResState = SRS_SENDING_FILE;
+                    connection->sendFile(fileStream->getHandle(), position, size - position);
+                    break;
+                }
+            }
+#endif
+
+            connContext->sendResState = SRS_SENDING_CONTENT;
+
             const int SEND_BLOCK_SIZE = 1024*64;
             Buffer buffer(SEND_BLOCK_SIZE);
 
-            int readSize = contentStream->read(buffer.data(), buffer.getSize());
+            int readSize = (contentStream != NULL) ?
+                contentStream->read(buffer.data(), buffer.getSize()) : 0;
             if (readSize > 0)
-                connection->send(buffer.data(), buffer.getSize(), EMPTY_CONTEXT, options_.sendContentBlockTimeout);
+                connection->send(buffer.data(), readSize, EMPTY_CONTEXT, options_.sendContentBlockTimeout);
             else
             {
                 connContext->sendResState = SRS_COMPLETE;
@@ -1525,6 +1544,11 @@ void HttpServer::onTcpSendComplete(const TcpConnectionPtr& connection, const Con
             break;
         }
 
+    case SRS_SENDING_FILE:
+        connContext->sendResState = SRS_COMPLETE;
+        connection->disconnect();
+        break;
+
     case SRS_COMPLETE:
         break;
 
@@ -1856,6 +1880,24 @@ void WebSocketServer::onTcpSendComplete(const TcpConnectionPtr& connection, cons
 	}
 }
 
+// TCP连接上待发送的数据量达到了高水位
+void WebSocketServer::onTcpHighWaterMark(const TcpConnectionPtr& connection, int pendingBytes)
+{
+	if (m_callback)
+	{
+		m_callback->onTcpHighWaterMark(connection, pendingBytes);
+	}
+}
+
+// TCP连接上待发送的数据量回落到了低水位
+void WebSocketServer::onTcpWriteDrained(const TcpConnectionPtr& connection)
+{
+	if (m_callback)
+	{
+		m_callback->onTcpWriteDrained(connection);
+	}
+}
+
 bool		WebSocketServer::handshark(const TcpConnectionPtr& connection,void *packetBuffer, int packetSize)
 {
 	WebConnContextPtr connContext = connection->getContext().AnyCast<WebConnContextPtr>();
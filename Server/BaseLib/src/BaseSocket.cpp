@@ -7,6 +7,7 @@
 #include "SysUtils.h"
 #include "Exceptions.h"
 #include "LogManager.h"
+#include "ErrMsgs.h"
 
 #ifdef _COMPILER_WIN
 #pragma comment(lib, "ws2_32.lib")
@@ -386,6 +387,94 @@ void ThrowSocketLastError()
     ThrowSocketException(SocketGetLastErrMsg().c_str());
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 设置一个整型套接字选项 (value 为 -1 时不设置)
+//-----------------------------------------------------------------------------
+static bool setSocketIntOption(SOCKET handle, int level, int optName, int value,
+    const char *name, std::string *failedOptions)
+{
+    if (value < 0) return true;
+
+    int optVal = value;
+    if (::setsockopt(handle, level, optName, (char*)&optVal, sizeof(optVal)) == 0)
+        return true;
+
+    if (failedOptions != NULL)
+    {
+        if (!failedOptions->empty()) *failedOptions += " ";
+        *failedOptions += name;
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得一个整型套接字选项的值 (失败时返回 -1)
+//-----------------------------------------------------------------------------
+static int getSocketIntOption(SOCKET handle, int level, int optName)
+{
+    int optVal = 0;
+    socklen_t optLen = sizeof(optVal);
+    if (::getsockopt(handle, level, optName, (char*)&optVal, &optLen) < 0)
+        return -1;
+    return optVal;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 将调优参数应用到套接字
+// 参数:
+//   isListener    - 是否为监听套接字
+//   failedOptions - 非空时返回设置失败的选项名称 (以空格分隔)
+// 返回:
+//   是否全部设置成功
+// 备注:
+//   不抛异常。缓存大小须在 listen()/connect() 之前设置才能影响窗口扩大因子。
+//-----------------------------------------------------------------------------
+bool applySocketTuning(SOCKET handle, const SocketTuning& tuning, bool isListener,
+    std::string *failedOptions)
+{
+    bool result = true;
+
+    result &= setSocketIntOption(handle, SOL_SOCKET, SO_RCVBUF, tuning.recvBufferSize, "SO_RCVBUF", failedOptions);
+    result &= setSocketIntOption(handle, SOL_SOCKET, SO_SNDBUF, tuning.sendBufferSize, "SO_SNDBUF", failedOptions);
+    result &= setSocketIntOption(handle, IPPROTO_TCP, TCP_NODELAY, tuning.noDelay, "TCP_NODELAY", failedOptions);
+
+#ifdef _COMPILER_LINUX
+    result &= setSocketIntOption(handle, IPPROTO_TCP, TCP_NOTSENT_LOWAT, tuning.notSentLowat, "TCP_NOTSENT_LOWAT", failedOptions);
+    result &= setSocketIntOption(handle, SOL_SOCKET, SO_BUSY_POLL, tuning.busyPoll, "SO_BUSY_POLL", failedOptions);
+    if (isListener)
+        result &= setSocketIntOption(handle, IPPROTO_TCP, TCP_DEFER_ACCEPT, tuning.deferAccept, "TCP_DEFER_ACCEPT", failedOptions);
+    else
+        result &= setSocketIntOption(handle, IPPROTO_TCP, TCP_QUICKACK, tuning.quickAck, "TCP_QUICKACK", failedOptions);
+#endif
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得套接字上调优参数的实际生效值 (每行一项)
+// 备注:
+//   取值失败的项显示为 -1。
+//-----------------------------------------------------------------------------
+std::string getSocketTuningReport(SOCKET handle, bool isListener)
+{
+    std::string result;
+
+    result += formatString("so_rcvbuf: %d\n", getSocketIntOption(handle, SOL_SOCKET, SO_RCVBUF));
+    result += formatString("so_sndbuf: %d\n", getSocketIntOption(handle, SOL_SOCKET, SO_SNDBUF));
+    result += formatString("tcp_nodelay: %d\n", getSocketIntOption(handle, IPPROTO_TCP, TCP_NODELAY));
+
+#ifdef _COMPILER_LINUX
+    result += formatString("tcp_notsent_lowat: %d\n", getSocketIntOption(handle, IPPROTO_TCP, TCP_NOTSENT_LOWAT));
+    result += formatString("so_busy_poll: %d\n", getSocketIntOption(handle, SOL_SOCKET, SO_BUSY_POLL));
+    if (isListener)
+        result += formatString("tcp_defer_accept: %d\n", getSocketIntOption(handle, IPPROTO_TCP, TCP_DEFER_ACCEPT));
+    else
+        result += formatString("tcp_quickack: %d\n", getSocketIntOption(handle, IPPROTO_TCP, TCP_QUICKACK));
+#endif
+
+    return result;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // class InetAddress
 
@@ -536,7 +625,7 @@ void Socket::setProtocol(int value)
 //-----------------------------------------------------------------------------
 // 描述: 绑定套接字
 //-----------------------------------------------------------------------------
-void Socket::bind(WORD port)
+void Socket::bind(WORD port, bool reusePort)
 {
     SockAddr addr = InetAddress(ntohl(INADDR_ANY), port).getSockAddr();
     int optVal = 1;
@@ -544,6 +633,12 @@ void Socket::bind(WORD port)
     // 强制重新绑定，而不受其它因素的影响
     setsockopt(handle_, SOL_SOCKET, SO_REUSEADDR, (char*)&optVal, sizeof(optVal));
 
+#if defined(_COMPILER_LINUX) && defined(SO_REUSEPORT)
+    // 允许多个套接字绑定同一端口，由内核在它们之间分配新连接
+    if (reusePort)
+        setsockopt(handle_, SOL_SOCKET, SO_REUSEPORT, (char*)&optVal, sizeof(optVal));
+#endif
+
     // 绑定套接字
     if (::bind(handle_, (struct sockaddr*)&addr, sizeof(addr)) < 0)
         ThrowSocketLastError();
@@ -677,6 +772,21 @@ void BaseTcpConnection::setKeepAlive(bool value)
         (char*)&optVal, sizeof(optVal));
 }
 
+#ifdef _COMPILER_LINUX
+//-----------------------------------------------------------------------------
+// 描述: 设置 TCP_CORK 标志
+// 备注:
+//   置位期间内核只发出满 MSS 的报文段；清除时立即推送积压的不完整报文段
+//   (包括此前以 MSG_MORE 发出、尚未推送的数据)。
+//-----------------------------------------------------------------------------
+void BaseTcpConnection::setCork(bool value)
+{
+    int optVal = value ? 1 : 0;
+    ::setsockopt(getSocket().getHandle(), IPPROTO_TCP, TCP_CORK,
+        (char*)&optVal, sizeof(optVal));
+}
+#endif
+
 //-----------------------------------------------------------------------------
 // 描述: 取得此连接的本地地址
 //-----------------------------------------------------------------------------
@@ -753,6 +863,62 @@ int BaseTcpConnection::recvBuffer(void *buffer, int size, bool syncMode, int tim
     return result;
 }
 
+#ifdef _COMPILER_LINUX
+//-----------------------------------------------------------------------------
+// 描述: 以聚集方式 (gather) 发送多块数据 (非阻塞)
+// 参数:
+//   flags - 附加的 sendmsg() 标志 (如 MSG_MORE 表示随后还有数据，内核暂不推送
+//           不满 MSS 的报文段)
+// 返回:
+//   < 0    - 未发出任何数据，且发送数据过程发生了错误。
+//   >= 0   - 实际发出的字节数。
+// 备注:
+//   不会抛出异常。使用 MSG_NOSIGNAL，对方已关闭连接时不会引发 SIGPIPE。
+//-----------------------------------------------------------------------------
+int BaseTcpConnection::sendBufferV(const struct iovec *iov, int iovCount, int flags)
+{
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = const_cast<struct iovec*>(iov);
+    msg.msg_iovlen = iovCount;
+
+    int result = (int)::sendmsg(socket_.getHandle(), &msg, MSG_NOSIGNAL | flags);
+    if (result <= 0)
+    {
+        int errorCode = SocketGetLastError();
+        if ((result == 0) || (errorCode != SS_EWOULDBLOCK && errorCode != SS_EINTR))
+            result = -1;   // error
+        else
+            result = 0;
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 以分散方式 (scatter) 接收数据到多块缓存中 (非阻塞)
+// 返回:
+//   < 0    - 未接收到任何数据，且接收数据过程发生了错误 (或对方已关闭连接)。
+//   >= 0   - 实际接收到的字节数。
+// 备注:
+//   不会抛出异常。
+//-----------------------------------------------------------------------------
+int BaseTcpConnection::recvBufferV(struct iovec *iov, int iovCount)
+{
+    int result = (int)::readv(socket_.getHandle(), iov, iovCount);
+    if (result <= 0)
+    {
+        int errorCode = SocketGetLastError();
+        if ((result == 0) || (errorCode != SS_EWOULDBLOCK && errorCode != SS_EINTR))
+            result = -1;   // error
+        else
+            result = 0;
+    }
+
+    return result;
+}
+#endif
+
 //-----------------------------------------------------------------------------
 // 描述: 发送数据
 //   timeoutMSecs - 指定超时时间(毫秒)，若超过指定时间仍未发送完全部数据则退出函数。
@@ -1030,6 +1196,7 @@ void BaseTcpClient::connect(const std::string& ip, int port)
         if (socket.isActive())
         {
             SockAddr addr = InetAddress(stringToIp(ip), static_cast<WORD>(port)).getSockAddr();
+            applySocketTuning(socket.getHandle(), socketTuning_, false);
 
             bool oldBlockMode = socket.isBlockMode();
             socket.setBlockMode(true);
@@ -1059,6 +1226,23 @@ void BaseTcpClient::connect(const std::string& ip, int port)
 //   不抛异常。
 //-----------------------------------------------------------------------------
 int BaseTcpClient::asyncConnect(const std::string& ip, int port, int timeoutMSecs)
+{
+    int result = beginAsyncConnect(InetAddress(stringToIp(ip), static_cast<WORD>(port)));
+
+    if (result == ACS_CONNECTING)
+        result = checkAsyncConnectState(timeoutMSecs);
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 发起非阻塞式连接，但不等待连接完成
+// 返回: enum ASYNC_CONNECT_STATE
+// 备注:
+//   返回 ACS_CONNECTING 时，由调用者自行等待套接字可写 (如加入事件循环的监视)，
+//   再以 SO_ERROR 判断连接是否成功。
+//-----------------------------------------------------------------------------
+int BaseTcpClient::beginAsyncConnect(const InetAddress& peerAddr)
 {
     int result = ACS_CONNECTING;
 
@@ -1072,7 +1256,8 @@ int BaseTcpClient::asyncConnect(const std::string& ip, int port, int timeoutMSec
         socket.open();
         if (socket.isActive())
         {
-            SockAddr addr = InetAddress(stringToIp(ip), static_cast<WORD>(port)).getSockAddr();
+            SockAddr addr = peerAddr.getSockAddr();
+            applySocketTuning(socket.getHandle(), socketTuning_, false);
 
             socket.setBlockMode(false);
             int r = ::connect(socket.getHandle(), (struct sockaddr*)&addr, sizeof(addr));
@@ -1093,9 +1278,6 @@ int BaseTcpClient::asyncConnect(const std::string& ip, int port, int timeoutMSec
         result = ACS_FAILED;
     }
 
-    if (result == ACS_CONNECTING)
-        result = checkAsyncConnectState(timeoutMSecs);
-
     return result;
 }
 
@@ -1204,6 +1386,7 @@ TcpSocket& BaseTcpClient::getSocket()
 
 BaseTcpServer::BaseTcpServer() :
     localPort_(0),
+    reusePort_(false),
     listenerThread_(NULL)
 {
     // nothing
@@ -1225,10 +1408,11 @@ void BaseTcpServer::open()
     {
         if (!isActive())
         {
+            // SO_REUSEPORT 方式下监听套接字由事件循环非阻塞地 accept
+            if (reusePort_) socket_.setBlockMode(false);
             socket_.open();
-            socket_.bind(localPort_);
-            if (listen(socket_.getHandle(), LISTEN_QUEUE_SIZE) < 0)
-                ThrowSocketLastError();
+            socket_.bind(localPort_, reusePort_);
+            listenSocket(socket_.getHandle());
             startListenerThread();
         }
     }
@@ -1275,6 +1459,18 @@ void BaseTcpServer::setLocalPort(WORD value)
     }
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 设置是否以 SO_REUSEPORT 方式绑定监听端口 (仅 Linux 有效)
+//-----------------------------------------------------------------------------
+void BaseTcpServer::setReusePort(bool value)
+{
+    if (value != reusePort_)
+    {
+        if (isActive()) close();
+        reusePort_ = value;
+    }
+}
+
 //-----------------------------------------------------------------------------
 // 描述: 设置“创建新连接”的回调
 //-----------------------------------------------------------------------------
@@ -1317,6 +1513,76 @@ void BaseTcpServer::stopListenerThread()
     }
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 以 SO_REUSEPORT 方式另外打开一个监听同一端口的非阻塞套接字
+// 返回: 套接字句柄 (由调用者负责关闭)
+//-----------------------------------------------------------------------------
+SOCKET BaseTcpServer::openExtraListener()
+{
+    TcpSocket socket;
+    socket.setBlockMode(false);
+    socket.open();
+
+    try
+    {
+        socket.bind(localPort_, true);
+        listenSocket(socket.getHandle());
+    }
+    catch (SocketException&)
+    {
+        socket.close();
+        throw;
+    }
+
+    // 句柄的所有权转交给调用者
+    SOCKET handle = socket.getHandle();
+    socket.handle_ = INVALID_SOCKET;
+    socket.isActive_ = false;
+    return handle;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 应用调优参数并开始监听 (若失败则抛出异常)
+// 备注:
+//   调优参数设置失败不影响监听，仅记录警告。
+//-----------------------------------------------------------------------------
+void BaseTcpServer::listenSocket(SOCKET handle)
+{
+    std::string failedOptions;
+    if (!applySocketTuning(handle, socketTuning_, true, &failedOptions))
+        WARN_LOG(SEM_SOCKET_TUNING_FAILED, failedOptions.c_str(), localPort_);
+
+    int backlog = (socketTuning_.listenBacklog > 0 ? socketTuning_.listenBacklog : LISTEN_QUEUE_SIZE);
+    if (listen(handle, backlog) < 0)
+        ThrowSocketLastError();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得监听套接字上调优参数的实际生效值 (每行一项)
+// 备注:
+//   Linux 下 listen() 的队列长度受 net.core.somaxconn 限制，报告两者中的较小值。
+//-----------------------------------------------------------------------------
+std::string BaseTcpServer::getSocketTuningReport() const
+{
+    if (!isActive()) return "";
+
+    int backlog = (socketTuning_.listenBacklog > 0 ? socketTuning_.listenBacklog : LISTEN_QUEUE_SIZE);
+
+#ifdef _COMPILER_LINUX
+    FILE *file = fopen("/proc/sys/net/core/somaxconn", "r");
+    if (file != NULL)
+    {
+        int maxConn = 0;
+        if (fscanf(file, "%d", &maxConn) == 1 && maxConn > 0)
+            backlog = min(backlog, maxConn);
+        fclose(file);
+    }
+#endif
+
+    return ::getSocketTuningReport(socket_.getHandle(), true) +
+        formatString("listen_backlog: %d\n", backlog);
+}
+
 //-----------------------------------------------------------------------------
 // 描述: 创建连接对象
 //-----------------------------------------------------------------------------
@@ -1324,6 +1590,8 @@ BaseTcpConnection* BaseTcpServer::createConnection(SOCKET socketHandle)
 {
     BaseTcpConnection *result = NULL;
 
+    applySocketTuning(socketHandle, socketTuning_, false);
+
     if (onCreateConn_)
         onCreateConn_(this, socketHandle, result);
 
@@ -0,0 +1,276 @@
+///////////////////////////////////////////////////////////////////////////////
+// 文件名称: ByteSearch.cpp
+// 功能描述: 字节查找 (SSE2/AVX2 加速)
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ByteSearch.h"
+
+#if defined(_COMPILER_LINUX) && (defined(__x86_64__) || defined(__SSE2__))
+#define _BYTE_SEARCH_X86
+#include <immintrin.h>
+#define AVX2_FUNC  __attribute__((target("avx2")))
+#endif
+
+#if defined(_COMPILER_WIN) && (defined(_M_X64) || defined(_M_IX86))
+#define _BYTE_SEARCH_X86
+#include <immintrin.h>
+#include <intrin.h>
+#define AVX2_FUNC
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
+typedef const char* (*FindLineDelimiterFunc)(const char *data, int bytes);
+typedef const char* (*FindByteFunc)(const char *data, int bytes, char value);
+
+//-----------------------------------------------------------------------------
+// 逐字节实现 (亦用于处理向量实现末尾不足一个向量的部分)
+
+static const char* findLineDelimiterScalar(const char *data, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+    {
+        if (data[i] == '\r' || data[i] == '\n')
+            return data + i;
+    }
+    return NULL;
+}
+
+static const char* findByteScalar(const char *data, int bytes, char value)
+{
+    for (int i = 0; i < bytes; ++i)
+    {
+        if (data[i] == value)
+            return data + i;
+    }
+    return NULL;
+}
+
+#ifdef _BYTE_SEARCH_X86
+
+//-----------------------------------------------------------------------------
+// 描述: 取得掩码中最低的置位
+//-----------------------------------------------------------------------------
+static inline int lowestSetBit(UINT mask)
+{
+#ifdef _COMPILER_WIN
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// SSE2 实现
+
+static const char* findLineDelimiterSse2(const char *data, int bytes)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    int i = 0;
+
+    for (; i + 16 <= bytes; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        UINT mask = (UINT)_mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+        if (mask != 0)
+            return data + i + lowestSetBit(mask);
+    }
+
+    return findLineDelimiterScalar(data + i, bytes - i);
+}
+
+static const char* findByteSse2(const char *data, int bytes, char value)
+{
+    const __m128i target = _mm_set1_epi8(value);
+    int i = 0;
+
+    for (; i + 16 <= bytes; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        UINT mask = (UINT)_mm_movemask_epi8(_mm_cmpeq_epi8(v, target));
+        if (mask != 0)
+            return data + i + lowestSetBit(mask);
+    }
+
+    return findByteScalar(data + i, bytes - i, value);
+}
+
+//-----------------------------------------------------------------------------
+// AVX2 实现 (不足 32 字节的部分交给 SSE2 实现)
+
+AVX2_FUNC static const char* findLineDelimiterAvx2(const char *data, int bytes)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    int i = 0;
+
+    for (; i + 32 <= bytes; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        UINT mask = (UINT)_mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+        if (mask != 0)
+            return data + i + lowestSetBit(mask);
+    }
+
+    return findLineDelimiterSse2(data + i, bytes - i);
+}
+
+AVX2_FUNC static const char* findByteAvx2(const char *data, int bytes, char value)
+{
+    const __m256i target = _mm256_set1_epi8(value);
+    int i = 0;
+
+    for (; i + 32 <= bytes; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        UINT mask = (UINT)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, target));
+        if (mask != 0)
+            return data + i + lowestSetBit(mask);
+    }
+
+    return findByteSse2(data + i, bytes - i, value);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 检测 CPU (及操作系统) 是否支持 AVX2
+//-----------------------------------------------------------------------------
+static bool isAvx2Supported()
+{
+#ifdef _COMPILER_WIN
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // OSXSAVE + AVX，且操作系统已启用 YMM 状态的保存
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+        return false;
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif  /* ifdef _BYTE_SEARCH_X86 */
+
+//-----------------------------------------------------------------------------
+// 描述: 检测 CPU 支持的实现 (只检测一次)
+//-----------------------------------------------------------------------------
+static BYTE_SEARCH_LEVEL detectByteSearchLevel()
+{
+#ifdef _BYTE_SEARCH_X86
+    return isAvx2Supported() ? BSL_AVX2 : BSL_SSE2;
+#else
+    return BSL_SCALAR;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+BYTE_SEARCH_LEVEL getByteSearchLevel()
+{
+    static const BYTE_SEARCH_LEVEL level = detectByteSearchLevel();
+    return level;
+}
+
+//-----------------------------------------------------------------------------
+
+const char* getByteSearchLevelName(BYTE_SEARCH_LEVEL level)
+{
+    switch (level)
+    {
+    case BSL_SSE2:  return "sse2";
+    case BSL_AVX2:  return "avx2";
+    default:        return "scalar";
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+static BYTE_SEARCH_LEVEL clampByteSearchLevel(BYTE_SEARCH_LEVEL level)
+{
+    BYTE_SEARCH_LEVEL supported = getByteSearchLevel();
+    return (level < supported ? level : supported);
+}
+
+//-----------------------------------------------------------------------------
+
+static FindLineDelimiterFunc selectFindLineDelimiter(BYTE_SEARCH_LEVEL level)
+{
+#ifdef _BYTE_SEARCH_X86
+    switch (level)
+    {
+    case BSL_AVX2:  return &findLineDelimiterAvx2;
+    case BSL_SSE2:  return &findLineDelimiterSse2;
+    default:        break;
+    }
+#endif
+    return &findLineDelimiterScalar;
+}
+
+static FindByteFunc selectFindByte(BYTE_SEARCH_LEVEL level)
+{
+#ifdef _BYTE_SEARCH_X86
+    switch (level)
+    {
+    case BSL_AVX2:  return &findByteAvx2;
+    case BSL_SSE2:  return &findByteSse2;
+    default:        break;
+    }
+#endif
+    return &findByteScalar;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 查找第一个 '\r' 或 '\n'
+// 备注: 短数据 (如 HTTP 头部中的短行) 直接逐字节查找，省去向量寄存器的准备开销。
+//-----------------------------------------------------------------------------
+const char* findLineDelimiter(const char *data, int bytes)
+{
+    const int MIN_VECTOR_BYTES = 16;
+    static const FindLineDelimiterFunc func = selectFindLineDelimiter(getByteSearchLevel());
+
+    if (bytes < MIN_VECTOR_BYTES)
+        return findLineDelimiterScalar(data, bytes);
+    return func(data, bytes);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 查找第一个等于 value 的字节
+//-----------------------------------------------------------------------------
+const char* findByte(const char *data, int bytes, char value)
+{
+    const int MIN_VECTOR_BYTES = 16;
+    static const FindByteFunc func = selectFindByte(getByteSearchLevel());
+
+    if (bytes < MIN_VECTOR_BYTES)
+        return findByteScalar(data, bytes, value);
+    return func(data, bytes, value);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 以指定的实现查找第一个 '\r' 或 '\n'
+// 备注: 不做短数据的特殊处理，以便单独衡量各实现。
+//-----------------------------------------------------------------------------
+const char* findLineDelimiterByLevel(BYTE_SEARCH_LEVEL level, const char *data, int bytes)
+{
+    return selectFindLineDelimiter(clampByteSearchLevel(level))(data, bytes);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 以指定的实现查找第一个等于 value 的字节
+//-----------------------------------------------------------------------------
+const char* findByteByLevel(BYTE_SEARCH_LEVEL level, const char *data, int bytes, char value)
+{
+    return selectFindByte(clampByteSearchLevel(level))(data, bytes, value);
+}
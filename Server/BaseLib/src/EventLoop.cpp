@@ -13,7 +13,8 @@
 EventLoop::EventLoop() :
     thread_(NULL),
     loopThreadId_(0),
-    lastCheckTimeoutTicks_(0)
+    isWaiting_(false),
+    placementIndex_(0)
 {
     // nothing
 }
@@ -35,6 +36,15 @@ void EventLoop::start()
     }
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 设置事件循环线程的 CPU 绑定 (须在 start() 之前调用)
+//-----------------------------------------------------------------------------
+void EventLoop::setPlacement(const ThreadPlacement& placement, int index)
+{
+    placement_ = placement;
+    placementIndex_ = index;
+}
+
 //-----------------------------------------------------------------------------
 // 描述: 停止工作线程
 //-----------------------------------------------------------------------------
@@ -102,16 +112,18 @@ void EventLoop::executeInLoop(const Functor& functor)
 //-----------------------------------------------------------------------------
 // 描述: 将指定的仿函数委托给事件循环线程执行。线程在完成当前一轮事件循环后再
 //       执行被委托的仿函数。
-// 备注: 线程安全
+// 备注:
+//   线程安全，且不加锁。仅当事件循环正在 (或即将) 阻塞等待时才唤醒它；否则事件
+//   循环在本轮结束时自然会执行被委托的仿函数。
 //-----------------------------------------------------------------------------
 void EventLoop::delegateToLoop(const Functor& functor)
 {
-    {
-        AutoLocker locker(delegatedFunctors_.mutex);
-        delegatedFunctors_.items.push_back(functor);
-    }
+    delegatedFunctors_.push(functor);
 
-    wakeupLoop();
+    // 注: 与 calcLoopWaitTimeout() 中先置 isWaiting_ 再检查队列的顺序相对应，
+    // 两者均为 seq_cst，保证不会出现双方都认为对方会处理的情况。
+    if (isWaiting_.load(std::memory_order_seq_cst))
+        wakeupLoop();
 }
 
 //-----------------------------------------------------------------------------
@@ -191,16 +203,23 @@ void EventLoop::runLoop(Thread *thread)
 //-----------------------------------------------------------------------------
 void EventLoop::executeDelegatedFunctors()
 {
+    // 先批量取出，再逐个执行，执行期间新委托的仿函数留待下一轮
     Functors functors;
-    {
-        AutoLocker locker(delegatedFunctors_.mutex);
-        functors.swap(delegatedFunctors_.items);
-    }
+    delegatedFunctors_.popAll(functors);
 
     for (size_t i = 0; i < functors.size(); ++i)
         functors[i]();
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 是否有待执行的清理器
+//-----------------------------------------------------------------------------
+bool EventLoop::hasFinalizers()
+{
+    AutoLocker locker(finalizers_.mutex);
+    return !finalizers_.items.empty();
+}
+
 //-----------------------------------------------------------------------------
 // 描述: 执行所有清理器
 //-----------------------------------------------------------------------------
@@ -218,13 +237,22 @@ void EventLoop::executeFinalizer()
 
 //-----------------------------------------------------------------------------
 // 描述: 在事件循环进入等待前，计算等待超时时间 (毫秒)
+// 备注:
+//   同时标记事件循环进入等待状态，此后 delegateToLoop() 将唤醒事件循环。
+//   若此时已有被委托的仿函数，或有在上一轮清理器中新添加的清理器 (如批量发送的
+//   自动 flush 之后的发送完成回调)，则不等待。等待结束后须调用 endLoopWait()。
+//   生产者尚未压入完毕的仿函数不计在内: 该生产者压入后会看到 isWaiting_ 并唤醒
+//   事件循环，故无须以零超时空转等待它。
 //-----------------------------------------------------------------------------
 int EventLoop::calcLoopWaitTimeout()
 {
     int result = TIMEOUT_INFINITE;
     Timestamp expiration;
 
-    if (timerQueue_.getNearestExpiration(expiration))
+    isWaiting_.store(true, std::memory_order_seq_cst);
+    if (!delegatedFunctors_.isEmpty() || hasFinalizers())
+        result = 0;
+    else if (timerQueue_.getNearestExpiration(expiration))
     {
         Timestamp now(Timestamp::now());
         if (expiration <= now)
@@ -236,6 +264,14 @@ int EventLoop::calcLoopWaitTimeout()
     return result;
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 事件循环等待完毕 (被唤醒或超时)
+//-----------------------------------------------------------------------------
+void EventLoop::endLoopWait()
+{
+    isWaiting_.store(false, std::memory_order_relaxed);
+}
+
 //-----------------------------------------------------------------------------
 // 描述: 事件循环等待完毕后，处理定时器事件
 //-----------------------------------------------------------------------------
@@ -272,6 +308,11 @@ EventLoopThread::EventLoopThread(EventLoop& eventLoop) :
 void EventLoopThread::execute()
 {
     eventLoop_.loopThreadId_ = getThreadId();
+
+    // 先绑定 CPU，使事件循环此后分配的缓存取自本地 NUMA 节点
+    ThreadPlacementList::instance().apply(eventLoop_.placement_, eventLoop_.placementIndex_,
+        formatString("event_loop_%d", eventLoop_.placementIndex_));
+
     eventLoop_.runLoop(this);
 }
 
@@ -279,6 +320,7 @@ void EventLoopThread::execute()
 
 void EventLoopThread::afterExecute()
 {
+    ThreadPlacementList::instance().remove();
     eventLoop_.loopThreadId_ = 0;
 }
 
@@ -306,7 +348,10 @@ void EventLoopList::start()
         setCount(wantLoopCount_);
 
     for (int i = 0; i < items_.getCount(); i++)
+    {
+        items_[i]->setPlacement(placement_, i);
         items_[i]->start();
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -383,6 +428,7 @@ OsEventLoop::OsEventLoop()
 #endif
 #ifdef _COMPILER_LINUX
     epollObject_ = new EpollObject(this);
+    uringObject_ = NULL;
 #endif
 }
 
@@ -394,6 +440,7 @@ OsEventLoop::~OsEventLoop()
     delete iocpObject_;
 #endif
 #ifdef _COMPILER_LINUX
+    delete uringObject_;
     delete epollObject_;
 #endif
 }
@@ -407,7 +454,10 @@ void OsEventLoop::doLoopWork(Thread *thread)
     iocpObject_->work();
 #endif
 #ifdef _COMPILER_LINUX
-    epollObject_->poll();
+    if (uringObject_)
+        uringObject_->poll();
+    else
+        epollObject_->poll();
 #endif
 }
 
@@ -420,6 +470,9 @@ void OsEventLoop::wakeupLoop()
     iocpObject_->wakeup();
 #endif
 #ifdef _COMPILER_LINUX
-    epollObject_->wakeup();
+    if (uringObject_)
+        uringObject_->wakeup();
+    else
+        epollObject_->wakeup();
 #endif
 }
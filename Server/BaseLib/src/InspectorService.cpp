@@ -204,6 +204,77 @@ void ServerInspector::onHttpSession(const HttpRequest& request, HttpResponse& re
 ///////////////////////////////////////////////////////////////////////////////
 // class PredefinedInspector
 
+std::string PredefinedInspector::getTcpStats(const PropertyList& argList,
+	std::string& contentType)
+{
+    contentType = "text/plain";
+
+    TcpInspectInfo& info = TcpInspectInfo::instance();
+
+    StrList strList;
+    strList.add(formatString("tcp_conn_create_count: %d", (int)info.tcpConnCreateCount.get()));
+    strList.add(formatString("tcp_conn_destroy_count: %d", (int)info.tcpConnDestroyCount.get()));
+    strList.add(formatString("error_occurred_count: %d", (int)info.errorOccurredCount.get()));
+    strList.add(formatString("add_conn_count: %d", (int)info.addConnCount.get()));
+    strList.add(formatString("remove_conn_count: %d", (int)info.removeConnCount.get()));
+    strList.add(formatString("connect_count: %d", (int)info.connectCount.get()));
+    strList.add(formatString("connect_failed_count: %d", (int)info.connectFailedCount.get()));
+    strList.add(formatString("connect_timeout_count: %d", (int)info.connectTimeoutCount.get()));
+    strList.add(formatString("epoll_ctl_count: %d", (int)info.epollCtlCount.get()));
+    strList.add(formatString("epoll_ctl_skipped_count: %d", (int)info.epollCtlSkippedCount.get()));
+    strList.add(formatString("direct_send_count: %d", (int)info.directSendCount.get()));
+    strList.add(formatString("send_syscall_count: %d", (int)info.sendSyscallCount.get()));
+    strList.add(formatString("send_batch_count: %d", (int)info.sendBatchCount.get()));
+    strList.add(formatString("send_batch_task_count: %d", (int)info.sendBatchTaskCount.get()));
+    strList.add(formatString("send_batch_flush_count: %d", (int)info.sendBatchFlushCount.get()));
+    strList.add(formatString("send_file_count: %d", (int)info.sendFileCount.get()));
+    strList.add(formatString("send_file_syscall_count: %d", (int)info.sendFileSyscallCount.get()));
+    strList.add(formatString("send_file_splice_count: %d", (int)info.sendFileSpliceCount.get()));
+    strList.add(formatString("wakeup_count: %d", (int)info.wakeupCount.get()));
+    strList.add(formatString("wakeup_skipped_count: %d", (int)info.wakeupSkippedCount.get()));
+    strList.add(formatString("buffer_block_reuse_count: %d", (int)info.bufferBlockReuseCount.get()));
+    strList.add(formatString("buffer_block_alloc_count: %d", (int)info.bufferBlockAllocCount.get()));
+    strList.add(formatString("send_high_water_count: %d", (int)info.sendHighWaterCount.get()));
+    strList.add(formatString("send_drained_count: %d", (int)info.sendDrainedCount.get()));
+    strList.add(formatString("send_by_id_count: %d", (int)info.sendByIdCount.get()));
+    strList.add(formatString("send_by_id_dropped_count: %d", (int)info.sendByIdDroppedCount.get()));
+    strList.add(formatString("uring_enter_count: %d", (int)info.uringEnterCount.get()));
+    strList.add(formatString("uring_completion_count: %d", (int)info.uringCompletionCount.get()));
+    strList.add(formatString("uring_recv_no_buffer_count: %d", (int)info.uringRecvNoBufferCount.get()));
+    strList.add(formatString("framing_error_count: %d", (int)info.framingErrorCount.get()));
+
+    return strList.getText();
+}
+
+std::string PredefinedInspector::getTcpLoops(const PropertyList& argList,
+	std::string& contentType)
+{
+    contentType = "text/plain";
+    return TcpInspectInfo::instance().getLoopLoadReport();
+}
+
+std::string PredefinedInspector::getThreadPlacement(const PropertyList& argList,
+	std::string& contentType)
+{
+    contentType = "text/plain";
+
+    CpuInfoList topology;
+    getCpuTopology(topology);
+
+    std::set<std::pair<int, int> > cores;
+    std::set<int> nodes;
+    for (size_t i = 0; i < topology.size(); i++)
+    {
+        cores.insert(std::make_pair(topology[i].packageId, topology[i].coreId));
+        nodes.insert(topology[i].nodeId);
+    }
+
+    std::string result = formatString("cpus: %d, physical_cores: %d, numa_nodes: %d\n",
+        (int)topology.size(), (int)cores.size(), (int)nodes.size());
+    result += ThreadPlacementList::instance().getReport();
+    return result;
+}
+
 #ifdef _COMPILER_WIN
 
 ServerInspector::CommandItems PredefinedInspector::getItems() const
@@ -215,6 +286,9 @@ ServerInspector::CommandItems PredefinedInspector::getItems() const
     CommandItems items;
 
     items.push_back(CommandItem(category, "basic_info", PredefinedInspector::getBasicInfo, "show the basic info."));
+    items.push_back(CommandItem("tcp", "stats", PredefinedInspector::getTcpStats, "show the tcp counters."));
+    items.push_back(CommandItem("tcp", "loops", PredefinedInspector::getTcpLoops, "show the load of each event loop."));
+    items.push_back(CommandItem(category, "placement", PredefinedInspector::getThreadPlacement, "show the cpu placement of threads."));
 
     return items;
 }
@@ -256,6 +330,9 @@ ServerInspector::CommandItems PredefinedInspector::getItems() const
     CommandItems items;
 
     items.push_back(CommandItem(category, "basic_info", PredefinedInspector::getBasicInfo, "show the basic info."));
+    items.push_back(CommandItem("tcp", "stats", PredefinedInspector::getTcpStats, "show the tcp counters."));
+    items.push_back(CommandItem("tcp", "loops", PredefinedInspector::getTcpLoops, "show the load of each event loop."));
+    items.push_back(CommandItem(category, "placement", PredefinedInspector::getThreadPlacement, "show the cpu placement of threads."));
     items.push_back(CommandItem(category, "status", PredefinedInspector::getProcStatus, "print /proc/self/status."));
     items.push_back(CommandItem(category, "opened_file_count", PredefinedInspector::getOpenedFileCount, "count /proc/self/fd."));
     items.push_back(CommandItem(category, "thread_count", PredefinedInspector::getThreadCount, "count /proc/self/task."));
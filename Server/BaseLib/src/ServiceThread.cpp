@@ -694,12 +694,105 @@ void ThreadList::waitForAllThreads(int maxWaitSecs, int *killedCount)
         *killedCount = killedThreadCount;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// class ThreadPlacementList
+
+static std::string cpuListToStr(const IntegerArray& cpus)
+{
+    std::string result;
+    for (size_t i = 0; i < cpus.size(); i++)
+        result += (i > 0 ? "," : "") + intToStr(cpus[i]);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 按 placement 将当前线程绑定到 CPU，并登记绑定结果
+// 参数:
+//   index - 线程在所属线程组中的序号 (0-based)
+//   owner - 线程的归属名称
+// 返回: 是否进行了绑定
+// 备注:
+//   必须由被绑定的线程自己调用。numaLocalMemory 为 true 且 CPU 同属一个 NUMA
+//   节点时，线程此后分配的内存 (如事件循环的缓存块) 优先取自该节点。
+//-----------------------------------------------------------------------------
+bool ThreadPlacementList::apply(const ThreadPlacement& placement, int index, const std::string& owner)
+{
+    IntegerArray cpus;
+
+    switch (placement.mode)
+    {
+    case ThreadPlacement::TPM_CPU_LIST:
+        if (!placement.cpuLists.empty())
+            cpus = placement.cpuLists[index % placement.cpuLists.size()];
+        break;
+    case ThreadPlacement::TPM_PHYSICAL_CORE:
+        {
+            IntegerArray coreCpus;
+            getPhysicalCoreCpus(coreCpus);
+            if (!coreCpus.empty())
+                cpus.push_back(coreCpus[index % coreCpus.size()]);
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (cpus.empty()) return false;
+
+    if (!setThreadAffinity(cpus))
+    {
+        ERROR_LOG(SEM_SET_THREAD_AFFINITY_ERROR, owner.c_str(), cpuListToStr(cpus).c_str());
+        return false;
+    }
+
+    Item item;
+    item.owner = owner;
+    item.cpus = cpus;
+    item.nodeId = getCpusNumaNode(cpus);
+    item.memoryBound = (placement.numaLocalMemory && item.nodeId >= 0 &&
+        setThreadPreferredNode(item.nodeId));
+
+    AutoLocker locker(mutex_);
+    items_[getCurThreadId()] = item;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 注销当前线程的绑定记录 (线程退出前调用)
+//-----------------------------------------------------------------------------
+void ThreadPlacementList::remove()
+{
+    AutoLocker locker(mutex_);
+    items_.erase(getCurThreadId());
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得全部已绑定线程的诊断信息 (每行一个线程)
+//-----------------------------------------------------------------------------
+std::string ThreadPlacementList::getReport()
+{
+    std::string result;
+    AutoLocker locker(mutex_);
+
+    for (Items::iterator it = items_.begin(); it != items_.end(); ++it)
+    {
+        const Item& item = it->second;
+
+        result += formatString("%s: tid=%u, cpus=%s, node=%d, numa_local_memory=%s\n",
+            item.owner.c_str(), (UINT)it->first, cpuListToStr(item.cpus).c_str(), item.nodeId,
+            item.memoryBound ? "yes" : "no");
+    }
+
+    return result;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // class ThreadPool
 
 ThreadPool::ThreadPool() :
     condition_(mutex_),
-    isRunning_(false)
+    isRunning_(false),
+    name_("thread_pool")
 {
     // nothing
 }
@@ -720,7 +813,7 @@ void ThreadPool::start(int threadCount)
 
     isRunning_ = true;
     for (int i = 0; i < threadCount; ++i)
-        threadList_.add(Thread::create(std::bind(&ThreadPool::threadProc, this, _1)));
+        threadList_.add(Thread::create(std::bind(&ThreadPool::threadProc, this, _1, i)));
 }
 
 //-----------------------------------------------------------------------------
@@ -739,6 +832,20 @@ void ThreadPool::stop(int maxWaitSecs)
     }
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 设置工作线程的 CPU 绑定
+// 参数:
+//   name - 诊断输出中工作线程的归属名称
+//-----------------------------------------------------------------------------
+void ThreadPool::setPlacement(const ThreadPlacement& value, const std::string& name)
+{
+    AutoLocker locker(mutex_);
+    ASSERT_X(!isRunning_);
+
+    placement_ = value;
+    name_ = name;
+}
+
 //-----------------------------------------------------------------------------
 
 void ThreadPool::addTask(const Task& task)
@@ -770,10 +877,14 @@ bool ThreadPool::takeTask(Task& task)
 
 //-----------------------------------------------------------------------------
 
-void ThreadPool::threadProc(Thread& thread)
+void ThreadPool::threadProc(Thread& thread, int index)
 {
     AutoFinalizer autoFinalizer(std::bind(&ThreadList::remove, &threadList_, &thread));
 
+    AutoFinalizer placementFinalizer(std::bind(&ThreadPlacementList::remove, &ThreadPlacementList::instance()));
+
+    ThreadPlacementList::instance().apply(placement_, index, formatString("%s_%d", name_.c_str(), index));
+
     while (!thread.isTerminated())
     {
         try
@@ -751,6 +751,218 @@ UINT64 getTickDiff(UINT64 oldTicks, UINT64 newTicks)
 		return (UINT64(-1) - oldTicks + newTicks);
 }
 
+#ifdef _COMPILER_LINUX
+//-----------------------------------------------------------------------------
+// 描述: 读取 sysfs 文件的首行
+//-----------------------------------------------------------------------------
+static std::string readSysfsLine(const std::string& fileName)
+{
+	std::string result;
+	FILE *f = fopen(fileName.c_str(), "r");
+	if (f)
+	{
+		char buf[1024];
+		if (fgets(buf, sizeof(buf), f))
+			result = trimString(buf);
+		fclose(f);
+	}
+	return result;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// 描述: 解析 CPU 列表字符串 (如 "0-3,8,10-11")
+//-----------------------------------------------------------------------------
+void parseCpuList(const std::string& str, IntegerArray& cpus)
+{
+	StrList strList;
+	splitString(str, ',', strList, true);
+
+	cpus.clear();
+	for (int i = 0; i < strList.getCount(); i++)
+	{
+		const std::string& item = strList[i];
+		if (item.empty()) continue;
+
+		std::string::size_type pos = item.find('-');
+		int first = strToInt(item.substr(0, pos), -1);
+		int last = (pos == std::string::npos ? first : strToInt(item.substr(pos + 1), -1));
+
+		for (int cpu = first; cpu >= 0 && cpu <= last; cpu++)
+			cpus.push_back(cpu);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得全部在线逻辑 CPU 的拓扑信息
+// 备注: 不支持 NUMA 的系统中全部 CPU 属于节点 0。
+//-----------------------------------------------------------------------------
+void getCpuTopology(CpuInfoList& cpus)
+{
+	cpus.clear();
+
+#ifdef _COMPILER_WIN
+	SYSTEM_INFO sysInfo;
+	::GetSystemInfo(&sysInfo);
+	for (int i = 0; i < (int)sysInfo.dwNumberOfProcessors; i++)
+	{
+		CpuInfo item = { i, i, 0, 0 };
+		cpus.push_back(item);
+	}
+#endif
+#ifdef _COMPILER_LINUX
+	const std::string CPU_PATH = "/sys/devices/system/cpu/";
+	const std::string NODE_PATH = "/sys/devices/system/node/";
+
+	IntegerArray cpuIds;
+	parseCpuList(readSysfsLine(CPU_PATH + "online"), cpuIds);
+	if (cpuIds.empty())
+	{
+		int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+		for (int i = 0; i < count; i++)
+			cpuIds.push_back(i);
+	}
+
+	std::map<int, int> cpuNodes;
+	DIR *dirPtr = opendir(NODE_PATH.c_str());
+	if (dirPtr)
+	{
+		struct dirent *dirEnt;
+		while ((dirEnt = readdir(dirPtr)) != NULL)
+		{
+			int nodeId;
+			if (sscanf(dirEnt->d_name, "node%d", &nodeId) != 1) continue;
+
+			IntegerArray nodeCpus;
+			parseCpuList(readSysfsLine(NODE_PATH + dirEnt->d_name + "/cpulist"), nodeCpus);
+			for (size_t i = 0; i < nodeCpus.size(); i++)
+				cpuNodes[nodeCpus[i]] = nodeId;
+		}
+		closedir(dirPtr);
+	}
+
+	for (size_t i = 0; i < cpuIds.size(); i++)
+	{
+		std::string topoPath = formatString("%scpu%d/topology/", CPU_PATH.c_str(), cpuIds[i]);
+
+		CpuInfo item;
+		item.cpuId = cpuIds[i];
+		item.coreId = strToInt(readSysfsLine(topoPath + "core_id"), item.cpuId);
+		item.packageId = strToInt(readSysfsLine(topoPath + "physical_package_id"), 0);
+		item.nodeId = (cpuNodes.count(item.cpuId) ? cpuNodes[item.cpuId] : 0);
+		cpus.push_back(item);
+	}
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 每个物理核取一个逻辑 CPU，各 NUMA 节点交替排列
+// 备注: 依次分派的线程因此均匀分布到各节点上。
+//-----------------------------------------------------------------------------
+void getPhysicalCoreCpus(IntegerArray& cpus)
+{
+	CpuInfoList topology;
+	getCpuTopology(topology);
+
+	std::set<std::pair<int, int> > seenCores;
+	std::map<int, IntegerArray> nodeCpus;
+	for (size_t i = 0; i < topology.size(); i++)
+	{
+		const CpuInfo& item = topology[i];
+		if (seenCores.insert(std::make_pair(item.packageId, item.coreId)).second)
+			nodeCpus[item.nodeId].push_back(item.cpuId);
+	}
+
+	cpus.clear();
+	for (size_t round = 0; cpus.size() < seenCores.size(); round++)
+	{
+		for (std::map<int, IntegerArray>::iterator it = nodeCpus.begin(); it != nodeCpus.end(); ++it)
+		{
+			if (round < it->second.size())
+				cpus.push_back(it->second[round]);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得一组逻辑 CPU 共同所属的 NUMA 节点 (不确定时返回 -1)
+//-----------------------------------------------------------------------------
+int getCpusNumaNode(const IntegerArray& cpus)
+{
+	CpuInfoList topology;
+	getCpuTopology(topology);
+
+	int result = -1;
+	for (size_t i = 0; i < cpus.size(); i++)
+	{
+		int nodeId = -1;
+		for (size_t j = 0; j < topology.size(); j++)
+		{
+			if (topology[j].cpuId == cpus[i])
+			{
+				nodeId = topology[j].nodeId;
+				break;
+			}
+		}
+
+		if (nodeId < 0 || (result >= 0 && nodeId != result))
+			return -1;
+		result = nodeId;
+	}
+
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 将当前线程绑定到指定的逻辑 CPU 上
+//-----------------------------------------------------------------------------
+bool setThreadAffinity(const IntegerArray& cpus)
+{
+	if (cpus.empty()) return false;
+
+#ifdef _COMPILER_WIN
+	DWORD_PTR mask = 0;
+	for (size_t i = 0; i < cpus.size(); i++)
+	{
+		if (cpus[i] >= 0 && cpus[i] < (int)(sizeof(mask) * 8))
+			mask |= ((DWORD_PTR)1 << cpus[i]);
+	}
+	return (mask != 0 && ::SetThreadAffinityMask(::GetCurrentThread(), mask) != 0);
+#endif
+#ifdef _COMPILER_LINUX
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	for (size_t i = 0; i < cpus.size(); i++)
+	{
+		if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE)
+			CPU_SET(cpus[i], &cpuSet);
+	}
+	return (CPU_COUNT(&cpuSet) > 0 && sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 使当前线程此后分配的内存优先取自指定的 NUMA 节点
+// 备注:
+//   Linux 下以 set_mempolicy(MPOL_PREFERRED) 实现 (不依赖 libnuma)，节点内存不足时
+//   仍可从其它节点分配。Windows 下不支持，返回 false。
+//-----------------------------------------------------------------------------
+bool setThreadPreferredNode(int nodeId)
+{
+#ifdef _COMPILER_WIN
+	return false;
+#endif
+#ifdef _COMPILER_LINUX
+	const int MPOL_PREFERRED_MODE = 1;   // 同 <numaif.h> 中的 MPOL_PREFERRED
+	const int MASK_BITS = sizeof(unsigned long) * 8;
+
+	if (nodeId < 0 || nodeId >= MASK_BITS) return false;
+
+	unsigned long nodeMask = (1UL << nodeId);
+	return (syscall(SYS_set_mempolicy, MPOL_PREFERRED_MODE, &nodeMask, MASK_BITS + 1) == 0);
+#endif
+}
+
 //-----------------------------------------------------------------------------
 // 描述: 随机化 "随机数种子"
 //-----------------------------------------------------------------------------
@@ -7,6 +7,38 @@
 #include "ErrMsgs.h"
 #include "LogManager.h"
 #include "UtilClass.h"
+#include "ByteSearch.h"
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef _COMPILER_LINUX
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// 描述: 取得单调递增的微秒计数 (用于统计事件循环的处理耗时)
+//-----------------------------------------------------------------------------
+static INT64 getMicroTicks()
+{
+    return (INT64)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得单调递增的毫秒计数 (驱动各连接的时间轮)
+// 备注: 不受系统时间调整的影响，也不会像 32 位的 GetTickCount() 那样回绕。
+//-----------------------------------------------------------------------------
+static UINT64 getMonoTicks()
+{
+#ifdef _COMPILER_WIN
+    return (UINT64)::GetTickCount64();
+#else
+    return (UINT64)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // 预定义分包器
@@ -20,24 +52,17 @@ void linePacketSplitter(const char *data, int bytes, int& retrieveBytes)
 {
     retrieveBytes = 0;
 
-    const char *p = data;
-    int i = 0;
-    while (i < bytes)
+    const char *p = findLineDelimiter(data, bytes);
+    if (p != NULL)
     {
-        if (*p == '\r' || *p == '\n')
+        int i = (int)(p - data);
+        retrieveBytes = i + 1;
+        if (i < bytes - 1)
         {
-            retrieveBytes = i + 1;
-            if (i < bytes - 1)
-            {
-                char next = *(p+1);
-                if ((next == '\r' || next == '\n') && next != *p)
-                    ++retrieveBytes;
-            }
-            break;
+            char next = *(p+1);
+            if ((next == '\r' || next == '\n') && next != *p)
+                ++retrieveBytes;
         }
-
-        ++p;
-        ++i;
     }
 }
 
@@ -47,38 +72,184 @@ void nullTerminatedPacketSplitter(const char *data, int bytes, int& retrieveByte
 {
     const char DELIMITER = '\0';
 
-    retrieveBytes = 0;
-    for (int i = 0; i < bytes; ++i)
+    const char *p = findByte(data, bytes, DELIMITER);
+    retrieveBytes = (p != NULL ? (int)(p - data) + 1 : 0);
+}
+
+//-----------------------------------------------------------------------------
+
+void anyPacketSplitter(const char *data, int bytes, int& retrieveBytes)
+{
+    retrieveBytes = (bytes > 0 ? bytes : 0);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: linePacketSplitter 的可续扫描版本
+// 备注: 分界规则与 linePacketSplitter 完全相同，只是从 state.scanOffset 处开始查找。
+//-----------------------------------------------------------------------------
+void resumableLinePacketSplitter(const char *data, int bytes, SplitterState& state, int& retrieveBytes)
+{
+    int offset = min(state.scanOffset, bytes);
+    linePacketSplitter(data + offset, bytes - offset, retrieveBytes);
+
+    if (retrieveBytes > 0)
+        retrieveBytes += offset;
+    else
+        state.scanOffset = bytes;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: nullTerminatedPacketSplitter 的可续扫描版本
+//-----------------------------------------------------------------------------
+void resumableNullTerminatedPacketSplitter(const char *data, int bytes, SplitterState& state, int& retrieveBytes)
+{
+    int offset = min(state.scanOffset, bytes);
+    nullTerminatedPacketSplitter(data + offset, bytes - offset, retrieveBytes);
+
+    if (retrieveBytes > 0)
+        retrieveBytes += offset;
+    else
+        state.scanOffset = bytes;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得预定义分包器对应的可续扫描版本
+// 返回:
+//   packetSplitter 不是可续扫描的预定义分包器时返回空对象。
+//-----------------------------------------------------------------------------
+ResumablePacketSplitter getResumablePacketSplitter(const PacketSplitter& packetSplitter)
+{
+    const PacketSplitterFunc *func = packetSplitter.target<PacketSplitterFunc>();
+    if (func != NULL)
+    {
+        if (*func == &linePacketSplitter)
+            return RESUMABLE_LINE_PACKET_SPLITTER;
+        if (*func == &nullTerminatedPacketSplitter)
+            return RESUMABLE_NULL_TERMINATED_PACKET_SPLITTER;
+    }
+
+    return ResumablePacketSplitter();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class IoBufferPool
+
+IoBufferPool::IoBufferPool() :
+    freeLists_(getSizeClass(MAX_POOLED_BLOCK_SIZE) + 1),
+    cachedBytes_(0)
+{
+    // nothing
+}
+
+IoBufferPool::~IoBufferPool()
+{
+    clear();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 申请一个至少 minSize 字节的存储块，实际大小由 blockSize 返回
+//-----------------------------------------------------------------------------
+char* IoBufferPool::allocate(int minSize, int& blockSize)
+{
+    blockSize = getBlockSize(minSize);
+
+    if (blockSize <= MAX_POOLED_BLOCK_SIZE)
     {
-        if (data[i] == DELIMITER)
+        FreeList& freeList = freeLists_[getSizeClass(blockSize)];
+        if (!freeList.empty())
         {
-            retrieveBytes = i + 1;
-            break;
+            char *block = freeList.back();
+            freeList.pop_back();
+            cachedBytes_ -= blockSize;
+            TcpInspectInfo::instance().bufferBlockReuseCount.increment();
+            return block;
         }
     }
+
+    TcpInspectInfo::instance().bufferBlockAllocCount.increment();
+    return new char[blockSize];
 }
 
 //-----------------------------------------------------------------------------
+// 描述: 归还存储块
+// 备注: 若该级空闲块已超出缓存上限，则直接释放。
+//-----------------------------------------------------------------------------
+void IoBufferPool::release(char *block, int blockSize)
+{
+    if (!block) return;
 
-void anyPacketSplitter(const char *data, int bytes, int& retrieveBytes)
+    if (blockSize <= MAX_POOLED_BLOCK_SIZE)
+    {
+        FreeList& freeList = freeLists_[getSizeClass(blockSize)];
+        if ((int)(freeList.size() + 1) * blockSize <= MAX_CACHED_BYTES_PER_CLASS)
+        {
+            freeList.push_back(block);
+            cachedBytes_ += blockSize;
+            return;
+        }
+    }
+
+    delete[] block;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 释放全部空闲块
+//-----------------------------------------------------------------------------
+void IoBufferPool::clear()
 {
-    retrieveBytes = (bytes > 0 ? bytes : 0);
+    for (size_t i = 0; i < freeLists_.size(); i++)
+    {
+        FreeList& freeList = freeLists_[i];
+        for (size_t j = 0; j < freeList.size(); j++)
+            delete[] freeList[j];
+        freeList.clear();
+    }
+
+    cachedBytes_ = 0;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 返回容纳 minSize 字节所需的块大小
+// 备注: 入池的块按 2 的幂取整，超出入池上限的块则按原大小分配。
+//-----------------------------------------------------------------------------
+int IoBufferPool::getBlockSize(int minSize)
+{
+    if (minSize > MAX_POOLED_BLOCK_SIZE)
+        return minSize;
+
+    int blockSize = MIN_BLOCK_SIZE;
+    while (blockSize < minSize)
+        blockSize <<= 1;
+    return blockSize;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 返回块大小对应的级别 (blockSize 须为 getBlockSize() 的返回值)
+//-----------------------------------------------------------------------------
+int IoBufferPool::getSizeClass(int blockSize)
+{
+    int sizeClass = 0;
+    while ((MIN_BLOCK_SIZE << sizeClass) < blockSize)
+        sizeClass++;
+    return sizeClass;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // class IoBuffer
 
 IoBuffer::IoBuffer() :
-    buffer_(INITIAL_SIZE),
+    buffer_(NULL),
+    capacity_(0),
     readerIndex_(0),
-    writerIndex_(0)
+    writerIndex_(0),
+    pool_(NULL)
 {
     // nothing
 }
 
 IoBuffer::~IoBuffer()
 {
-    // nothing
+    releaseStorage();
 }
 
 //-----------------------------------------------------------------------------
@@ -113,14 +284,17 @@ void IoBuffer::append(int bytes)
 {
     if (bytes > 0)
     {
-        std::string str;
-        str.resize(bytes, 0);
-        append(str);
+        if (getWritableBytes() < bytes)
+            makeSpace(bytes);
+
+        memset(getWriterPtr(), 0, bytes);
+        writerIndex_ += bytes;
     }
 }
 
 //-----------------------------------------------------------------------------
 // 描述: 从缓存读取 bytes 个字节数据
+// 备注: 可读数据被取尽后，存储块即归还。
 //-----------------------------------------------------------------------------
 void IoBuffer::retrieve(int bytes)
 {
@@ -128,6 +302,7 @@ void IoBuffer::retrieve(int bytes)
     {
         ASSERT_X(bytes <= getReadableBytes());
         readerIndex_ += bytes;
+        shrinkIfIdle();
     }
 }
 
@@ -149,27 +324,102 @@ void IoBuffer::retrieveAll(std::string& str)
 //-----------------------------------------------------------------------------
 void IoBuffer::retrieveAll()
 {
-    readerIndex_ = 0;
-    writerIndex_ = 0;
+    releaseStorage();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 保证缓存中至少有 bytes 个字节的可写空间
+//-----------------------------------------------------------------------------
+void IoBuffer::reserveWritable(int bytes)
+{
+    if (getWritableBytes() < bytes)
+        makeSpace(bytes);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 在 getWritePtr() 处直接写入数据后，提交写入的字节数
+//-----------------------------------------------------------------------------
+void IoBuffer::commitWrite(int bytes)
+{
+    if (bytes > 0)
+    {
+        ASSERT_X(bytes <= getWritableBytes());
+        writerIndex_ += bytes;
+    }
 }
 
 //-----------------------------------------------------------------------------
 
 void IoBuffer::swap(IoBuffer& rhs)
 {
-    buffer_.swap(rhs.buffer_);
+    std::swap(buffer_, rhs.buffer_);
+    std::swap(capacity_, rhs.capacity_);
     std::swap(readerIndex_, rhs.readerIndex_);
     std::swap(writerIndex_, rhs.writerIndex_);
+    std::swap(pool_, rhs.pool_);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 指定存储块所属的块池 (NULL 表示直接向系统申请)
+// 备注:
+//   若缓存中尚有数据，则将其迁移到从新块池中申请的存储块中，原存储块归还给
+//   原块池。此函数须在原块池与新块池所属的事件循环线程中调用。
+//-----------------------------------------------------------------------------
+void IoBuffer::setPool(IoBufferPool *pool)
+{
+    if (pool == pool_) return;
+
+    int readableBytes = getReadableBytes();
+    if (readableBytes == 0)
+    {
+        releaseStorage();
+        pool_ = pool;
+        return;
+    }
+
+    int blockSize = 0;
+    char *block = allocateBlock(pool, readableBytes, blockSize);
+    memcpy(block, peek(), readableBytes);
+    releaseBlock(pool_, buffer_, capacity_);
+
+    buffer_ = block;
+    capacity_ = blockSize;
+    readerIndex_ = 0;
+    writerIndex_ = readableBytes;
+    pool_ = pool;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 若缓存中已无可读数据，则归还存储块
+//-----------------------------------------------------------------------------
+void IoBuffer::shrinkIfIdle()
+{
+    if (buffer_ && getReadableBytes() == 0)
+        releaseStorage();
 }
 
 //-----------------------------------------------------------------------------
 // 描述: 扩展缓存空间以便可再写进 moreBytes 个字节
+// 备注: 空间不足时换用一个至少大一倍的存储块，以保证多次追加的总开销为线性。
 //-----------------------------------------------------------------------------
 void IoBuffer::makeSpace(int moreBytes)
 {
-    if (getWritableBytes() + getUselessBytes() < moreBytes)
+    if (!buffer_ || getWritableBytes() + getUselessBytes() < moreBytes)
     {
-        buffer_.resize(writerIndex_ + moreBytes);
+        int readableBytes = getReadableBytes();
+        int minSize = max(readableBytes + moreBytes, capacity_ * 2);
+        minSize = max(minSize, (int)INITIAL_SIZE);
+
+        int blockSize = 0;
+        char *block = allocateBlock(pool_, minSize, blockSize);
+        if (readableBytes > 0)
+            memcpy(block, peek(), readableBytes);
+        releaseBlock(pool_, buffer_, capacity_);
+
+        buffer_ = block;
+        capacity_ = blockSize;
+        readerIndex_ = 0;
+        writerIndex_ = readableBytes;
     }
     else
     {
@@ -184,189 +434,736 @@ void IoBuffer::makeSpace(int moreBytes)
     }
 }
 
-///////////////////////////////////////////////////////////////////////////////
-// class TcpEventLoop
-
-TcpEventLoop::TcpEventLoop()
+//-----------------------------------------------------------------------------
+// 描述: 丢弃全部数据并归还存储块
+//-----------------------------------------------------------------------------
+void IoBuffer::releaseStorage()
 {
-	executeEvery(5000, std::bind(&TcpEventLoop::checkTimeout, this));
+    releaseBlock(pool_, buffer_, capacity_);
+    buffer_ = NULL;
+    capacity_ = 0;
+    readerIndex_ = 0;
+    writerIndex_ = 0;
 }
 
-TcpEventLoop::~TcpEventLoop()
+//-----------------------------------------------------------------------------
+
+char* IoBuffer::allocateBlock(IoBufferPool *pool, int minSize, int& blockSize)
 {
-    tcpConnMap_.clear();
+    if (pool)
+        return pool->allocate(minSize, blockSize);
+
+    blockSize = IoBufferPool::getBlockSize(minSize);
+    TcpInspectInfo::instance().bufferBlockAllocCount.increment();
+    return new char[blockSize];
 }
 
 //-----------------------------------------------------------------------------
-// 描述: 将指定连接注册到此 eventLoop 中
-//-----------------------------------------------------------------------------
-void TcpEventLoop::addConnection(TcpConnection *connection, TcpCallbacks* _callback)
-{
-    TcpInspectInfo::instance().addConnCount.increment();
-
-    TcpConnectionPtr connPtr(connection);
-    tcpConnMap_[connection->getConnectionName()] = connPtr;
 
-    registerConnection(connection);
+void IoBuffer::releaseBlock(IoBufferPool *pool, char *block, int blockSize)
+{
+    if (!block) return;
 
-	if (_callback)
-	{
-		delegateToLoop(std::bind(&TcpCallbacks::onTcpConnected, _callback, connPtr));
-	}
+    if (pool)
+        pool->release(block, blockSize);
+    else
+        delete[] block;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// class SendQueue
+
 //-----------------------------------------------------------------------------
-// 描述: 将指定连接从此 eventLoop 中注销
+// 描述: 向队列追加数据
 //-----------------------------------------------------------------------------
-void TcpEventLoop::removeConnection(TcpConnection *connection)
+void SendQueue::append(const void *data, int bytes)
 {
-    TcpInspectInfo::instance().removeConnCount.increment();
+    if (!data || bytes <= 0) return;
 
-    unregisterConnection(connection);
+    // 末尾段尚有预留空间，直接合并 (不会引起重新分配)
+    if (!segments_.empty() && !segments_.back().isShared())
+    {
+        std::string& tail = segments_.back().data;
+        if (tail.size() + bytes <= tail.capacity())
+        {
+            tail.append((const char*)data, bytes);
+            bytes_ += bytes;
+            return;
+        }
+    }
 
-    // 此处 shared_ptr 计数递减，有可能会销毁 TcpConnection 对象
-    tcpConnMap_.erase(connection->getConnectionName());
+    segments_.push_back(Segment());
+    std::string& segData = segments_.back().data;
+    if (bytes < COALESCE_SIZE)
+        segData.reserve(COALESCE_SIZE);
+    segData.assign((const char*)data, bytes);
+    bytes_ += bytes;
 }
 
 //-----------------------------------------------------------------------------
-// 描述: 清除全部连接
-// 备注:
-//   conn->shutdown(true, true) 使 IOCP 返回错误，从而释放 IOCP 持有的 shared_ptr。
-//   之后 TcpConnection::errorOccurred() 被调用，进而调用 onTcpDisconnected() 和
-//   TcpConnection::setEventLoop(NULL)。
+// 描述: 向队列追加共享数据 (从 offset 处开始)
 //-----------------------------------------------------------------------------
-void TcpEventLoop::clearConnections()
+void SendQueue::append(const SharedBuffer& buffer, int offset)
 {
-    assertInLoopThread();
+    int bytes = buffer.getSize() - offset;
+    if (bytes <= 0) return;
 
-    for (TcpConnectionMap::iterator iter = tcpConnMap_.begin(); iter != tcpConnMap_.end(); ++iter)
+    if (bytes < SHARED_COPY_SIZE)
     {
-        TcpConnectionPtr conn = tcpConnMap_.begin()->second;
-        conn->shutdown(true, true);
+        append(buffer.getData() + offset, bytes);
+        return;
     }
+
+    segments_.push_back(Segment());
+    Segment& segment = segments_.back();
+    segment.shared = buffer;
+    segment.readerIndex = offset;
+    bytes_ += bytes;
 }
 
 //-----------------------------------------------------------------------------
-// 描述: 执行事件循环
-// 注意:
-//   * 只有全部连接被销毁后才可以退出循环，不然未销毁连接将对程序退出过程造成
-//     麻烦。在 Linux 下典型的错误信息是:
-//     'pure virtual method called terminate called without an active exception'.
+// 描述: 从队列头部移除 bytes 个已发送的字节
 //-----------------------------------------------------------------------------
-void TcpEventLoop::runLoop(Thread *thread)
+void SendQueue::retrieve(int bytes)
 {
-    bool isTerminated = false;
-    while (!isTerminated || !tcpConnMap_.empty())
+    ASSERT_X(bytes <= bytes_);
+
+    while (bytes > 0 && !segments_.empty())
     {
-        try
+        Segment& segment = segments_.front();
+        int segBytes = segment.getReadableBytes();
+        if (bytes >= segBytes)
         {
-	        if (thread->isTerminated())
-	        {
-                clearConnections();
-                isTerminated = true;
-                wakeupLoop();
-	        }
-
-            doLoopWork(thread);
-            executeDelegatedFunctors();
-            executeFinalizer();
+            bytes -= segBytes;
+            bytes_ -= segBytes;
+            segments_.pop_front();
         }
-        catch (Exception& e)
+        else
         {
-			ERROR_LOG(e.makeLogStr().c_str());
+            segment.readerIndex += bytes;
+            bytes_ -= bytes;
+            bytes = 0;
         }
-        catch (...)
-        {}
     }
 }
 
 //-----------------------------------------------------------------------------
-// 描述: 检查每个TCP连接的超时
+// 描述: 清空队列
+//-----------------------------------------------------------------------------
+void SendQueue::clear()
+{
+    segments_.clear();
+    bytes_ = 0;
+}
+
+#ifdef _COMPILER_LINUX
+//-----------------------------------------------------------------------------
+// 描述: 从队列头部开始取出最多 maxCount 段数据的 iovec
+// 参数:
+//   maxBytes - 最多取出的字节数 (-1 表示不限)
+// 返回: 实际填充的 iovec 个数 (totalBytes 返回这些段的总字节数)
 //-----------------------------------------------------------------------------
-void TcpEventLoop::checkTimeout()
+int SendQueue::fillIoVecs(struct iovec *iov, int maxCount, int& totalBytes, int maxBytes) const
 {
-    const UINT CHECK_INTERVAL = 1000;  // ms
+    int count = 0;
+    totalBytes = 0;
 
-    UINT64 curTicks = getCurTicks();
-    if (getTickDiff(lastCheckTimeoutTicks_, curTicks) >= (UINT64)CHECK_INTERVAL)
+    for (Segments::const_iterator iter = segments_.begin();
+        iter != segments_.end() && count < maxCount; ++iter)
     {
-        lastCheckTimeoutTicks_ = curTicks;
+        if (maxBytes >= 0 && totalBytes >= maxBytes)
+            break;
 
-        for (TcpConnectionMap::iterator iter = tcpConnMap_.begin(); iter != tcpConnMap_.end(); ++iter)
-        {
-            TcpConnectionPtr& connPtr = iter->second;
-            connPtr->checkTimeout(curTicks);
-        }
+        const Segment& segment = *iter;
+        int bytes = segment.getReadableBytes();
+        if (maxBytes >= 0)
+            bytes = min(bytes, maxBytes - totalBytes);
+
+        iov[count].iov_base = (void*)(segment.getPtr() + segment.readerIndex);
+        iov[count].iov_len = bytes;
+        totalBytes += bytes;
+        ++count;
     }
-}
 
+    return count;
+}
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
-// class TcpEventLoopList
-
-TcpEventLoopList::TcpEventLoopList(int loopCount) :
-    EventLoopList(loopCount)
-{
-    // nothing
-}
+// class TcpConnectionTable
 
-TcpEventLoopList::~TcpEventLoopList()
+TcpConnectionTable::TcpConnectionTable() :
+    freeHead_(-1),
+    count_(0)
 {
     // nothing
 }
 
 //-----------------------------------------------------------------------------
-// 描述: 将 connection 挂接到 EventLoop 上
-// 参数:
-//   index - EventLoop 的序号 (0-based)，为 -1 表示自动选择。
+// 描述: 将连接放入一个空闲槽，返回连接ID
 //-----------------------------------------------------------------------------
-bool TcpEventLoopList::registerToEventLoop(BaseTcpConnection *connection, int eventLoopIndex)
+TcpConnectionId TcpConnectionTable::add(const TcpConnectionPtr& connection, int loopIndex)
 {
-    TcpEventLoop *eventLoop = NULL;
+    ASSERT_X(loopIndex >= 0 && loopIndex <= MAX_LOOP_INDEX);
 
-    if (eventLoopIndex >= 0 && eventLoopIndex < getCount())
+    int slot;
+    if (freeHead_ >= 0)
     {
-        AutoLocker locker(mutex_);
-        eventLoop = getItem(eventLoopIndex);
+        slot = freeHead_;
+        freeHead_ = slots_[slot].nextFree;
     }
     else
     {
-        static int s_index = 0;
-        AutoLocker locker(mutex_);
-        // round-robin
-        eventLoop = getItem(s_index);
-        s_index = (s_index >= getCount() - 1 ? 0 : s_index + 1);
+        slot = (int)slots_.size();
+        slots_.push_back(Slot());
     }
 
-    bool result = (eventLoop != NULL);
-    if (result)
+    Slot& item = slots_[slot];
+    item.connection = connection;
+    item.nextFree = -1;
+    count_++;
+
+    return makeId(loopIndex, item.generation, (UINT)slot);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 移除连接并释放其所在的槽
+// 备注: 此处 shared_ptr 计数递减，有可能会销毁 TcpConnection 对象。
+//-----------------------------------------------------------------------------
+void TcpConnectionTable::remove(TcpConnectionId connId)
+{
+    UINT slot = getSlot(connId);
+    if (slot >= (UINT)slots_.size()) return;
+
+    Slot& item = slots_[slot];
+    if (!item.connection || item.generation != getGeneration(connId)) return;
+
+    // 代数回绕时跳过 0，保证连接ID不为 0
+    item.generation = (item.generation + 1) & ((1 << GENERATION_BITS) - 1);
+    if (item.generation == 0) item.generation = 1;
+
+    item.nextFree = freeHead_;
+    freeHead_ = (int)slot;
+    count_--;
+
+    TcpConnectionPtr connection;
+    connection.swap(item.connection);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 根据连接ID查找连接 (槽已被复用时返回空)
+//-----------------------------------------------------------------------------
+TcpConnectionPtr TcpConnectionTable::find(TcpConnectionId connId) const
+{
+    UINT slot = getSlot(connId);
+    if (slot < (UINT)slots_.size())
     {
-        // 将 ((TcpConnection*)connection)->setEventLoop(eventLoop) 委托给事件循环线程
-        eventLoop->delegateToLoop(std::bind(
-            &TcpConnection::setEventLoop,
-            static_cast<TcpConnection*>(connection),
-            eventLoop));
+        const Slot& item = slots_[slot];
+        if (item.connection && item.generation == getGeneration(connId))
+            return item.connection;
     }
 
-    return result;
+    return TcpConnectionPtr();
 }
 
 //-----------------------------------------------------------------------------
 
-EventLoop* TcpEventLoopList::createEventLoop()
+void TcpConnectionTable::clear()
 {
-#ifdef _COMPILER_WIN
-    return new WinTcpEventLoop();
-#endif
-#ifdef _COMPILER_LINUX
-    return new LinuxTcpEventLoop();
-#endif
+    Slots slots;
+    slots.swap(slots_);
+    freeHead_ = -1;
+    count_ = 0;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得全部连接
+//-----------------------------------------------------------------------------
+void TcpConnectionTable::getConnections(std::vector<TcpConnectionPtr>& connections) const
+{
+    connections.clear();
+    connections.reserve(count_);
+
+    for (size_t i = 0; i < slots_.size(); i++)
+    {
+        if (slots_[i].connection)
+            connections.push_back(slots_[i].connection);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+TcpConnectionId TcpConnectionTable::makeId(int loopIndex, UINT generation, UINT slot)
+{
+    return ((TcpConnectionId)(loopIndex & MAX_LOOP_INDEX) << 56) |
+        ((TcpConnectionId)(generation & ((1 << GENERATION_BITS) - 1)) << 32) |
+        (TcpConnectionId)slot;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class TcpInspectInfo
+
+void TcpInspectInfo::addLoopList(TcpEventLoopList *loopList)
+{
+    AutoLocker locker(loopListsMutex_);
+    loopLists_.push_back(loopList);
+}
+
+//-----------------------------------------------------------------------------
+
+void TcpInspectInfo::removeLoopList(TcpEventLoopList *loopList)
+{
+    AutoLocker locker(loopListsMutex_);
+    loopLists_.erase(std::remove(loopLists_.begin(), loopLists_.end(), loopList), loopLists_.end());
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得全部事件循环的负载信息
+//-----------------------------------------------------------------------------
+std::string TcpInspectInfo::getLoopLoadReport()
+{
+    std::string result;
+    AutoLocker locker(loopListsMutex_);
+
+    for (size_t i = 0; i < loopLists_.size(); i++)
+    {
+        result += formatString("[io_service_%d]\n", (int)i);
+        result += loopLists_[i]->getLoadReport();
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class TcpEventLoop
+
+TcpEventLoop::TcpEventLoop() :
+    timingWheel_(getMonoTicks()),
+    loopIndex_(0),
+    connCount_(0),
+    queuedSendBytes_(0),
+    latencyMicros_(0),
+    lastBusyMicros_(0),
+    busyStartMicros_(0)
+{
+    // nothing
+}
+
+TcpEventLoop::~TcpEventLoop()
+{
+    connections_.clear();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 将指定连接注册到此 eventLoop 中
+//-----------------------------------------------------------------------------
+void TcpEventLoop::addConnection(TcpConnection *connection, TcpCallbacks* _callback)
+{
+    TcpInspectInfo::instance().addConnCount.increment();
+
+    TcpConnectionPtr connPtr(connection);
+    connection->connectionId_.store(connections_.add(connPtr, loopIndex_), std::memory_order_release);
+    connCount_.store(connections_.getCount(), std::memory_order_relaxed);
+
+    registerConnection(connection);
+
+	if (_callback)
+	{
+		delegateToLoop(std::bind(&TcpCallbacks::onTcpConnected, _callback, connPtr));
+	}
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 将指定连接从此 eventLoop 中注销
+//-----------------------------------------------------------------------------
+void TcpEventLoop::removeConnection(TcpConnection *connection)
+{
+    TcpInspectInfo::instance().removeConnCount.increment();
+
+    unregisterConnection(connection);
+
+    // 此处 shared_ptr 计数递减，有可能会销毁 TcpConnection 对象
+    connections_.remove(connection->getConnectionId());
+    connCount_.store(connections_.getCount(), std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 向指定ID的连接发送数据 (在事件循环线程中执行)
+// 备注: 连接已不存在 (ID 的代数已过期) 或已发生错误时，丢弃数据。
+//-----------------------------------------------------------------------------
+void TcpEventLoop::sendToConnection(TcpConnectionId connId, const SharedBuffer& buffer,
+    const Context& context, int timeout)
+{
+    TcpInspectInfo::instance().sendByIdCount.increment();
+
+    TcpConnectionPtr connection = connections_.find(connId);
+    if (connection && !connection->isErrorOccurred_)
+        connection->postSharedSendTask(buffer, context, timeout);
+    else
+        TcpInspectInfo::instance().sendByIdDroppedCount.increment();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 向一组连接发送同一份数据 (在事件循环线程中执行)
+//-----------------------------------------------------------------------------
+void TcpEventLoop::sendToConnections(const std::shared_ptr<TcpConnectionIds>& connIds,
+    const SharedBuffer& buffer, const Context& context, int timeout)
+{
+    for (size_t i = 0; i < connIds->size(); i++)
+        sendToConnection((*connIds)[i], buffer, context, timeout);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 在事件循环线程中直接接管一个新连接 (无需经由 delegateToLoop 转交)
+//-----------------------------------------------------------------------------
+void TcpEventLoop::attachConnection(TcpConnection *connection)
+{
+    assertInLoopThread();
+    connection->setEventLoop(this);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 接管由 TcpEventLoopList 分派而来的连接 (在事件循环线程中执行)
+//-----------------------------------------------------------------------------
+void TcpEventLoop::assignConnection(TcpConnection *connection)
+{
+    assignedConnCount_.decrement();
+    connection->setEventLoop(this);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得连接数 (含已分派但尚未加入的连接)
+//-----------------------------------------------------------------------------
+int TcpEventLoop::getLoadConnCount() const
+{
+    return connCount_.load(std::memory_order_relaxed) +
+        (int)const_cast<AtomicInt&>(assignedConnCount_).get();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得每轮事件处理耗时的滑动平均值 (微秒)
+// 备注: 事件循环空闲 (超过 1 秒未处理事件) 时返回 0。
+//-----------------------------------------------------------------------------
+int TcpEventLoop::getLatencyMicros() const
+{
+    const INT64 IDLE_MICROS = 1000 * 1000;
+
+    INT64 lastBusy = lastBusyMicros_.load(std::memory_order_relaxed);
+    if (lastBusy == 0 || getMicroTicks() - lastBusy > IDLE_MICROS)
+        return 0;
+    return latencyMicros_.load(std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 累计发送队列中数据量的变化 (在事件循环线程中执行)
+// 备注: 只有本事件循环线程写入，其它线程只读，故无需原子的读-改-写。
+//-----------------------------------------------------------------------------
+void TcpEventLoop::addQueuedSendBytes(int delta)
+{
+    queuedSendBytes_.store(queuedSendBytes_.load(std::memory_order_relaxed) + delta,
+        std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 清除全部连接
+// 备注:
+//   conn->shutdown(true, true) 使 IOCP 返回错误，从而释放 IOCP 持有的 shared_ptr。
+//   之后 TcpConnection::errorOccurred() 被调用，进而调用 onTcpDisconnected() 和
+//   TcpConnection::setEventLoop(NULL)。
+//-----------------------------------------------------------------------------
+void TcpEventLoop::clearConnections()
+{
+    assertInLoopThread();
+
+    std::vector<TcpConnectionPtr> connections;
+    connections_.getConnections(connections);
+
+    for (size_t i = 0; i < connections.size(); i++)
+        connections[i]->shutdown(true, true);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 执行事件循环
+// 注意:
+//   * 只有全部连接被销毁后才可以退出循环，不然未销毁连接将对程序退出过程造成
+//     麻烦。在 Linux 下典型的错误信息是:
+//     'pure virtual method called terminate called without an active exception'.
+//-----------------------------------------------------------------------------
+void TcpEventLoop::runLoop(Thread *thread)
+{
+    bool isTerminated = false;
+    while (!isTerminated || !connections_.isEmpty())
+    {
+        try
+        {
+	        if (thread->isTerminated())
+	        {
+                clearConnections();
+                isTerminated = true;
+                wakeupLoop();
+	        }
+
+            doLoopWork(thread);
+            executeDelegatedFunctors();
+            executeFinalizer();
+
+            // 统计本轮事件处理的耗时 (滑动平均，新值权重 1/8)
+            if (busyStartMicros_ != 0)
+            {
+                INT64 now = getMicroTicks();
+                INT64 elapsed = now - busyStartMicros_;
+                int latency = latencyMicros_.load(std::memory_order_relaxed);
+                latency += (int)((elapsed - latency) / 8);
+                latencyMicros_.store(latency, std::memory_order_relaxed);
+                lastBusyMicros_.store(now, std::memory_order_relaxed);
+                busyStartMicros_ = 0;
+            }
+        }
+        catch (Exception& e)
+        {
+			ERROR_LOG(e.makeLogStr().c_str());
+        }
+        catch (...)
+        {}
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 计算等待超时时间 (毫秒)，同时考虑时间轮中最近的到期时刻
+//-----------------------------------------------------------------------------
+int TcpEventLoop::calcLoopWaitTimeout()
+{
+    int result = OsEventLoop::calcLoopWaitTimeout();
+
+    if (result != 0 && !timingWheel_.isEmpty())
+    {
+        int wheelTimeout = timingWheel_.getWaitTimeout(getMonoTicks());
+        if (result == TIMEOUT_INFINITE || wheelTimeout < result)
+            result = wheelTimeout;
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 等待完毕，记录本轮事件处理开始的时刻
+//-----------------------------------------------------------------------------
+void TcpEventLoop::endLoopWait()
+{
+    OsEventLoop::endLoopWait();
+    busyStartMicros_ = getMicroTicks();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 处理定时器及时间轮中到期的定时项
+//-----------------------------------------------------------------------------
+void TcpEventLoop::processExpiredTimers()
+{
+    OsEventLoop::processExpiredTimers();
+
+    if (!timingWheel_.isEmpty())
+        timingWheel_.processExpired(getMonoTicks());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// class TcpEventLoopList
+
+TcpEventLoopList::TcpEventLoopList(int loopCount, const IoServiceOptions& options) :
+    EventLoopList(loopCount),
+    options_(options)
+{
+    setPlacement(options.placement);
+}
+
+TcpEventLoopList::~TcpEventLoopList()
+{
+    // nothing
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 将 connection 挂接到 EventLoop 上
+// 参数:
+//   index  - EventLoop 的序号 (0-based)，为 -1 表示按 policy 自动选择。
+//   policy - 自动选择时采用的分派策略
+//-----------------------------------------------------------------------------
+bool TcpEventLoopList::registerToEventLoop(BaseTcpConnection *connection, int eventLoopIndex,
+    LOOP_ASSIGN_POLICY policy)
+{
+    TcpEventLoop *eventLoop = NULL;
+
+    {
+        AutoLocker locker(mutex_);
+        if (eventLoopIndex < 0 || eventLoopIndex >= getCount())
+            eventLoopIndex = selectEventLoop(connection, policy);
+        if (eventLoopIndex >= 0)
+            eventLoop = getItem(eventLoopIndex);
+    }
+
+    bool result = (eventLoop != NULL);
+    if (result)
+    {
+        // 在连接真正加入前即计入负载，避免同一时刻的大量连接被分派到同一事件循环
+        eventLoop->markAssigned();
+
+        // 将 eventLoop->assignConnection(connection) 委托给事件循环线程
+        eventLoop->delegateToLoop(std::bind(
+            &TcpEventLoop::assignConnection,
+            eventLoop,
+            static_cast<TcpConnection*>(connection)));
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 按指定策略为 connection 选择一个 EventLoop
+// 返回: EventLoop 的序号 (0-based)，列表为空时返回 -1
+// 备注:
+//   各负载指标均为其它线程写入的近似值。比较时从轮流计数的位置开始扫描，使负载
+//   相同的事件循环被轮流选中。
+//-----------------------------------------------------------------------------
+int TcpEventLoopList::selectEventLoop(BaseTcpConnection *connection, LOOP_ASSIGN_POLICY policy)
+{
+    // 只有按对端散列时才需要取得对端地址
+    if (policy == LAP_PEER_HASH)
+        return selectEventLoop(connection->getPeerAddr(), policy);
+    else
+        return selectEventLoop(InetAddress(), policy);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 按指定策略为对端地址为 peerAddr 的连接选择一个 EventLoop
+// 返回: EventLoop 的序号 (0-based)，列表为空时返回 -1
+//-----------------------------------------------------------------------------
+int TcpEventLoopList::selectEventLoop(const InetAddress& peerAddr, LOOP_ASSIGN_POLICY policy)
+{
+    int count = getCount();
+    if (count <= 0) return -1;
+
+    if (policy == LAP_PEER_HASH)
+    {
+        UINT ip = peerAddr.ip;
+        return (int)((((UINT64)ip * 0x9E3779B97F4A7C15ULL) >> 32) % (UINT)count);
+    }
+
+    int start = (int)((UINT)rrIndex_.increment() % (UINT)count);
+    if (policy == LAP_ROUND_ROBIN)
+        return start;
+
+    int result = start;
+    INT64 minLoad = -1;
+
+    for (int i = 0; i < count; i++)
+    {
+        int index = (start + i) % count;
+        TcpEventLoop *eventLoop = getItem(index);
+
+        INT64 load = 0;
+        switch (policy)
+        {
+        case LAP_LEAST_CONNECTIONS:
+            load = eventLoop->getLoadConnCount();
+            break;
+        case LAP_LEAST_QUEUED_BYTES:
+            load = eventLoop->getQueuedSendBytes();
+            break;
+        case LAP_LOWEST_LATENCY:
+            load = eventLoop->getLatencyMicros();
+            break;
+        default:
+            break;
+        }
+
+        if (minLoad < 0 || load < minLoad)
+        {
+            minLoad = load;
+            result = index;
+        }
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 为即将连接 peerAddr 的连接预先选定一个 EventLoop，并计入其负载
+// 返回: 选定的 EventLoop，列表为空时返回 NULL
+// 备注:
+//   连接建立后须在该事件循环线程中调用 assignConnection()，放弃时调用 cancelAssigned()。
+//-----------------------------------------------------------------------------
+TcpEventLoop* TcpEventLoopList::reserveEventLoop(const InetAddress& peerAddr,
+    LOOP_ASSIGN_POLICY policy)
+{
+    TcpEventLoop *eventLoop = NULL;
+
+    {
+        AutoLocker locker(mutex_);
+        int eventLoopIndex = selectEventLoop(peerAddr, policy);
+        if (eventLoopIndex >= 0)
+            eventLoop = getItem(eventLoopIndex);
+    }
+
+    if (eventLoop != NULL)
+        eventLoop->markAssigned();
+
+    return eventLoop;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得各事件循环的负载信息 (每行一个事件循环)
+//-----------------------------------------------------------------------------
+std::string TcpEventLoopList::getLoadReport()
+{
+    std::string result;
+    AutoLocker locker(mutex_);
+
+    for (int i = 0; i < getCount(); i++)
+    {
+        TcpEventLoop *eventLoop = getItem(i);
+        result += formatString("loop_%d: connections=%d, queued_bytes=%s, latency_us=%d\n",
+            i, eventLoop->getLoadConnCount(),
+            intToStr(eventLoop->getQueuedSendBytes()).c_str(),
+            eventLoop->getLatencyMicros());
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+
+const char* TcpEventLoopList::getPolicyName(LOOP_ASSIGN_POLICY policy)
+{
+    switch (policy)
+    {
+    case LAP_ROUND_ROBIN:        return "round-robin";
+    case LAP_LEAST_CONNECTIONS:  return "least-connections";
+    case LAP_LEAST_QUEUED_BYTES: return "least-queued-bytes";
+    case LAP_LOWEST_LATENCY:     return "lowest-latency";
+    case LAP_PEER_HASH:          return "peer-hash";
+    default:                     return "unknown";
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+EventLoop* TcpEventLoopList::createEventLoop()
+{
+#ifdef _COMPILER_WIN
+    TcpEventLoop *result = new WinTcpEventLoop();
+#endif
+#ifdef _COMPILER_LINUX
+    TcpEventLoop *result = new LinuxTcpEventLoop(options_);
+#endif
+
+    // 创建时尚未加入列表，列表中现有的个数即为其序号
+    result->setLoopIndex(getCount());
+    return result;
 }
 
 //////////////////////////////////////////////////////////////////////////
 // IoService
 
-IoService::IoService(int loopCount) : eventLoopList_(loopCount)
+IoService::IoService(int loopCount, const IoServiceOptions& options) : eventLoopList_(loopCount, options)
 {
 	init();
 };
@@ -379,22 +1176,101 @@ IoService::~IoService()
 void  IoService::init()
 {
 	eventLoopList_.start();
+	TcpInspectInfo::instance().addLoopList(&eventLoopList_);
 }
 
 void  IoService::release()
 {
+	TcpInspectInfo::instance().removeLoopList(&eventLoopList_);
 	eventLoopList_.stop();
 }
 
-bool  IoService::registerToEventLoop(BaseTcpConnection *connection, int eventLoopIndex)
+bool  IoService::registerToEventLoop(BaseTcpConnection *connection, int eventLoopIndex,
+	TcpEventLoopList::LOOP_ASSIGN_POLICY policy)
+{
+	return eventLoopList_.registerToEventLoop(connection, eventLoopIndex, policy);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 按连接ID发送数据 (线程安全)
+// 备注:
+//   根据连接ID中的事件循环序号，直接投递到连接所属的事件循环中执行，调用者无需
+//   持有 TcpConnectionPtr。连接已断开 (或ID已过期) 时数据被丢弃。
+// 返回:
+//   连接ID无效 (事件循环序号超出范围) 时返回 false，否则返回 true。
+//-----------------------------------------------------------------------------
+bool IoService::send(TcpConnectionId connId, const SharedBuffer& buffer,
+	const Context& context, int timeout)
+{
+	int loopIndex = TcpConnectionTable::getLoopIndex(connId);
+	if (connId == 0 || loopIndex >= eventLoopList_.getCount()) return false;
+	if (buffer.isEmpty()) return true;
+
+	TcpEventLoop *eventLoop = eventLoopList_.getItem(loopIndex);
+	if (eventLoop->isInLoopThread())
+		eventLoop->sendToConnection(connId, buffer, context, timeout);
+	else
+	{
+		eventLoop->delegateToLoop(std::bind(&TcpEventLoop::sendToConnection,
+			eventLoop, connId, buffer, context, timeout));
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 按连接ID发送数据 (线程安全，数据会被复制一份)
+//-----------------------------------------------------------------------------
+bool IoService::send(TcpConnectionId connId, const void *buffer, size_t size,
+	const Context& context, int timeout)
+{
+	if (!buffer || size <= 0) return true;
+	return send(connId, SharedBuffer(buffer, static_cast<int>(size)), context, timeout);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 将同一份数据发送给多个连接 (线程安全)
+// 备注:
+//   连接ID按所属事件循环分组，每个事件循环只投递一次。各连接共享同一份数据。
+//-----------------------------------------------------------------------------
+void IoService::sendMany(const TcpConnectionIds& connIds, const SharedBuffer& buffer,
+	const Context& context, int timeout)
 {
-	return eventLoopList_.registerToEventLoop(connection, eventLoopIndex);
+	if (connIds.empty() || buffer.isEmpty()) return;
+
+	const int loopCount = eventLoopList_.getCount();
+	std::vector<std::shared_ptr<TcpConnectionIds> > groups(loopCount);
+
+	for (size_t i = 0; i < connIds.size(); i++)
+	{
+		TcpConnectionId connId = connIds[i];
+		int loopIndex = TcpConnectionTable::getLoopIndex(connId);
+		if (connId == 0 || loopIndex >= loopCount) continue;
+
+		if (!groups[loopIndex])
+			groups[loopIndex] = std::make_shared<TcpConnectionIds>();
+		groups[loopIndex]->push_back(connId);
+	}
+
+	for (int i = 0; i < loopCount; i++)
+	{
+		if (!groups[i]) continue;
+
+		TcpEventLoop *eventLoop = eventLoopList_.getItem(i);
+		if (eventLoop->isInLoopThread())
+			eventLoop->sendToConnections(groups[i], buffer, context, timeout);
+		else
+		{
+			eventLoop->delegateToLoop(std::bind(&TcpEventLoop::sendToConnections,
+				eventLoop, groups[i], buffer, context, timeout));
+		}
+	}
 }
 
 
-std::shared_ptr<IoService> CreateIOService(int loopCount)
+std::shared_ptr<IoService> CreateIOService(int loopCount, const IoServiceOptions& options)
 {
-	std::shared_ptr<IoService> service_ = std::make_shared<IoService>(loopCount);
+	std::shared_ptr<IoService> service_ = std::make_shared<IoService>(loopCount, options);
 	return service_;
 }
 
@@ -430,81 +1306,394 @@ TcpConnection::~TcpConnection()
 
     setEventLoop(NULL);
 
-    if (tcpServer_)
-        tcpServer_->decConnCount();
-    TcpInspectInfo::instance().tcpConnDestroyCount.increment();
+    if (tcpServer_)
+        tcpServer_->decConnCount();
+    TcpInspectInfo::instance().tcpConnDestroyCount.increment();
+}
+
+//-----------------------------------------------------------------------------
+
+void TcpConnection::init()
+{
+    tcpServer_ = NULL;
+    eventLoop_ = NULL;
+    connectionId_.store(0, std::memory_order_relaxed);
+    isErrorOccurred_ = false;
+    sendHighWater_ = false;
+    reportedSendBytes_ = 0;
+
+    sendTimer_.setCallback(std::bind(&TcpConnection::onTaskTimeout, this, true));
+    recvTimer_.setCallback(std::bind(&TcpConnection::onTaskTimeout, this, false));
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 提交一个发送任务 (线程安全)
+// 参数:
+//   timeout - 超时值 (毫秒)
+//-----------------------------------------------------------------------------
+void TcpConnection::send(const void *buffer, size_t size, const Context& context, int timeout)
+{
+    if (!buffer || size <= 0) return;
+
+    if (eventLoop_ == NULL)
+		ThrowException(SEM_EVENT_LOOP_NOT_SPECIFIED);
+
+    if (getEventLoop()->isInLoopThread())
+        postSendTask(buffer, static_cast<int>(size), context, timeout);
+    else
+    {
+        // 数据须复制一份，由委托的仿函数持有至事件循环线程中执行完毕
+        send(SharedBuffer(buffer, static_cast<int>(size)), context, timeout);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 提交一个发送任务 (线程安全)
+// 备注:
+//   发送过程中不会复制 buffer 中的数据，buffer 可同时投递给多个连接。
+//-----------------------------------------------------------------------------
+void TcpConnection::send(const SharedBuffer& buffer, const Context& context, int timeout)
+{
+    if (buffer.isEmpty()) return;
+
+    if (eventLoop_ == NULL)
+		ThrowException(SEM_EVENT_LOOP_NOT_SPECIFIED);
+
+    if (getEventLoop()->isInLoopThread())
+        postSharedSendTask(buffer, context, timeout);
+    else
+    {
+        getEventLoop()->delegateToLoop(std::bind(&TcpConnection::postSharedSendTask,
+            shared_from_this(), buffer, context, timeout));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 提交一个发送文件数据的任务 (线程安全)
+// 参数:
+//   fileHandle - 文件句柄 (发送完成回调或连接断开之前，调用者须保持其打开)
+//   offset     - 起始位置
+//   length     - 发送的字节数
+//   timeout    - 超时值 (毫秒)
+// 备注:
+//   Linux 下以 sendfile() (不支持时改用 splice()) 由内核直接发送，数据不经过用户
+//   空间。与其它发送任务按提交顺序发出，完成时同样回调 onTcpSendComplete()。
+//-----------------------------------------------------------------------------
+void TcpConnection::sendFile(HANDLE fileHandle, INT64 offset, INT64 length,
+    const Context& context, int timeout)
+{
+    if (fileHandle == INVALID_HANDLE_VALUE || length <= 0) return;
+
+    if (eventLoop_ == NULL)
+		ThrowException(SEM_EVENT_LOOP_NOT_SPECIFIED);
+
+    if (getEventLoop()->isInLoopThread())
+        postSendFileTask(fileHandle, offset, length, context, timeout);
+    else
+    {
+        getEventLoop()->delegateToLoop(std::bind(&TcpConnection::postSendFileTask,
+            shared_from_this(), fileHandle, offset, length, context, timeout));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 提交一个接收任务 (线程安全)
+// 参数:
+//   timeout - 超时值 (毫秒)
+//-----------------------------------------------------------------------------
+void TcpConnection::recv(const PacketSplitter& packetSplitter, const Context& context, int timeout)
+{
+    if (!packetSplitter) return;
+
+    if (eventLoop_ == NULL)
+        ThrowException(SEM_EVENT_LOOP_NOT_SPECIFIED);
+
+    RecvTask task;
+    setRecvTaskSplitter(task, packetSplitter);
+    task.context = context;
+    task.timeout = timeout;
+
+    submitRecvTask(task);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 以可续扫描的分包器提交一个接收任务 (线程安全)
+// 参数:
+//   timeout - 超时值 (毫秒)
+//-----------------------------------------------------------------------------
+void TcpConnection::recv(const ResumablePacketSplitter& packetSplitter, const Context& context, int timeout)
+{
+    if (!packetSplitter) return;
+
+    if (eventLoop_ == NULL)
+        ThrowException(SEM_EVENT_LOOP_NOT_SPECIFIED);
+
+    RecvTask task;
+    task.resumableSplitter = packetSplitter;
+    task.context = context;
+    task.timeout = timeout;
+
+    submitRecvTask(task);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 进入连续接收模式 (线程安全)
+// 备注:
+//   1. 提交一个不会完成的接收任务: 每次收到数据后，以 packetSplitter 取出全部
+//      完整数据包，一次性回调 onTcpRecvBatch()，无需每个数据包后再调用 recv()。
+//   2. 连续接收期间，其后提交的接收任务须等到 stopContinuousRecv() 之后才执行。
+//   3. 连续接收任务没有超时。
+//-----------------------------------------------------------------------------
+void TcpConnection::recvContinuous(const PacketSplitter& packetSplitter, const Context& context)
+{
+    if (!packetSplitter) return;
+
+    if (eventLoop_ == NULL)
+        ThrowException(SEM_EVENT_LOOP_NOT_SPECIFIED);
+
+    RecvTask task;
+    setRecvTaskSplitter(task, packetSplitter);
+    task.context = context;
+    task.timeout = TIMEOUT_INFINITE;
+    task.continuous = true;
+
+    submitRecvTask(task);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 退出连续接收模式 (线程安全)
+// 备注: 总是委托给事件循环执行，故在 onTcpRecvBatch() 中调用时，本批数据包仍会全部回调。
+//-----------------------------------------------------------------------------
+void TcpConnection::stopContinuousRecv()
+{
+    if (eventLoop_ == NULL) return;
+
+    getEventLoop()->delegateToLoop(
+        std::bind(&TcpConnection::stopContinuousRecvInLoop, shared_from_this()));
+}
+
+//-----------------------------------------------------------------------------
+
+void TcpConnection::stopContinuousRecvInLoop()
+{
+    if (!recvTaskQueue_.empty() && recvTaskQueue_.front().continuous)
+    {
+        recvTaskQueue_.pop_front();
+        updateRecvTimer();
+
+        // 已缓存的数据须按其后的接收任务重新拆包，否则要等到下次收到数据才会处理
+        recvTaskQueueChanged();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 开始批量发送 (线程安全)
+// 备注:
+//   此后提交的发送任务只放入发送队列，直到调用 flush() 或本轮事件循环结束时，
+//   才以一次 sendmsg() 聚集发出，从而使一个应答的多个部分 (如头部、正文、尾部)
+//   合并为尽量少的系统调用和 TCP 报文段。宜在事件循环线程中 (如回调中) 使用。
+//-----------------------------------------------------------------------------
+void TcpConnection::beginBatch()
+{
+    if (eventLoop_ == NULL)
+		ThrowException(SEM_EVENT_LOOP_NOT_SPECIFIED);
+
+    if (getEventLoop()->isInLoopThread())
+        doBeginBatch();
+    else
+    {
+        getEventLoop()->delegateToLoop(std::bind(&TcpConnection::doBeginBatch,
+            shared_from_this()));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 结束批量发送，立即发出批量期间积压的数据 (线程安全)
+//-----------------------------------------------------------------------------
+void TcpConnection::flush()
+{
+    if (eventLoop_ == NULL)
+		ThrowException(SEM_EVENT_LOOP_NOT_SPECIFIED);
+
+    if (getEventLoop()->isInLoopThread())
+        doFlush();
+    else
+    {
+        getEventLoop()->delegateToLoop(std::bind(&TcpConnection::doFlush,
+            shared_from_this()));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 在事件循环线程中提交接收任务
+//-----------------------------------------------------------------------------
+void TcpConnection::submitRecvTask(const RecvTask& task)
+{
+    if (getEventLoop()->isInLoopThread())
+        postRecvTask(task);
+    else
+        getEventLoop()->delegateToLoop(std::bind(&TcpConnection::postRecvTask, shared_from_this(), task));
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 设置接收任务的分包器
+// 备注:
+//   预定义分包器改用其可续扫描版本；普通函数直接保存函数指针，省去 std::function
+//   的间接调用。
+//-----------------------------------------------------------------------------
+void TcpConnection::setRecvTaskSplitter(RecvTask& task, const PacketSplitter& packetSplitter)
+{
+    task.resumableSplitter = getResumablePacketSplitter(packetSplitter);
+    if (!task.resumableSplitter)
+    {
+        const PacketSplitterFunc *func = packetSplitter.target<PacketSplitterFunc>();
+        if (func != NULL)
+            task.splitterFunc = *func;
+        else
+            task.packetSplitter = packetSplitter;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 设置缓存水位 (线程安全)
+//-----------------------------------------------------------------------------
+void TcpConnection::setWaterMarks(const TcpWaterMarks& value)
+{
+    if (eventLoop_ == NULL)
+        waterMarks_ = value;
+    else if (getEventLoop()->isInLoopThread())
+    {
+        waterMarks_ = value;
+        checkSendWaterMark();
+    }
+    else
+    {
+        getEventLoop()->delegateToLoop(
+            std::bind(&TcpConnection::setWaterMarks, shared_from_this(), value));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 发送缓存的数据量变化后调用
+// 备注: 将变化量计入所属事件循环的负载，并检查缓存水位。
+//-----------------------------------------------------------------------------
+void TcpConnection::afterSendQueueChanged()
+{
+    if (eventLoop_ == NULL) return;
+
+    int pendingBytes = getPendingSendBytes();
+    if (pendingBytes != reportedSendBytes_)
+    {
+        getEventLoop()->addQueuedSendBytes(pendingBytes - reportedSendBytes_);
+        reportedSendBytes_ = pendingBytes;
+    }
+
+    checkSendWaterMark();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 检查待发送的数据量是否越过了高水位或回落到了低水位
+// 备注:
+//   在发送缓存的数据量变化后调用，此时可能正处于发送调用或发送完成处理的上下文中。
+//   为避免用户在回调中再次发送造成递归，onTcpHighWaterMark() 和 onTcpWriteDrained()
+//   均委托到事件循环中执行。
+//-----------------------------------------------------------------------------
+void TcpConnection::checkSendWaterMark()
+{
+    if (isErrorOccurred_ || eventLoop_ == NULL) return;
+    if (!sendHighWater_ && waterMarks_.sendHighWaterMark <= 0) return;
+
+    int pendingBytes = getPendingSendBytes();
+
+    if (!sendHighWater_)
+    {
+        if (pendingBytes >= waterMarks_.sendHighWaterMark)
+        {
+            sendHighWater_ = true;
+            TcpInspectInfo::instance().sendHighWaterCount.increment();
+
+            if (m_callback)
+            {
+                getEventLoop()->delegateToLoop(std::bind(&TcpCallbacks::onTcpHighWaterMark,
+                    m_callback, shared_from_this(), pendingBytes));
+            }
+            sendWaterMarkChanged();
+        }
+    }
+    else if (pendingBytes <= waterMarks_.sendLowWaterMark || waterMarks_.sendHighWaterMark <= 0)
+    {
+        sendHighWater_ = false;
+        TcpInspectInfo::instance().sendDrainedCount.increment();
+
+        if (m_callback)
+        {
+            getEventLoop()->delegateToLoop(std::bind(&TcpCallbacks::onTcpWriteDrained,
+                m_callback, shared_from_this()));
+        }
+        sendWaterMarkChanged();
+    }
 }
 
 //-----------------------------------------------------------------------------
-
-void TcpConnection::init()
+// 描述: 返回接收高水位 (无接收任务时，缓存数据达到此值即暂停接收)
+//-----------------------------------------------------------------------------
+int TcpConnection::getRecvHighWaterMark() const
 {
-    tcpServer_ = NULL;
-    eventLoop_ = NULL;
-    isErrorOccurred_ = false;
+    if (waterMarks_.recvHighWaterMark > 0)
+        return waterMarks_.recvHighWaterMark;
+    else
+        return max(1024 * 16, m_maxbuffszie);
 }
 
 //-----------------------------------------------------------------------------
-// 描述: 提交一个发送任务 (线程安全)
-// 参数:
-//   timeout - 超时值 (毫秒)
+// 描述: 返回接收低水位 (暂停接收后，缓存数据回落到此值即恢复接收)
 //-----------------------------------------------------------------------------
-void TcpConnection::send(const void *buffer, size_t size, const Context& context, int timeout)
+int TcpConnection::getRecvLowWaterMark() const
 {
-    if (!buffer || size <= 0) return;
-
-    if (eventLoop_ == NULL)
-		ThrowException(SEM_EVENT_LOOP_NOT_SPECIFIED);
-
-    if (getEventLoop()->isInLoopThread())
-        postSendTask(buffer, static_cast<int>(size), context, timeout);
+    int highWaterMark = getRecvHighWaterMark();
+    if (waterMarks_.recvLowWaterMark > 0)
+        return min(waterMarks_.recvLowWaterMark, highWaterMark);
     else
-    {
-        std::string data((const char*)buffer, size);
-        getEventLoop()->delegateToLoop(
-			std::bind(&TcpConnection::postSendTask, shared_from_this(), data.c_str(),(int)data.size(), context, timeout));
-    }
+        return highWaterMark;
 }
 
 //-----------------------------------------------------------------------------
-// 描述: 提交一个接收任务 (线程安全)
-// 参数:
-//   timeout - 超时值 (毫秒)
+// 描述: 提交一个发送共享数据的任务
+// 备注: 缺省实现复制数据后按普通发送任务处理，子类可重写以避免复制。
 //-----------------------------------------------------------------------------
-void TcpConnection::recv(const PacketSplitter& packetSplitter, const Context& context, int timeout)
+void TcpConnection::postSharedSendTask(const SharedBuffer& buffer,
+    const Context& context, int timeout)
 {
-    if (!packetSplitter) return;
-
-    if (eventLoop_ == NULL)
-        ThrowException(SEM_EVENT_LOOP_NOT_SPECIFIED);
-
-    if (getEventLoop()->isInLoopThread())
-        postRecvTask(packetSplitter, context, timeout);
-    else
-    {
-        getEventLoop()->delegateToLoop(
-            std::bind(&TcpConnection::postRecvTask, shared_from_this(), packetSplitter, context, timeout));
-    }
+    postSendTask(buffer.getData(), buffer.getSize(), context, timeout);
 }
 
 //-----------------------------------------------------------------------------
-
+// 描述: 返回连接名称 (仅用于显示和日志)
+// 备注:
+//   名称中含有连接ID，故在连接加入事件循环 (取得连接ID) 后首次取用时才生成，此前
+//   (如 TcpConnector 的完成回调中) 返回空串。每个连接只生成一次，无需全局锁。
+//-----------------------------------------------------------------------------
 const std::string& TcpConnection::getConnectionName() const
 {
-    if (connectionName_.empty() && isConnected())
-    {
-        static Mutex mutex;
-        static SeqNumberAlloc connIdAlloc_;
+    if (isConnected() && getConnectionId() != 0)
+        std::call_once(connectionNameFlag_, std::bind(&TcpConnection::buildConnectionName, this));
 
-        AutoLocker locker(mutex);
+    return connectionName_;
+}
 
-        connectionName_ = formatString("%s-%s#%s",
-            getSocket().getLocalAddr().getDisplayStr().c_str(),
-            getSocket().getPeerAddr().getDisplayStr().c_str(),
-            intToStr((INT64)connIdAlloc_.allocId()).c_str());
-    }
+//-----------------------------------------------------------------------------
+// 描述: 生成连接名称，格式为 "本地地址-对端地址#事件循环序号.槽号.代数"
+//-----------------------------------------------------------------------------
+void TcpConnection::buildConnectionName() const
+{
+    TcpConnectionId connectionId = getConnectionId();
 
-    return connectionName_;
+    connectionName_ = formatString("%s-%s#%d.%u.%u",
+        getSocket().getLocalAddr().getDisplayStr().c_str(),
+        getSocket().getPeerAddr().getDisplayStr().c_str(),
+        TcpConnectionTable::getLoopIndex(connectionId),
+        TcpConnectionTable::getSlot(connectionId),
+        TcpConnectionTable::getGeneration(connectionId));
 }
 
 //-----------------------------------------------------------------------------
@@ -573,49 +1762,121 @@ void TcpConnection::errorOccurred()
 }
 
 //-----------------------------------------------------------------------------
-// 描述: 检查接收和发送任务是否超时
+// 描述: 发送任务队列的队首变化后，为新的队首任务布置超时定时
+// 备注: 任务的超时从其成为队首任务时开始计算。
 //-----------------------------------------------------------------------------
-void TcpConnection::checkTimeout(UINT curTicks)
+void TcpConnection::updateSendTimer()
 {
-    if (!sendTaskQueue_.empty())
+    if (sendTaskQueue_.empty())
     {
-        SendTask& task = sendTaskQueue_.front();
+        sendTimer_.cancel();
+        return;
+    }
 
-        if (task.startTicks == 0)
-            task.startTicks = curTicks;
+    SendTask& task = sendTaskQueue_.front();
+    if (task.startTicks == 0 && eventLoop_ != NULL)
+    {
+        task.startTicks = getMonoTicks();
+        if (task.timeout > 0)
+            getEventLoop()->getTimingWheel().arm(&sendTimer_, task.startTicks + task.timeout);
         else
-        {
-            if (task.timeout > 0 &&
-                (int)getTickDiff(task.startTicks, curTicks) > task.timeout)
-            {
-				shutdown(true, true);
-				sendTaskQueue_.clear();
-				recvTaskQueue_.clear();
-				INFO_LOG("shutdown %x reason[recv time out]", this);
-            }
-        }
+            sendTimer_.cancel();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 连续接收模式下，取出缓存中的全部完整数据包，并一次性回调
+// 参数:
+//   buffer - 缓存中可用数据的首字节指针
+//   bytes  - 缓存中可用数据的字节数
+// 返回:
+//   已回调的字节数 (调用者须从缓存中取走)，< 0 表示数据格式错误
+//-----------------------------------------------------------------------------
+int TcpConnection::retrievePacketBatch(RecvTask& task, const char *buffer, int bytes)
+{
+    int offset = 0;
+    recvBatch_.clear();
+
+    while (offset < bytes)
+    {
+        int packetSize = 0;
+        task.splitPacket(buffer + offset, bytes - offset, packetSize);
+        if (packetSize < 0)
+            return -1;
+        if (packetSize == 0)
+            break;
+
+        // 扫描状态只对当前数据包有效
+        task.splitterState.reset();
+
+        TcpPacketView view;
+        view.data = buffer + offset;
+        view.bytes = packetSize;
+        recvBatch_.push_back(view);
+        offset += packetSize;
     }
 
-    if (!recvTaskQueue_.empty())
+    if (!recvBatch_.empty() && m_callback)
     {
-        RecvTask& task = recvTaskQueue_.front();
+        // 回调中可能退出连续接收模式，故先复制上下文
+        Context context = task.context;
+        m_callback->onTcpRecvBatch(shared_from_this(), &recvBatch_[0], (int)recvBatch_.size(), context);
+    }
+
+    return offset;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 分包器报告数据格式错误 (如长度字段超出上限)，断开连接
+//-----------------------------------------------------------------------------
+void TcpConnection::framingErrorOccurred()
+{
+    if (isErrorOccurred_) return;
+
+    TcpInspectInfo::instance().framingErrorCount.increment();
+    WARN_LOG(SEM_PACKET_FRAMING_ERROR, getConnectionName().c_str());
+    errorOccurred();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 接收任务队列的队首变化后，为新的队首任务布置超时定时
+//-----------------------------------------------------------------------------
+void TcpConnection::updateRecvTimer()
+{
+    if (recvTaskQueue_.empty())
+    {
+        recvTimer_.cancel();
+        return;
+    }
 
-        if (task.startTicks == 0)
-            task.startTicks = curTicks;
+    RecvTask& task = recvTaskQueue_.front();
+    if (task.startTicks == 0 && eventLoop_ != NULL)
+    {
+        task.startTicks = getMonoTicks();
+        if (task.timeout > 0)
+            getEventLoop()->getTimingWheel().arm(&recvTimer_, task.startTicks + task.timeout);
         else
-        {
-            if (task.timeout > 0 &&
-                (int)getTickDiff(task.startTicks, curTicks) > task.timeout)
-            {
-				shutdown(true, true);
-				sendTaskQueue_.clear();
-				recvTaskQueue_.clear();
-				INFO_LOG("shutdown %x reason[recv time out]", this);
-            }
-        }
+            recvTimer_.cancel();
     }
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 队首的发送或接收任务超时 (由时间轮回调)
+//-----------------------------------------------------------------------------
+void TcpConnection::onTaskTimeout(bool isSendTask)
+{
+    // 关闭连接的过程中可能会释放事件循环持有的引用
+    TcpConnectionPtr thisObj = shared_from_this();
+
+    shutdown(true, true);
+    sendTaskQueue_.clear();
+    recvTaskQueue_.clear();
+    sendTimer_.cancel();
+    recvTimer_.cancel();
+
+    INFO_LOG("shutdown %x reason[%s time out]", this, isSendTask ? "send" : "recv");
+}
+
 //-----------------------------------------------------------------------------
 // 描述: 设置此连接从属于哪个 eventLoop
 //-----------------------------------------------------------------------------
@@ -627,6 +1888,11 @@ void TcpConnection::setEventLoop(TcpEventLoop *eventLoop)
         {
             TcpEventLoop *temp = eventLoop_;
             eventLoop_ = NULL;
+            sendTimer_.cancel();
+            recvTimer_.cancel();
+            temp->addQueuedSendBytes(-reportedSendBytes_);
+            reportedSendBytes_ = 0;
+            setBufferPool(NULL);
             temp->removeConnection(this);
             eventLoopChanged();
         }
@@ -635,6 +1901,7 @@ void TcpConnection::setEventLoop(TcpEventLoop *eventLoop)
         {
             eventLoop->assertInLoopThread();
             eventLoop_ = eventLoop;
+            setBufferPool(eventLoop->getBufferPool());
 			eventLoop->addConnection(this,m_callback);
 
 
@@ -643,6 +1910,15 @@ void TcpConnection::setEventLoop(TcpEventLoop *eventLoop)
     }
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 指定连接缓存所用的块池
+// 备注: 在事件循环线程中调用。连接脱离事件循环前须先解除与其块池的关联。
+//-----------------------------------------------------------------------------
+void TcpConnection::setBufferPool(IoBufferPool *pool)
+{
+    recvBuffer_.setPool(pool);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // class TcpClient
 
@@ -677,13 +1953,14 @@ BaseTcpConnection* TcpClient::createConnection()
 // 备注:
 //   挂接成功后，TcpClient 将释放对 TcpConnection 的控制权。
 //-----------------------------------------------------------------------------
-bool TcpClient::registerToEventLoop(std::shared_ptr<IoService> service_, int index)
+bool TcpClient::registerToEventLoop(std::shared_ptr<IoService> service_, int index,
+    TcpEventLoopList::LOOP_ASSIGN_POLICY policy)
 {
     bool result = false;
 
     if (connection_ != NULL && service_)
     {
-		result = service_->registerToEventLoop(connection_, index);
+		result = service_->registerToEventLoop(connection_, index, policy);
 		if (result)
 			connection_ = NULL;
     }
@@ -691,18 +1968,52 @@ bool TcpClient::registerToEventLoop(std::shared_ptr<IoService> service_, int ind
     return result;
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 将连接交给已预先选定的事件循环 (须在该事件循环线程中调用)
+//-----------------------------------------------------------------------------
+void TcpClient::assignToEventLoop(TcpEventLoop *eventLoop)
+{
+    TcpConnection *connection = static_cast<TcpConnection*>(connection_);
+    connection_ = NULL;
+    eventLoop->assignConnection(connection);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // class TcpServer
 
 TcpServer::TcpServer(std::shared_ptr<IoService> service, TcpCallbacks* _callback, WORD port, int maxbufsize) :
-	m_callback(_callback),
-	maxbufsize_(maxbufsize)
+    acceptMode_(AM_LISTENER_THREAD),
+    loopAssignPolicy_(TcpEventLoopList::LAP_ROUND_ROBIN),
+	maxbufsize_(maxbufsize),
+	m_callback(_callback)
 {
 	ASSERT_X(service);
 	m_IoService = service;
 	setLocalPort(port);
 }
 
+TcpServer::~TcpServer()
+{
+    // 必须在此处关闭，以便调用本类的 stopListenerThread()
+    close();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 设置接受连接的方式
+// 备注: 非 Linux 平台下 AM_REUSE_PORT 等同于 AM_LISTENER_THREAD。
+//-----------------------------------------------------------------------------
+void TcpServer::setAcceptMode(ACCEPT_MODE value)
+{
+    if (value != acceptMode_)
+    {
+        if (isActive()) close();
+        acceptMode_ = value;
+#ifdef _COMPILER_LINUX
+        setReusePort(acceptMode_ == AM_REUSE_PORT);
+#endif
+    }
+}
+
 //-----------------------------------------------------------------------------
 
 void TcpServer::open()
@@ -717,6 +2028,34 @@ void TcpServer::close()
     BaseTcpServer::close();
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 开始接受连接
+//-----------------------------------------------------------------------------
+void TcpServer::startListenerThread()
+{
+#ifdef _COMPILER_LINUX
+    if (acceptMode_ == AM_REUSE_PORT)
+    {
+        startAcceptors();
+        return;
+    }
+#endif
+
+    BaseTcpServer::startListenerThread();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 停止接受连接
+//-----------------------------------------------------------------------------
+void TcpServer::stopListenerThread()
+{
+#ifdef _COMPILER_LINUX
+    stopAcceptors();
+#endif
+
+    BaseTcpServer::stopListenerThread();
+}
+
 //-----------------------------------------------------------------------------
 // 描述: 创建连接对象
 //-----------------------------------------------------------------------------
@@ -724,6 +2063,8 @@ BaseTcpConnection* TcpServer::createConnection(SOCKET socketHandle)
 {
     BaseTcpConnection *result = NULL;
 
+    applySocketTuning(socketHandle, getSocketTuning(), false);
+
 #ifdef _COMPILER_WIN
     result = new WinTcpConnection(m_callback, maxbufsize_,this, socketHandle);
 #endif
@@ -731,6 +2072,8 @@ BaseTcpConnection* TcpServer::createConnection(SOCKET socketHandle)
     result = new LinuxTcpConnection(m_callback, maxbufsize_, this, socketHandle);
 #endif
 
+    static_cast<TcpConnection*>(result)->setWaterMarks(waterMarks_);
+
     return result;
 }
 
@@ -744,16 +2087,179 @@ void TcpServer::acceptConnection(BaseTcpConnection *connection)
 {
 	if (m_IoService)
 	{
-		m_IoService->registerToEventLoop(connection, -1);
+		m_IoService->registerToEventLoop(connection, -1, loopAssignPolicy_);
 	}
 }
 
+#ifdef _COMPILER_LINUX
+
+//-----------------------------------------------------------------------------
+// 描述: 在每个事件循环中注册一个 SO_REUSEPORT 监听套接字
+// 备注:
+//   第 0 个事件循环使用 BaseTcpServer 自身的监听套接字，其余各自另开一个。
+//   新连接由内核在这些套接字间分配，并在所属事件循环线程中直接接管。
+//-----------------------------------------------------------------------------
+void TcpServer::startAcceptors()
+{
+    TcpEventLoopList& eventLoopList = m_IoService->GetTcpEventLoopList();
+
+    // 先确定全部监听套接字，之后事件循环线程只读取各自的一项
+    for (int i = 0; i < eventLoopList.getCount(); ++i)
+        acceptorHandles_.push_back(i == 0 ? getSocket().getHandle() : openExtraListener());
+    acceptorStates_.assign(acceptorHandles_.size(), AcceptorState());
+
+    for (int i = 0; i < eventLoopList.getCount(); ++i)
+    {
+        LinuxTcpEventLoop *eventLoop = static_cast<LinuxTcpEventLoop*>(eventLoopList[i]);
+        eventLoop->delegateToLoop(std::bind(&TcpServer::watchAcceptor, this, eventLoop, i));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 从各事件循环中注销监听套接字，并等待注销完成
+//-----------------------------------------------------------------------------
+void TcpServer::stopAcceptors()
+{
+    if (acceptorHandles_.empty()) return;
+
+    TcpEventLoopList& eventLoopList = m_IoService->GetTcpEventLoopList();
+    Semaphore semaphore;
+    int waitCount = 0;
+
+    for (size_t i = 0; i < acceptorHandles_.size() && (int)i < eventLoopList.getCount(); ++i)
+    {
+        LinuxTcpEventLoop *eventLoop = static_cast<LinuxTcpEventLoop*>(eventLoopList[(int)i]);
+        if (eventLoop->isRunning() && !eventLoop->isInLoopThread())
+        {
+            eventLoop->delegateToLoop(std::bind(&TcpServer::removeAcceptor,
+                this, eventLoop, (int)i, &semaphore));
+            ++waitCount;
+        }
+        else
+            removeAcceptor(eventLoop, (int)i, NULL);
+    }
+
+    for (int i = 0; i < waitCount; ++i)
+        semaphore.wait();
+
+    // 第 0 个是 BaseTcpServer 自身的监听套接字，由 BaseTcpServer::close() 关闭
+    for (size_t i = 1; i < acceptorHandles_.size(); ++i)
+        CloseSocket(acceptorHandles_[i]);
+    acceptorHandles_.clear();
+    acceptorStates_.clear();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 在事件循环线程中开始 (或在退避结束后恢复) 监视第 index 个监听套接字
+//-----------------------------------------------------------------------------
+void TcpServer::watchAcceptor(LinuxTcpEventLoop *eventLoop, int index)
+{
+    SOCKET handle = acceptorHandles_[index];
+    acceptorStates_[index].backOffTimer = 0;
+
+    if (eventLoop->isUringEnabled())
+    {
+        eventLoop->watchAccept(handle, UringObject::AcceptCallback(std::bind(
+            &TcpServer::acceptedInLoop, this, eventLoop, std::placeholders::_1)));
+    }
+    else
+    {
+        eventLoop->watchHandle(handle, false, true, EpollObject::HandleEventCallback(std::bind(
+            &TcpServer::acceptInLoop, this, eventLoop, index, std::placeholders::_1)));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 监听套接字可读时，在事件循环线程中批量接受新连接
+// 备注:
+//   因资源不足而失败时，暂停监视该监听套接字 ACCEPT_BACKOFF_MS 毫秒，
+//   否则它会持续就绪而使事件循环空转。
+//-----------------------------------------------------------------------------
+void TcpServer::acceptInLoop(LinuxTcpEventLoop *eventLoop, int index,
+    EpollObject::EVENT_TYPE eventType)
+{
+    const int ACCEPT_BATCH_SIZE = 64;    // 每次事件最多接受的连接数
+
+    if (eventType != EpollObject::ET_ALLOW_RECV)
+        return;
+
+    SOCKET listenHandle = acceptorHandles_[index];
+    AcceptorState& acceptor = acceptorStates_[index];
+
+    for (int i = 0; i < ACCEPT_BATCH_SIZE; ++i)
+    {
+        SOCKET handle = ::accept4(listenHandle, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (handle == INVALID_SOCKET)
+        {
+            int errorCode = SocketGetLastError();
+            if (errorCode == SS_EINTR || errorCode == SS_ECONNABORTED)
+                continue;
+            if (errorCode == SS_EWOULDBLOCK)
+                break;
+
+            bool backOff = isAcceptResourceError(errorCode);
+            acceptor.errorLog.log(errorCode, backOff);
+            if (backOff && acceptor.backOffTimer == 0)
+            {
+                eventLoop->unwatchHandle(listenHandle);
+                acceptor.backOffTimer = eventLoop->executeAfter(ACCEPT_BACKOFF_MS,
+                    std::bind(&TcpServer::watchAcceptor, this, eventLoop, index));
+            }
+            break;
+        }
+
+        acceptedInLoop(eventLoop, handle);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 在事件循环线程中接管一个新接受的连接
+// 备注: 使用 io_uring 后端时，由 multishot accept 的完成事件直接调用。
+//-----------------------------------------------------------------------------
+void TcpServer::acceptedInLoop(LinuxTcpEventLoop *eventLoop, SOCKET handle)
+{
+    try
+    {
+        TcpConnection *connection = static_cast<TcpConnection*>(createConnection(handle));
+        eventLoop->attachConnection(connection);
+    }
+    catch (Exception& e)
+    {
+        ERROR_LOG(e.makeLogStr().c_str());
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 在事件循环线程中注销第 index 个监听套接字 (并取消尚未结束的退避)
+//-----------------------------------------------------------------------------
+void TcpServer::removeAcceptor(LinuxTcpEventLoop *eventLoop, int index, Semaphore *semaphore)
+{
+    AcceptorState& acceptor = acceptorStates_[index];
+    if (acceptor.backOffTimer != 0)
+    {
+        eventLoop->cancelTimer(acceptor.backOffTimer);
+        acceptor.backOffTimer = 0;
+    }
+
+    eventLoop->unwatchHandle(acceptorHandles_[index]);
+    if (semaphore)
+        semaphore->increase();
+}
+
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // class TcpConnector
 
 TcpConnector::TcpConnector(std::shared_ptr<IoService> service_) :
+#ifdef _COMPILER_WIN
     taskList_(false, true),
-    thread_(NULL)
+    thread_(NULL),
+#endif
+#ifdef _COMPILER_LINUX
+    generation_(new AtomicInt()),
+#endif
+    loopAssignPolicy_(TcpEventLoopList::LAP_ROUND_ROBIN)
 {
 	ASSERT_X(service_);
 	m_IoService = service_;
@@ -761,35 +2267,95 @@ TcpConnector::TcpConnector(std::shared_ptr<IoService> service_) :
 
 TcpConnector::~TcpConnector()
 {
+#ifdef _COMPILER_WIN
     stop();
+#endif
     clear();
 }
 
 //-----------------------------------------------------------------------------
-
+// 描述: 发起异步连接
+// 参数:
+//   timeout - 连接超时 (毫秒)，TIMEOUT_INFINITE 表示由系统决定
+// 备注:
+//   连接完成 (或失败) 后回调 completeCallback。Linux 下回调在连接所属的事件循环
+//   线程中执行，Windows 下在连接器的工作者线程中执行。
+//-----------------------------------------------------------------------------
 void TcpConnector::connect(const InetAddress& peerAddr, TcpCallbacks* _callback,
-    const CompleteCallback& completeCallback, const Context& context, int maxbuffsize)
+    const CompleteCallback& completeCallback, const Context& context, int maxbuffsize,
+    int timeout)
 {
+    TcpInspectInfo::instance().connectCount.increment();
+
+#ifdef _COMPILER_WIN
     AutoLocker locker(mutex_);
 
     TaskItem *item = new TaskItem(_callback, maxbuffsize);
+    item->tcpClient.setSocketTuning(socketTuning_);
     item->peerAddr = peerAddr;
     item->completeCallback = completeCallback;
     item->state = ACS_NONE;
     item->context = context;
+    item->timeout = timeout;
+    item->startTicks = getCurTicks();
 
     taskList_.add(item);
     start();
+#endif
+
+#ifdef _COMPILER_LINUX
+    ConnectTaskPtr task(new ConnectTask(_callback, maxbuffsize));
+    {
+        AutoLocker locker(mutex_);
+        task->tcpClient.setSocketTuning(socketTuning_);
+    }
+    task->peerAddr = peerAddr;
+    task->completeCallback = completeCallback;
+    task->context = context;
+    task->timeout = timeout;
+    task->eventLoop = NULL;
+    task->timerId = 0;
+    task->watching = false;
+    task->generation = (int)generation_->get();
+    task->connectorGeneration = generation_;
+
+    // 先选定事件循环并计入其负载，避免同一时刻发起的大量连接集中到同一事件循环
+    TcpEventLoop *eventLoop = m_IoService->GetTcpEventLoopList().reserveEventLoop(
+        peerAddr, loopAssignPolicy_);
+    if (eventLoop == NULL)
+    {
+        TcpInspectInfo::instance().connectFailedCount.increment();
+        if (completeCallback)
+            completeCallback(false, NULL, peerAddr, context);
+        return;
+    }
+
+    task->eventLoop = static_cast<LinuxTcpEventLoop*>(eventLoop);
+    eventLoop->delegateToLoop(std::bind(&TcpConnector::connectInLoop, task));
+#endif
 }
 
 //-----------------------------------------------------------------------------
-
+// 描述: 放弃全部尚未完成的连接 (不再回调)
+// 备注:
+//   Linux 下尚未完成的连接在其事件循环中下次被唤醒 (可写、出错或超时) 时才关闭。
+//-----------------------------------------------------------------------------
 void TcpConnector::clear()
 {
+#ifdef _COMPILER_WIN
     AutoLocker locker(mutex_);
     taskList_.clear();
+#endif
+
+#ifdef _COMPILER_LINUX
+    generation_->increment();
+#endif
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef _COMPILER_WIN
+
 //-----------------------------------------------------------------------------
 
 void TcpConnector::start()
@@ -851,6 +2417,7 @@ void TcpConnector::work(WorkerThread& thread)
             }
         }
 
+        checkTimeout();
         invokeCompleteCallback();
     }
 }
@@ -949,6 +2516,27 @@ void TcpConnector::checkAsyncConnectState(const FdList& fds,
     }
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 将已超时仍未连接完成的任务置为失败
+//-----------------------------------------------------------------------------
+void TcpConnector::checkTimeout()
+{
+    AutoLocker locker(mutex_);
+
+    UINT64 now = getCurTicks();
+    for (int i = 0; i < taskList_.getCount(); ++i)
+    {
+        TaskItem *task = taskList_[i];
+        if (task->state == ACS_CONNECTING && task->timeout >= 0 &&
+            getTickDiff(task->startTicks, now) >= (UINT64)task->timeout)
+        {
+            TcpInspectInfo::instance().connectTimeoutCount.increment();
+            task->state = ACS_FAILED;
+            task->tcpClient.disconnect();
+        }
+    }
+}
+
 //-----------------------------------------------------------------------------
 
 TcpConnector::TaskItem* TcpConnector::findTask(SOCKET fd)
@@ -994,17 +2582,139 @@ void TcpConnector::invokeCompleteCallback()
         if (task->completeCallback)
         {
             bool success = (task->state == ACS_CONNECTED);
+            if (!success)
+                TcpInspectInfo::instance().connectFailedCount.increment();
 
             task->completeCallback(success,
                 success ? &task->tcpClient.getConnection() : NULL,
                 task->peerAddr, task->context);
 
             if (success)
-                task->tcpClient.registerToEventLoop(m_IoService);
+                task->tcpClient.registerToEventLoop(m_IoService, -1, loopAssignPolicy_);
         }
     }
 }
 
+#endif  /* ifdef _COMPILER_WIN */
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef _COMPILER_LINUX
+
+//-----------------------------------------------------------------------------
+// 描述: 在事件循环线程中发起非阻塞式连接
+//-----------------------------------------------------------------------------
+void TcpConnector::connectInLoop(const ConnectTaskPtr& task)
+{
+    if (isTaskCancelled(task))
+    {
+        finishConnect(task, false);
+        return;
+    }
+
+    int state = task->tcpClient.beginAsyncConnect(task->peerAddr);
+    if (state != ACS_CONNECTING)
+    {
+        finishConnect(task, state == ACS_CONNECTED);
+        return;
+    }
+
+    // 连接完成 (或失败) 时套接字变为可写
+    task->eventLoop->watchHandle(
+        task->tcpClient.getConnection().getSocket().getHandle(), true, false,
+        std::bind(&TcpConnector::onConnectEvent, task, std::placeholders::_1));
+    task->watching = true;
+
+    if (task->timeout >= 0)
+    {
+        task->timerId = task->eventLoop->executeAfter(task->timeout,
+            std::bind(&TcpConnector::onConnectTimeout, task));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 正在连接的套接字可写或出错 (在事件循环线程中执行)
+//-----------------------------------------------------------------------------
+void TcpConnector::onConnectEvent(const ConnectTaskPtr& task, EpollObject::EVENT_TYPE eventType)
+{
+    if (!task->watching) return;
+
+    SOCKET handle = task->tcpClient.getConnection().getSocket().getHandle();
+    socklen_t errLen = sizeof(int);
+    int errorCode = 0;
+
+    bool success =
+        (getsockopt(handle, SOL_SOCKET, SO_ERROR, (char*)&errorCode, &errLen) == 0) &&
+        (errorCode == 0) && (eventType != EpollObject::ET_ERROR);
+
+    finishConnect(task, success);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 连接超时 (在事件循环线程中执行)
+//-----------------------------------------------------------------------------
+void TcpConnector::onConnectTimeout(const ConnectTaskPtr& task)
+{
+    task->timerId = 0;
+    if (!task->watching) return;
+
+    TcpInspectInfo::instance().connectTimeoutCount.increment();
+    finishConnect(task, false);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 结束一次连接 (在事件循环线程中执行)
+// 备注:
+//   成功时先回调，再将连接加入本事件循环；连接器已 clear() 时不回调并关闭连接。
+//-----------------------------------------------------------------------------
+void TcpConnector::finishConnect(const ConnectTaskPtr& task, bool success)
+{
+    LinuxTcpEventLoop *eventLoop = task->eventLoop;
+
+    if (task->watching)
+    {
+        eventLoop->unwatchHandle(task->tcpClient.getConnection().getSocket().getHandle());
+        task->watching = false;
+    }
+    if (task->timerId != 0)
+    {
+        eventLoop->cancelTimer(task->timerId);
+        task->timerId = 0;
+    }
+
+    bool cancelled = isTaskCancelled(task);
+    if (success && !cancelled)
+        task->tcpClient.getConnection().setContext(task->context);
+    else
+    {
+        if (!success)
+            TcpInspectInfo::instance().connectFailedCount.increment();
+        task->tcpClient.disconnect();
+    }
+
+    if (!cancelled && task->completeCallback)
+    {
+        task->completeCallback(success,
+            success ? &task->tcpClient.getConnection() : NULL,
+            task->peerAddr, task->context);
+    }
+
+    if (success && !cancelled)
+        task->tcpClient.assignToEventLoop(eventLoop);
+    else
+        eventLoop->cancelAssigned();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 发起连接后连接器是否已被 clear()
+//-----------------------------------------------------------------------------
+bool TcpConnector::isTaskCancelled(const ConnectTaskPtr& task)
+{
+    return (int)task->connectorGeneration->get() != task->generation;
+}
+
+#endif  /* ifdef _COMPILER_LINUX */
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #ifdef _COMPILER_WIN
@@ -1045,6 +2755,23 @@ void WinTcpConnection::eventLoopChanged()
     }
 }
 
+//-----------------------------------------------------------------------------
+
+void WinTcpConnection::setBufferPool(IoBufferPool *pool)
+{
+    TcpConnection::setBufferPool(pool);
+    sendBuffer_.setPool(pool);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 发送缓存越过高水位或回落到低水位后，暂停或恢复接收
+//-----------------------------------------------------------------------------
+void WinTcpConnection::sendWaterMarkChanged()
+{
+    if (!isRecvPausedBySend())
+        tryRecv();
+}
+
 //-----------------------------------------------------------------------------
 // 描述: 提交一个发送任务
 //-----------------------------------------------------------------------------
@@ -1059,22 +2786,52 @@ void WinTcpConnection::postSendTask(const void *buffer, int size,
     task.timeout = timeout;
 
     sendTaskQueue_.push_back(task);
+    updateSendTimer();
 
     trySend();
+    afterSendQueueChanged();
 }
 
 //-----------------------------------------------------------------------------
-// 描述: 提交一个接收任务
+// 描述: 提交一个发送文件数据的任务
+// 备注:
+//   先将文件数据读入内存，再按普通发送任务处理 (length 不可超过 MAXINT)。
 //-----------------------------------------------------------------------------
-void WinTcpConnection::postRecvTask(const PacketSplitter& packetSplitter,
+void WinTcpConnection::postSendFileTask(HANDLE fileHandle, INT64 offset, INT64 length,
     const Context& context, int timeout)
 {
-    RecvTask task;
-    task.packetSplitter = packetSplitter;
-    task.context = context;
-    task.timeout = timeout;
+    std::string data;
+    LARGE_INTEGER pos;
+    DWORD bytesRead = 0;
+
+    pos.QuadPart = offset;
+    bool success = (length <= MAXINT) &&
+        ::SetFilePointerEx(fileHandle, pos, NULL, FILE_BEGIN);
+    if (success)
+    {
+        data.resize((size_t)length);
+        success = ::ReadFile(fileHandle, &data[0], (DWORD)length, &bytesRead, NULL) &&
+            (bytesRead == (DWORD)length);
+    }
+
+    if (!success)
+    {
+        WARN_LOG(SEM_SEND_FILE_ERROR, (int)::GetLastError(), getConnectionName().c_str());
+        errorOccurred();
+        return;
+    }
+
+    TcpInspectInfo::instance().sendFileCount.increment();
+    postSendTask(data.data(), (int)length, context, timeout);
+}
 
+//-----------------------------------------------------------------------------
+// 描述: 提交一个接收任务
+//-----------------------------------------------------------------------------
+void WinTcpConnection::postRecvTask(const RecvTask& task)
+{
     recvTaskQueue_.push_back(task);
+    updateRecvTimer();
 
     tryRecv();
 }
@@ -1106,12 +2863,11 @@ void WinTcpConnection::trySend()
 
 void WinTcpConnection::tryRecv()
 {
-    if (isRecving_) return;
+    if (isRecving_ || isRecvPausedBySend()) return;
 
-	const int MAX_BUFFER_SIZE = max(1024 * 16, m_maxbuffszie);
     const int MAX_RECV_SIZE = 1024*16;
 
-    if (recvTaskQueue_.empty() && recvBuffer_.getReadableBytes() >= MAX_BUFFER_SIZE)
+    if (recvTaskQueue_.empty() && recvBuffer_.getReadableBytes() >= getRecvHighWaterMark())
         return;
 
     isRecving_ = true;
@@ -1169,6 +2925,7 @@ void WinTcpConnection::onSendCallback(const IocpTaskData& taskData)
     {
         isSending_ = false;
         sendBuffer_.retrieve(taskData.getEntireDataSize());
+        afterSendQueueChanged();
     }
 
     bytesSent_ += taskData.getBytesTrans();
@@ -1185,6 +2942,7 @@ void WinTcpConnection::onSendCallback(const IocpTaskData& taskData)
 				m_callback->onTcpSendComplete(shared_from_this(), task.context);
 			}
             sendTaskQueue_.pop_front();
+            updateSendTimer();
         }
         else
             break;
@@ -1216,17 +2974,46 @@ void WinTcpConnection::onRecvCallback(const IocpTaskData& taskData)
 
     bytesRecved_ += taskData.getBytesTrans();
 
+    if (retrieveRecvedPackets())
+        tryRecv();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 按接收队列中的任务，从已收到的数据中取出完整数据包
+// 返回: 发生拆包错误时返回 false
+//-----------------------------------------------------------------------------
+bool WinTcpConnection::retrieveRecvedPackets()
+{
     while (!recvTaskQueue_.empty())
     {
         RecvTask& task = recvTaskQueue_.front();
         const char *buffer = recvBuffer_.peek();
         bool packetRecved = false;
 
+        if (bytesRecved_ > 0 && task.continuous)
+        {
+            int retrievedBytes = retrievePacketBatch(task, buffer, bytesRecved_);
+            if (retrievedBytes < 0)
+            {
+                framingErrorOccurred();
+                return false;
+            }
+
+            bytesRecved_ -= retrievedBytes;
+            recvBuffer_.retrieve(retrievedBytes);
+            break;
+        }
+
         if (bytesRecved_ > 0)
         {
             int packetSize = 0;
-            task.packetSplitter(buffer, bytesRecved_, packetSize);
-            if (packetSize > 0)
+            task.splitPacket(buffer, bytesRecved_, packetSize);
+            if (packetSize < 0)
+            {
+                framingErrorOccurred();
+                return false;
+            }
+            else if (packetSize > 0)
             {
                 bytesRecved_ -= packetSize;
 			
@@ -1237,6 +3024,7 @@ void WinTcpConnection::onRecvCallback(const IocpTaskData& taskData)
 				}
 
                 recvTaskQueue_.pop_front();
+                updateRecvTimer();
                 recvBuffer_.retrieve(packetSize);
                 packetRecved = true;
             }
@@ -1246,7 +3034,18 @@ void WinTcpConnection::onRecvCallback(const IocpTaskData& taskData)
             break;
     }
 
-    tryRecv();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 接收队列的队首任务被移除 (如退出连续接收模式) 后，处理已收到的数据
+//-----------------------------------------------------------------------------
+void WinTcpConnection::recvTaskQueueChanged()
+{
+    if (isErrorOccurred_) return;
+
+    if (retrieveRecvedPackets())
+        tryRecv();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1292,13 +3091,29 @@ LinuxTcpConnection::LinuxTcpConnection(TcpCallbacks* _callback, int _maxbuffsize
     init();
 }
 
+LinuxTcpConnection::~LinuxTcpConnection()
+{
+    if (splicePipe_[0] >= 0)
+    {
+        ::close(splicePipe_[0]);
+        ::close(splicePipe_[1]);
+    }
+}
+
 //-----------------------------------------------------------------------------
 
 void LinuxTcpConnection::init()
 {
+    splicePipe_[0] = splicePipe_[1] = -1;
+    splicePipeBytes_ = 0;
+    recvSizeHint_ = MIN_RECV_SIZE_HINT;
     bytesSent_ = 0;
     enableSend_ = false;
     enableRecv_ = false;
+    sendCompletePending_ = false;
+    batching_ = false;
+    batchFlushPending_ = false;
+    sendMorePending_ = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -1314,38 +3129,264 @@ void LinuxTcpConnection::eventLoopChanged()
 
 //-----------------------------------------------------------------------------
 // 描述: 提交一个发送任务
+// 备注:
+//   若发送队列为空，则先尝试直接发送，仅当内核发送缓存不足以容纳全部数据时，
+//   才将剩余数据放入发送队列并监视可发送事件。批量发送期间则只放入发送队列。
 //-----------------------------------------------------------------------------
 void LinuxTcpConnection::postSendTask(const void *buffer, int size,
     const Context& context, int timeout)
 {
-    sendBuffer_.append(buffer, size);
-
-    SendTask task;
-    task.bytes = size;
-    task.context = context;
-    task.timeout = timeout;
+    addSendTask(size, context, timeout);
+
+    int bytesSent = 0;
+    if (!hasPendingSend() && !isErrorOccurred_ && !batching_)
+    {
+        bytesSent = tryDirectSend(buffer, size);
+        if (bytesSent < 0 || bytesSent == size)
+            return;
+    }
+
+    sendQueue_.append((const char*)buffer + bytesSent, size - bytesSent);
+
+    if (batching_)
+        afterBatchSendTask();
+    else if (!enableSend_)
+        setSendEnabled(true);
+
+    afterSendQueueChanged();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 提交一个发送共享数据的任务
+// 备注: 与 postSendTask() 相同，但未能直接发出的部分以引用方式放入发送队列。
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::postSharedSendTask(const SharedBuffer& buffer,
+    const Context& context, int timeout)
+{
+    int size = buffer.getSize();
+    addSendTask(size, context, timeout);
+
+    int bytesSent = 0;
+    if (!hasPendingSend() && !isErrorOccurred_ && !batching_)
+    {
+        bytesSent = tryDirectSend(buffer.getData(), size);
+        if (bytesSent < 0 || bytesSent == size)
+            return;
+    }
+
+    sendQueue_.append(buffer, bytesSent);
+
+    if (batching_)
+        afterBatchSendTask();
+    else if (!enableSend_)
+        setSendEnabled(true);
+
+    afterSendQueueChanged();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 提交一个发送文件数据的任务
+// 备注:
+//   文件数据不占用发送队列的内存，不在此直接发送，由可发送事件驱动 trySend()
+//   发出。此前已在发送队列中的数据先于文件数据发出。
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::postSendFileTask(HANDLE fileHandle, INT64 offset, INT64 length,
+    const Context& context, int timeout)
+{
+    TcpInspectInfo::instance().sendFileCount.increment();
+    addSendTask(length, context, timeout);
+
+    FileSegment segment;
+    segment.fileHandle = fileHandle;
+    segment.offset = offset;
+    segment.bytes = length;
+    segment.queuedBytesBefore = sendQueue_.getBytes();
+    segment.useSplice = false;
+    fileSegments_.push_back(segment);
+
+    // 批量发送期间由 flush() 开始发送
+    if (!enableSend_ && !batching_)
+        setSendEnabled(true);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 将发送任务加入发送任务队列
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::addSendTask(INT64 size, const Context& context, int timeout)
+{
+    SendTask task;
+    task.bytes = size;
+    task.context = context;
+    task.timeout = timeout;
+
+    sendTaskQueue_.push_back(task);
+    updateSendTimer();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 不经过发送队列直接发送数据
+// 返回:
+//   < 0    - 发生了错误 (已调用 errorOccurred())
+//   >= 0   - 实际发出的字节数，未发出的部分由调用者放入发送队列
+//-----------------------------------------------------------------------------
+int LinuxTcpConnection::tryDirectSend(const void *buffer, int size)
+{
+    struct iovec iov;
+    iov.iov_base = (void*)buffer;
+    iov.iov_len = size;
+
+    int bytesSent = sendBufferV(&iov, 1);
+    TcpInspectInfo::instance().sendSyscallCount.increment();
+    if (bytesSent < 0)
+    {
+        errorOccurred();
+        return bytesSent;
+    }
+
+    if (bytesSent > 0)
+    {
+        bytesSent_ += bytesSent;
+        scheduleSendComplete();
+    }
+
+    if (bytesSent == size)
+        TcpInspectInfo::instance().directSendCount.increment();
+
+    return bytesSent;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 批量发送期间，发送任务的数据放入发送队列之后
+// 备注:
+//   积压过多时先行发出 (带 MSG_MORE)，以免批量发送占用过多内存。
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::afterBatchSendTask()
+{
+    TcpInspectInfo::instance().sendBatchTaskCount.increment();
+
+    if (sendQueue_.getBytes() >= MAX_BATCH_BYTES)
+        flushSendQueue(true);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 以聚集方式 (每次最多 IOV_MAX 段) 发出发送队列中的数据
+// 参数:
+//   moreToCome - 随后是否还有数据 (为 true 时以 MSG_MORE 发送，内核暂不推送
+//                不满 MSS 的报文段)
+// 备注:
+//   若正在等待可发送事件，则留给 trySend() 发送。未能全部发出时监视可发送事件。
+//   以 MSG_MORE 发出的数据若此后没有不带 MSG_MORE 的发送，则通过清除 TCP_CORK
+//   推送，以免其滞留在内核中 (最长约 200 毫秒)。
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::flushSendQueue(bool moreToCome)
+{
+    const int MAX_IOV_COUNT = IOV_MAX;
+    struct iovec iov[MAX_IOV_COUNT];
+
+    if (isErrorOccurred_ || enableSend_)
+        return;
+
+    // 有文件数据待发送时，全部交给 trySend() 按顺序发送
+    if (!fileSegments_.empty())
+    {
+        setSendEnabled(true);
+        return;
+    }
+
+    if (sendQueue_.isEmpty())
+    {
+        if (sendMorePending_ && !moreToCome)
+        {
+            sendMorePending_ = false;
+            setCork(false);
+        }
+        return;
+    }
+
+    while (!sendQueue_.isEmpty())
+    {
+        int bytesToSend = 0;
+        int iovCount = sendQueue_.fillIoVecs(iov, MAX_IOV_COUNT, bytesToSend);
+        bool more = moreToCome || bytesToSend < sendQueue_.getBytes();
+
+        int bytesSent = sendBufferV(iov, iovCount, more ? MSG_MORE : 0);
+        TcpInspectInfo::instance().sendSyscallCount.increment();
+        if (bytesSent < 0)
+        {
+            errorOccurred();
+            return;
+        }
+
+        if (bytesSent > 0)
+        {
+            sendQueue_.retrieve(bytesSent);
+            bytesSent_ += bytesSent;
+            scheduleSendComplete();
+        }
+
+        // 未能全部发出，说明内核发送缓存已满，剩余数据由 trySend() 不带 MSG_MORE 发出
+        if (bytesSent < bytesToSend)
+        {
+            sendMorePending_ = false;
+            setSendEnabled(true);
+            break;
+        }
+
+        sendMorePending_ = more;
+    }
+
+    afterSendQueueChanged();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 安排在本轮事件循环的末尾执行发送完成回调
+// 备注:
+//   此处不可直接调用发送完成回调，否则用户在回调中再次发送时会造成递归调用。
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::scheduleSendComplete()
+{
+    if (!sendCompletePending_)
+    {
+        sendCompletePending_ = true;
+        getEventLoop()->addFinalizer(std::bind(
+            &LinuxTcpConnection::afterDirectSend, shared_from_this()));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 对已发送完毕的发送任务执行发送完成回调
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::processSendComplete()
+{
+    while (!sendTaskQueue_.empty())
+    {
+        SendTask& task = sendTaskQueue_.front();
+        if (bytesSent_ >= task.bytes)
+        {
+            bytesSent_ -= task.bytes;
 
-    sendTaskQueue_.push_back(task);
+            // 回调中可能再次提交发送任务，故先将任务移出队列
+            Context context = task.context;
+            sendTaskQueue_.pop_front();
+            updateSendTimer();
 
-    if (!enableSend_)
-        setSendEnabled(true);
+			if (m_callback)
+			{
+				m_callback->onTcpSendComplete(shared_from_this(), context);
+			}
+        }
+        else
+            break;
+    }
 }
 
 //-----------------------------------------------------------------------------
 // 描述: 提交一个接收任务
 //-----------------------------------------------------------------------------
-void LinuxTcpConnection::postRecvTask(const PacketSplitter& packetSplitter,
-    const Context& context, int timeout)
+void LinuxTcpConnection::postRecvTask(const RecvTask& task)
 {
-    RecvTask task;
-    task.packetSplitter = packetSplitter;
-    task.context = context;
-    task.timeout = timeout;
-
     recvTaskQueue_.push_back(task);
-
-    if (!enableRecv_)
-        setRecvEnabled(true);
+    updateRecvTimer();
 
     // 注意: 此处必须调用 tryRetrievePacket()，否则会造成接收中止。但是，直接
     // 调用 tryRetrievePacket() 又会造成循环调用，所以必须用 delegateToLoop()，
@@ -1378,72 +3419,331 @@ void LinuxTcpConnection::setRecvEnabled(bool enabled)
 
 //-----------------------------------------------------------------------------
 // 描述: 当“可发送”事件到来时，尝试发送数据
+// 备注:
+//   内存数据每次以 sendmsg() 聚集发送最多 IOV_MAX 段，文件数据则以 sendfile()
+//   或 splice() 发送，两者按提交顺序交替进行。
+//   边缘触发模式下，持续发送直至全部发完或内核发送缓存已满 (EAGAIN)。
 //-----------------------------------------------------------------------------
 void LinuxTcpConnection::trySend()
 {
-    int readableBytes = sendBuffer_.getReadableBytes();
-    if (readableBytes <= 0)
-    {
-        setSendEnabled(false);
-        return;
-    }
+    const int MAX_IOV_COUNT = IOV_MAX;
+    const bool edgeTriggered = getEventLoop()->isEdgeTriggered();
+    struct iovec iov[MAX_IOV_COUNT];
 
-    const char *buffer = sendBuffer_.peek();
-    int bytesSent = sendBuffer((void*)buffer, readableBytes, false);
-    if (bytesSent < 0)
+    do
     {
-        errorOccurred();
-        return;
+        if (!hasPendingSend())
+        {
+            setSendEnabled(false);
+            return;
+        }
+
+        bool blocked = false;
+        int bytesSent;
+        if (!fileSegments_.empty() && fileSegments_.front().queuedBytesBefore == 0)
+            bytesSent = sendFileSegment(blocked);
+        else
+            bytesSent = sendQueuedData(iov, MAX_IOV_COUNT, blocked);
+
+        if (bytesSent < 0)
+        {
+            errorOccurred();
+            return;
+        }
+
+        if (bytesSent > 0)
+        {
+            bytesSent_ += bytesSent;
+            sendMorePending_ = false;
+            processSendComplete();
+            afterSendQueueChanged();
+        }
+
+        // 未能全部发出，说明内核发送缓存已满，等待下一次可发送事件
+        if (blocked || isErrorOccurred_)
+            break;
     }
+    while (edgeTriggered);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 聚集发送发送队列中的数据 (不越过队首的文件数据)
+// 返回:
+//   < 0    - 发生了错误
+//   >= 0   - 实际发出的字节数 (blocked 返回内核发送缓存是否已满)
+//-----------------------------------------------------------------------------
+int LinuxTcpConnection::sendQueuedData(struct iovec *iov, int maxIovCount, bool& blocked)
+{
+    int maxBytes = fileSegments_.empty() ? -1 : fileSegments_.front().queuedBytesBefore;
+    int bytesToSend = 0;
+    int iovCount = sendQueue_.fillIoVecs(iov, maxIovCount, bytesToSend, maxBytes);
 
+    int bytesSent = sendBufferV(iov, iovCount);
+    TcpInspectInfo::instance().sendSyscallCount.increment();
     if (bytesSent > 0)
+        retrieveQueuedData(bytesSent);
+
+    blocked = (bytesSent >= 0 && bytesSent < bytesToSend);
+    return bytesSent;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 发送队首的文件数据
+// 返回:
+//   < 0    - 发生了错误
+//   >= 0   - 实际发出的字节数 (blocked 返回内核发送缓存是否已满)
+// 备注:
+//   sendfile() 不支持该文件 (EINVAL/ENOSYS) 时，改用 splice() 经管道转发。
+//-----------------------------------------------------------------------------
+int LinuxTcpConnection::sendFileSegment(bool& blocked)
+{
+    FileSegment& segment = fileSegments_.front();
+    int maxBytes = (int)min<INT64>(segment.bytes, MAX_FILE_CHUNK_BYTES);
+    int bytesSent = 0;
+    blocked = false;
+
+    if (!segment.useSplice)
     {
-        sendBuffer_.retrieve(bytesSent);
-        bytesSent_ += bytesSent;
+        off_t offset = (off_t)segment.offset;
+        ssize_t result = ::sendfile(getSocket().getHandle(), segment.fileHandle, &offset, maxBytes);
+        TcpInspectInfo::instance().sendFileSyscallCount.increment();
 
-        while (!sendTaskQueue_.empty())
+        if (result > 0)
         {
-            SendTask& task = sendTaskQueue_.front();
-            if (bytesSent_ >= task.bytes)
-            {
-                bytesSent_ -= task.bytes;
-
-				if (m_callback)
-				{
-					m_callback->onTcpSendComplete(shared_from_this(), task.context);
-				}
-                sendTaskQueue_.pop_front();
-            }
-            else
-                break;
+            bytesSent = (int)result;
+            segment.offset += result;
+            segment.bytes -= result;
+            blocked = (bytesSent < maxBytes);
+        }
+        else if (result < 0 && errno == EAGAIN)
+            blocked = true;
+        else if (result < 0 && (errno == EINVAL || errno == ENOSYS))
+        {
+            segment.useSplice = true;
+            TcpInspectInfo::instance().sendFileSpliceCount.increment();
         }
+        else if (result == 0 || errno != EINTR)
+            return fileSendFailed(result == 0 ? 0 : errno);
+    }
+
+    if (segment.useSplice)
+    {
+        bytesSent = spliceFileSegment(segment, maxBytes, blocked);
+        if (bytesSent < 0)
+            return bytesSent;
+    }
+
+    if (segment.bytes == 0 && splicePipeBytes_ == 0)
+        fileSegments_.pop_front();
+
+    return bytesSent;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 以 splice() 经管道将文件数据转发到套接字 (不经过用户空间)
+// 备注:
+//   管道为空时先从文件读入最多 maxBytes 字节，再从管道发往套接字。管道中未能
+//   发出的数据留待下一次可发送事件。
+//-----------------------------------------------------------------------------
+int LinuxTcpConnection::spliceFileSegment(FileSegment& segment, int maxBytes, bool& blocked)
+{
+    if (splicePipe_[0] < 0 && ::pipe2(splicePipe_, O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        splicePipe_[0] = splicePipe_[1] = -1;
+        return fileSendFailed(errno);
+    }
+
+    if (splicePipeBytes_ == 0 && segment.bytes > 0)
+    {
+        loff_t offset = (loff_t)segment.offset;
+        ssize_t result = ::splice(segment.fileHandle, &offset, splicePipe_[1], NULL,
+            maxBytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        TcpInspectInfo::instance().sendFileSyscallCount.increment();
+        if (result <= 0)
+            return fileSendFailed(result == 0 ? 0 : errno);
+
+        segment.offset += result;
+        segment.bytes -= result;
+        splicePipeBytes_ = (int)result;
     }
+
+    ssize_t result = ::splice(splicePipe_[0], NULL, getSocket().getHandle(), NULL,
+        splicePipeBytes_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    TcpInspectInfo::instance().sendFileSyscallCount.increment();
+    if (result < 0)
+    {
+        if (errno == EAGAIN)
+            blocked = true;
+        else if (errno != EINTR)
+            return fileSendFailed(errno);
+        return 0;
+    }
+
+    splicePipeBytes_ -= (int)result;
+    blocked = (splicePipeBytes_ > 0);
+    return (int)result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 发送文件数据失败 (由调用者调用 errorOccurred())
+// 参数:
+//   errorCode - 错误码 (0 表示文件的实际长度不足)
+// 返回: -1
+//-----------------------------------------------------------------------------
+int LinuxTcpConnection::fileSendFailed(int errorCode)
+{
+    // 对方断开连接属于正常情况，不记录日志
+    if (errorCode != EPIPE && errorCode != ECONNRESET)
+        WARN_LOG(SEM_SEND_FILE_ERROR, errorCode, getConnectionName().c_str());
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 从发送队列头部移除已发出的数据
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::retrieveQueuedData(int bytes)
+{
+    sendQueue_.retrieve(bytes);
+
+    for (FileSegments::iterator iter = fileSegments_.begin(); iter != fileSegments_.end(); ++iter)
+        iter->queuedBytesBefore -= bytes;
 }
 
 //-----------------------------------------------------------------------------
 // 描述: 当“可接收”事件到来时，尝试接收数据
+// 备注:
+//   1. 以 readv() 直接读入 recvBuffer_ 的可写空间 (存储块取自事件循环的块池)，
+//      仅当数据超出该空间时才用到栈上的溢出缓存。recvBuffer_ 预留的空间大小
+//      (recvSizeHint_) 根据历史读取量自适应调整: 读满则加倍，连续读得很少则减半。
+//   2. 边缘触发模式下，持续接收直至内核接收缓存读空 (EAGAIN)。若本次事件中读取
+//      的字节数超过了 maxRecvBytesPerEvent，则将剩余的接收工作委托给下一轮事件
+//      循环，以免单个繁忙连接饿死同一事件循环中的其它连接。
 //-----------------------------------------------------------------------------
 void LinuxTcpConnection::tryRecv()
 {
-	const int MAX_BUFFER_SIZE = max(1024 * 16, m_maxbuffszie);
-    if (recvTaskQueue_.empty() && recvBuffer_.getReadableBytes() >= MAX_BUFFER_SIZE)
+    const int recvHighWaterMark = getRecvHighWaterMark();
+    const int OVERFLOW_BUFFER_SIZE = 1024*64;
+    const bool edgeTriggered = getEventLoop()->isEdgeTriggered();
+    const int recvBudget = getEventLoop()->getMaxRecvBytesPerEvent();
+    int totalRecved = 0;
+
+    while (true)
     {
-        setRecvEnabled(false);
-        return;
+        if (isRecvPausedBySend() ||
+            (recvTaskQueue_.empty() && recvBuffer_.getReadableBytes() >= recvHighWaterMark))
+        {
+            setRecvEnabled(false);
+            return;
+        }
+
+        char overflowBuf[OVERFLOW_BUFFER_SIZE];
+
+        recvBuffer_.reserveWritable(recvSizeHint_);
+        int writableBytes = recvBuffer_.getWritableBytes();
+
+        struct iovec iov[2];
+        iov[0].iov_base = recvBuffer_.getWritePtr();
+        iov[0].iov_len = writableBytes;
+        iov[1].iov_base = overflowBuf;
+        iov[1].iov_len = OVERFLOW_BUFFER_SIZE;
+
+        const int bytesWanted = writableBytes + OVERFLOW_BUFFER_SIZE;
+        int bytesRecved = recvBufferV(iov, 2);
+        if (bytesRecved < 0)
+        {
+            errorOccurred();
+            return;
+        }
+
+        if (bytesRecved <= writableBytes)
+            recvBuffer_.commitWrite(bytesRecved);
+        else
+        {
+            recvBuffer_.commitWrite(writableBytes);
+            recvBuffer_.append(overflowBuf, bytesRecved - writableBytes);
+        }
+
+        adjustRecvSizeHint(bytesRecved);
+
+        while (!recvTaskQueue_.empty())
+        {
+            bool packetRecved = tryRetrievePacket();
+            if (!packetRecved)
+                break;
+        }
+
+        // 未读到数据 (或数据已全部取走) 时归还存储块，空闲连接不占用缓存
+        recvBuffer_.shrinkIfIdle();
+
+        // 读到的数据不足缓存大小，说明内核接收缓存已读空
+        if (!edgeTriggered || bytesRecved < bytesWanted || isErrorOccurred_)
+            break;
+
+        totalRecved += bytesRecved;
+        if (totalRecved >= recvBudget)
+        {
+            getEventLoop()->delegateToLoop(std::bind(
+                &LinuxTcpConnection::afterRecvBudgetExhausted, shared_from_this()));
+            break;
+        }
     }
+}
 
-    const int BUFFER_SIZE = 1024*16;
-    char dataBuf[BUFFER_SIZE];
+//-----------------------------------------------------------------------------
+// 描述: 处理 io_uring 后端收到的数据
+// 参数:
+//   data  - 内核写入接收缓存环的数据 (回调返回后即被回收，须复制)
+//   bytes - 数据字节数，<= 0 表示对端已关闭连接或发生错误
+// 备注:
+//   与 tryRecv() 不同，数据已由内核读出，即使接收已暂停也须放入 recvBuffer_。
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::processRecvData(const char *data, int bytes)
+{
+    if (isErrorOccurred_) return;
 
-    int bytesRecved = recvBuffer(dataBuf, BUFFER_SIZE, false);
-    if (bytesRecved < 0)
+    if (bytes <= 0)
     {
         errorOccurred();
         return;
     }
 
-    if (bytesRecved > 0)
-        recvBuffer_.append(dataBuf, bytesRecved);
+    recvBuffer_.append(data, bytes);
+
+    while (!recvTaskQueue_.empty())
+    {
+        bool packetRecved = tryRetrievePacket();
+        if (!packetRecved)
+            break;
+    }
+
+    recvBuffer_.shrinkIfIdle();
+
+    if (enableRecv_ && !isErrorOccurred_ && (isRecvPausedBySend() ||
+        (recvTaskQueue_.empty() && recvBuffer_.getReadableBytes() >= getRecvHighWaterMark())))
+        setRecvEnabled(false);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 若接收已暂停且暂停条件已解除，则恢复接收
+// 备注:
+//   有接收任务在等待数据，或接收缓存已回落到低水位时才恢复，以免在高水位附近
+//   反复暂停和恢复。
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::resumeRecvIfNeeded()
+{
+    if (enableRecv_ || isErrorOccurred_ || eventLoop_ == NULL || isRecvPausedBySend())
+        return;
+
+    if (!recvTaskQueue_.empty() || recvBuffer_.getReadableBytes() <= getRecvLowWaterMark())
+        setRecvEnabled(true);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 接收队列的队首任务被移除 (如退出连续接收模式) 后，处理已缓存的数据
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::recvTaskQueueChanged()
+{
+    if (isErrorOccurred_) return;
 
     while (!recvTaskQueue_.empty())
     {
@@ -1451,6 +3751,66 @@ void LinuxTcpConnection::tryRecv()
         if (!packetRecved)
             break;
     }
+
+    recvBuffer_.shrinkIfIdle();
+    resumeRecvIfNeeded();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 发送缓存越过高水位或回落到低水位后，暂停或恢复接收
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::sendWaterMarkChanged()
+{
+    if (isRecvPausedBySend())
+    {
+        if (enableRecv_)
+            setRecvEnabled(false);
+    }
+    else
+        resumeRecvIfNeeded();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 开始批量发送
+// 备注: 即使用户没有调用 flush()，也会在本轮事件循环的末尾自动 flush。
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::doBeginBatch()
+{
+    if (batching_) return;
+
+    batching_ = true;
+    TcpInspectInfo::instance().sendBatchCount.increment();
+
+    if (!batchFlushPending_)
+    {
+        batchFlushPending_ = true;
+        getEventLoop()->addFinalizer(std::bind(
+            &LinuxTcpConnection::afterBatchEnd, shared_from_this()));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 结束批量发送，以一次 sendmsg() 发出积压的数据
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::doFlush()
+{
+    if (!batching_) return;
+
+    batching_ = false;
+    TcpInspectInfo::instance().sendBatchFlushCount.increment();
+
+    flushSendQueue(false);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 根据本次读取的字节数调整下次预留的接收空间
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::adjustRecvSizeHint(int bytesRecved)
+{
+    if (bytesRecved >= recvSizeHint_)
+        recvSizeHint_ = min(recvSizeHint_ * 2, (int)MAX_RECV_SIZE_HINT);
+    else if (bytesRecved < recvSizeHint_ / 4)
+        recvSizeHint_ = max(recvSizeHint_ / 2, (int)MIN_RECV_SIZE_HINT);
 }
 
 //-----------------------------------------------------------------------------
@@ -1465,11 +3825,22 @@ bool LinuxTcpConnection::tryRetrievePacket()
     const char *buffer = recvBuffer_.peek();
     int readableBytes = recvBuffer_.getReadableBytes();
 
-    if (readableBytes > 0)
+    if (readableBytes > 0 && task.continuous)
+    {
+        // 连续接收任务一次取出全部完整数据包，且留在队首
+        int retrievedBytes = retrievePacketBatch(task, buffer, readableBytes);
+        if (retrievedBytes < 0)
+            framingErrorOccurred();
+        else
+            recvBuffer_.retrieve(retrievedBytes);
+    }
+    else if (readableBytes > 0)
     {
         int packetSize = 0;
-        task.packetSplitter(buffer, readableBytes, packetSize);
-        if (packetSize > 0)
+        task.splitPacket(buffer, readableBytes, packetSize);
+        if (packetSize < 0)
+            framingErrorOccurred();
+        else if (packetSize > 0)
         {
 			if (m_callback)
 			{
@@ -1477,6 +3848,7 @@ bool LinuxTcpConnection::tryRetrievePacket()
 					(void*)buffer, packetSize, task.context);
 			}
             recvTaskQueue_.pop_front();
+            updateRecvTimer();
             recvBuffer_.retrieve(packetSize);
             result = true;
         }
@@ -1492,15 +3864,67 @@ void LinuxTcpConnection::afterPostRecvTask(const TcpConnectionPtr& thisObj)
 {
     LinuxTcpConnection *thisPtr = static_cast<LinuxTcpConnection*>(thisObj.get());
     if (!thisPtr->isErrorOccurred_)
+    {
         thisPtr->tryRetrievePacket();
+        thisPtr->resumeRecvIfNeeded();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 在直接发送 (tryDirectSend()、flushSendQueue()) 之后，于本轮事件循环的末尾执行发送完成回调
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::afterDirectSend(const TcpConnectionPtr& thisObj)
+{
+    LinuxTcpConnection *thisPtr = static_cast<LinuxTcpConnection*>(thisObj.get());
+    thisPtr->sendCompletePending_ = false;
+    if (!thisPtr->isErrorOccurred_)
+        thisPtr->processSendComplete();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 本轮事件循环结束时，自动 flush 尚未结束的批量发送
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::afterBatchEnd(const TcpConnectionPtr& thisObj)
+{
+    LinuxTcpConnection *thisPtr = static_cast<LinuxTcpConnection*>(thisObj.get());
+    thisPtr->batchFlushPending_ = false;
+    thisPtr->doFlush();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 边缘触发模式下，单次事件的接收预算用完后，在下一轮事件循环中继续接收
+//-----------------------------------------------------------------------------
+void LinuxTcpConnection::afterRecvBudgetExhausted(const TcpConnectionPtr& thisObj)
+{
+    LinuxTcpConnection *thisPtr = static_cast<LinuxTcpConnection*>(thisObj.get());
+    if (!thisPtr->isErrorOccurred_ && thisPtr->getEventLoop() != NULL && thisPtr->enableRecv_)
+        thisPtr->tryRecv();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // class LinuxTcpEventLoop
 
-LinuxTcpEventLoop::LinuxTcpEventLoop()
+LinuxTcpEventLoop::LinuxTcpEventLoop(const IoServiceOptions& options) :
+    maxRecvBytesPerEvent_(max(options.maxRecvBytesPerEvent, 1024*16))
 {
+    epollObject_->setEdgeTriggered(options.edgeTriggered);
     epollObject_->setNotifyEventCallback(std::bind(&LinuxTcpEventLoop::onEpollNotifyEvent, this, std::placeholders::_1, std::placeholders::_2));
+
+    if (options.ioBackend == IoServiceOptions::IOB_URING)
+    {
+        uringObject_ = new UringObject(this);
+        if (uringObject_->init(options.uringQueueDepth,
+            options.uringRecvBufferCount, options.uringRecvBufferSize))
+        {
+            uringObject_->setNotifyEventCallback(std::bind(&LinuxTcpEventLoop::onEpollNotifyEvent, this, std::placeholders::_1, std::placeholders::_2));
+            uringObject_->setRecvDataCallback(std::bind(&LinuxTcpEventLoop::onUringRecvData, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+        }
+        else
+        {
+            delete uringObject_;
+            uringObject_ = NULL;
+        }
+    }
 }
 
 LinuxTcpEventLoop::~LinuxTcpEventLoop()
@@ -1513,7 +3937,44 @@ LinuxTcpEventLoop::~LinuxTcpEventLoop()
 //-----------------------------------------------------------------------------
 void LinuxTcpEventLoop::updateConnection(TcpConnection *connection, bool enableSend, bool enableRecv)
 {
-    epollObject_->updateConnection(connection, enableSend, enableRecv);
+    if (uringObject_)
+        uringObject_->updateConnection(connection, enableSend, enableRecv);
+    else
+        epollObject_->updateConnection(connection, enableSend, enableRecv);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 监视一个非连接类的套接字 (须在事件循环线程中调用)
+//-----------------------------------------------------------------------------
+void LinuxTcpEventLoop::watchHandle(SOCKET handle, bool enableSend, bool enableRecv,
+    const EpollObject::HandleEventCallback& callback)
+{
+    assertInLoopThread();
+    if (uringObject_)
+        uringObject_->watchHandle(handle, enableSend, enableRecv, callback);
+    else
+        epollObject_->watchHandle(handle, enableSend, enableRecv, callback);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 以 multishot accept 监视一个监听套接字 (仅 io_uring 后端，须在事件循环线程中调用)
+//-----------------------------------------------------------------------------
+void LinuxTcpEventLoop::watchAccept(SOCKET handle, const UringObject::AcceptCallback& callback)
+{
+    assertInLoopThread();
+    ASSERT_X(uringObject_ != NULL);
+    uringObject_->watchAccept(handle, callback);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取消对套接字的监视 (须在事件循环线程中调用，或事件循环尚未运行)
+//-----------------------------------------------------------------------------
+void LinuxTcpEventLoop::unwatchHandle(SOCKET handle)
+{
+    if (uringObject_)
+        uringObject_->unwatchHandle(handle);
+    else
+        epollObject_->unwatchHandle(handle);
 }
 
 //-----------------------------------------------------------------------------
@@ -1521,7 +3982,10 @@ void LinuxTcpEventLoop::updateConnection(TcpConnection *connection, bool enableS
 //-----------------------------------------------------------------------------
 void LinuxTcpEventLoop::registerConnection(TcpConnection *connection)
 {
-    epollObject_->addConnection(connection, false, false);
+    if (uringObject_)
+        uringObject_->addConnection(connection, false, false);
+    else
+        epollObject_->addConnection(connection, false, false);
 }
 
 //-----------------------------------------------------------------------------
@@ -1529,7 +3993,10 @@ void LinuxTcpEventLoop::registerConnection(TcpConnection *connection)
 //-----------------------------------------------------------------------------
 void LinuxTcpEventLoop::unregisterConnection(TcpConnection *connection)
 {
-    epollObject_->removeConnection(connection);
+    if (uringObject_)
+        uringObject_->removeConnection(connection);
+    else
+        epollObject_->removeConnection(connection);
 }
 
 //-----------------------------------------------------------------------------
@@ -1540,6 +4007,9 @@ void LinuxTcpEventLoop::onEpollNotifyEvent(BaseTcpConnection *connection,
 {
     LinuxTcpConnection *conn = static_cast<LinuxTcpConnection*>(connection);
 
+    if (conn->isErrorOccurred_ && eventType != EpollObject::ET_ERROR)
+        return;
+
     if (eventType == EpollObject::ET_ALLOW_SEND)
         conn->trySend();
     else if (eventType == EpollObject::ET_ALLOW_RECV)
@@ -1548,6 +4018,15 @@ void LinuxTcpEventLoop::onEpollNotifyEvent(BaseTcpConnection *connection,
         conn->errorOccurred();
 }
 
+//-----------------------------------------------------------------------------
+// 描述: io_uring 接收完成回调
+//-----------------------------------------------------------------------------
+void LinuxTcpEventLoop::onUringRecvData(BaseTcpConnection *connection,
+    const char *data, int bytes)
+{
+    static_cast<LinuxTcpConnection*>(connection)->processRecvData(data, bytes);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #endif  /* ifdef _COMPILER_LINUX */
@@ -0,0 +1,567 @@
+///////////////////////////////////////////////////////////////////////////////
+// 文件名称: TcpConnectionPool.cpp
+// 功能描述: 出站连接池
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TcpConnectionPool.h"
+#include "SysUtils.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// class TcpConnectionPool
+
+TcpConnectionPool::TcpConnectionPool(std::shared_ptr<IoService> service,
+    TcpCallbacks *callback, const TcpConnectionPoolOptions& options) :
+    ioService_(service),
+    callback_(callback),
+    options_(options),
+    connector_(service),
+    timerLoop_(NULL),
+    healthCheckTimerId_(0)
+{
+    ASSERT_X(callback != NULL);
+
+    options_.minConnections = max(options_.minConnections, 0);
+    options_.maxConnections = max(options_.maxConnections, max(options_.minConnections, 1));
+    options_.reconnectBaseDelay = max(options_.reconnectBaseDelay, 1);
+    options_.reconnectMaxDelay = max(options_.reconnectMaxDelay, options_.reconnectBaseDelay);
+
+    TcpEventLoopList& loopList = ioService_->GetTcpEventLoopList();
+    if (loopList.getCount() > 0 && options_.healthCheckInterval > 0)
+    {
+        timerLoop_ = loopList[0];
+        healthCheckTimerId_ = timerLoop_->executeEvery(options_.healthCheckInterval,
+            std::bind(&TcpConnectionPool::onHealthCheckTimer, this));
+    }
+}
+
+TcpConnectionPool::~TcpConnectionPool()
+{
+    // 定时器回调引用了 this，须等待事件循环真正撤销定时器后才能继续析构
+    if (timerLoop_ != NULL && healthCheckTimerId_ != 0)
+    {
+        if (timerLoop_->isRunning() && !timerLoop_->isInLoopThread())
+        {
+            Semaphore semaphore;
+            timerLoop_->delegateToLoop(std::bind(&TcpConnectionPool::cancelTimerInLoop,
+                timerLoop_, healthCheckTimerId_, &semaphore));
+            semaphore.wait();
+        }
+        else
+            cancelTimerInLoop(timerLoop_, healthCheckTimerId_, NULL);
+    }
+
+    connector_.clear();
+
+    PoolEntries entries;
+    {
+        AutoLocker locker(mutex_);
+        for (EndpointMap::iterator iter = endpoints_.begin(); iter != endpoints_.end(); ++iter)
+        {
+            Endpoint *endpoint = iter->second;
+            entries.insert(entries.end(), endpoint->entries.begin(), endpoint->entries.end());
+            delete endpoint;
+        }
+        endpoints_.clear();
+    }
+
+    disconnectEntries(entries);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 添加一个端点，并立即建立 minConnections 条连接
+//-----------------------------------------------------------------------------
+void TcpConnectionPool::addEndpoint(const InetAddress& peerAddr)
+{
+    int dialCount = 0;
+
+    {
+        AutoLocker locker(mutex_);
+        if (findEndpoint(peerAddr) != NULL)
+            return;
+
+        Endpoint *endpoint = new Endpoint();
+        endpoint->peerAddr = peerAddr;
+        endpoint->dialingCount = 0;
+        endpoint->failureCount = 0;
+        endpoint->nextDialTicks = 0;
+        endpoint->rrIndex = 0;
+        endpoints_[makeEndpointKey(peerAddr)] = endpoint;
+
+        dialCount = prepareDial(*endpoint, options_.minConnections);
+    }
+
+    dial(peerAddr, dialCount);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 移除一个端点，并断开其全部连接
+// 备注: 此时仍在建立中的连接建立后即被断开。
+//-----------------------------------------------------------------------------
+void TcpConnectionPool::removeEndpoint(const InetAddress& peerAddr)
+{
+    PoolEntries entries;
+
+    {
+        AutoLocker locker(mutex_);
+        EndpointMap::iterator iter = endpoints_.find(makeEndpointKey(peerAddr));
+        if (iter == endpoints_.end())
+            return;
+
+        Endpoint *endpoint = iter->second;
+        entries.swap(endpoint->entries);
+        endpoints_.erase(iter);
+        delete endpoint;
+    }
+
+    disconnectEntries(entries);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 借出指定端点上借出次数最少的连接
+// 返回: 连接，端点不存在或尚无可用连接时返回空
+// 备注:
+//   已越过发送高水位的连接仅在没有其它连接可用时借出。全部连接均已借出 (或尚无
+//   连接) 且未达 maxConnections 时，追加建立一条连接 (受重连退避的限制)。
+//-----------------------------------------------------------------------------
+TcpConnectionPtr TcpConnectionPool::acquire(const InetAddress& peerAddr)
+{
+    TcpConnectionPtr result;
+    int dialCount = 0;
+
+    {
+        AutoLocker locker(mutex_);
+        Endpoint *endpoint = findEndpoint(peerAddr);
+        if (endpoint == NULL)
+            return result;
+
+        int count = (int)endpoint->entries.size();
+        int start = (count > 0 ? (int)(endpoint->rrIndex++ % (UINT)count) : 0);
+        PoolEntry *best = NULL;
+
+        for (int i = 0; i < count; ++i)
+        {
+            PoolEntry& entry = endpoint->entries[(start + i) % count];
+            if (best == NULL)
+                best = &entry;
+            else if (entry.connection->isSendHighWater() != best->connection->isSendHighWater())
+            {
+                if (!entry.connection->isSendHighWater())
+                    best = &entry;
+            }
+            else if (entry.leaseCount < best->leaseCount)
+                best = &entry;
+        }
+
+        if (best != NULL)
+        {
+            best->leaseCount++;
+            result = best->connection;
+        }
+
+        if (best == NULL || best->leaseCount > 1)
+            dialCount = prepareDial(*endpoint, 1);
+    }
+
+    dial(peerAddr, dialCount);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 归还由 acquire() 借出的连接
+//-----------------------------------------------------------------------------
+void TcpConnectionPool::release(const TcpConnectionPtr& connection)
+{
+    if (!connection) return;
+
+    AutoLocker locker(mutex_);
+    Endpoint *endpoint = findEndpoint(connection->getPeerAddr());
+    if (endpoint == NULL) return;
+
+    for (size_t i = 0; i < endpoint->entries.size(); ++i)
+    {
+        PoolEntry& entry = endpoint->entries[i];
+        if (entry.connection == connection)
+        {
+            if (entry.leaseCount > 0)
+                entry.leaseCount--;
+            break;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 设置用户的健康检查
+//-----------------------------------------------------------------------------
+void TcpConnectionPool::setHealthProbe(const HealthProbe& probe)
+{
+    AutoLocker locker(mutex_);
+    healthProbe_ = probe;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得指定端点上已建立的连接数
+//-----------------------------------------------------------------------------
+int TcpConnectionPool::getConnectionCount(const InetAddress& peerAddr)
+{
+    AutoLocker locker(mutex_);
+    Endpoint *endpoint = findEndpoint(peerAddr);
+    return (endpoint != NULL ? (int)endpoint->entries.size() : 0);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得各端点的状态 (每行一个端点)
+//-----------------------------------------------------------------------------
+std::string TcpConnectionPool::getStatusReport()
+{
+    std::string result;
+    AutoLocker locker(mutex_);
+
+    UINT64 now = getCurTicks();
+    for (EndpointMap::iterator iter = endpoints_.begin(); iter != endpoints_.end(); ++iter)
+    {
+        Endpoint *endpoint = iter->second;
+
+        int leaseCount = 0;
+        for (size_t i = 0; i < endpoint->entries.size(); ++i)
+            leaseCount += endpoint->entries[i].leaseCount;
+
+        UINT64 backoff = 0;
+        if (endpoint->nextDialTicks > now)
+            backoff = endpoint->nextDialTicks - now;
+
+        result += formatString("%s: connections=%d, dialing=%d, leases=%d, failures=%d, backoff_ms=%d\n",
+            endpoint->peerAddr.getDisplayStr().c_str(), (int)endpoint->entries.size(),
+            endpoint->dialingCount, leaseCount, endpoint->failureCount, (int)backoff);
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 连接已加入事件循环
+// 备注:
+//   端点已被移除或连接数已达上限时，直接断开此连接。被拒绝的连接不会转给
+//   callback_ (其 onTcpConnected/onTcpDisconnected 均不会被调用)。
+//-----------------------------------------------------------------------------
+void TcpConnectionPool::onTcpConnected(const TcpConnectionPtr& connection)
+{
+    bool accepted = false;
+
+    {
+        AutoLocker locker(mutex_);
+        Endpoint *endpoint = findEndpoint(connection->getPeerAddr());
+        if (endpoint != NULL)
+        {
+            if (endpoint->dialingCount > 0)
+                endpoint->dialingCount--;
+
+            if ((int)endpoint->entries.size() < options_.maxConnections)
+            {
+                PoolEntry entry;
+                entry.connection = connection;
+                entry.leaseCount = 0;
+                entry.connectedTicks = getCurTicks();
+                endpoint->entries.push_back(entry);
+                acceptedConnections_.insert(connection.get());
+                accepted = true;
+            }
+        }
+    }
+
+    if (accepted)
+        callback_->onTcpConnected(connection);
+    else
+        connection->disconnect();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 连接已断开
+// 备注:
+//   随机延迟后再由健康检查补充连接，以免对端重启时所有连接同时重连。
+//   连接已先行移出连接池 (如端点被移除、健康检查失败) 时 removeEntry() 找不到它，
+//   故是否转给 callback_ 以 acceptedConnections_ 为准。
+//-----------------------------------------------------------------------------
+void TcpConnectionPool::onTcpDisconnected(const TcpConnectionPtr& connection)
+{
+    removeEntry(connection);
+
+    bool accepted;
+    {
+        AutoLocker locker(mutex_);
+        accepted = (acceptedConnections_.erase(connection.get()) > 0);
+    }
+
+    if (accepted)
+        callback_->onTcpDisconnected(connection);
+}
+
+//-----------------------------------------------------------------------------
+
+void TcpConnectionPool::onTcpRecvComplete(const TcpConnectionPtr& connection,
+    void *packetBuffer, int packetSize, const Context& context)
+{
+    callback_->onTcpRecvComplete(connection, packetBuffer, packetSize, context);
+}
+
+//-----------------------------------------------------------------------------
+
+void TcpConnectionPool::onTcpSendComplete(const TcpConnectionPtr& connection,
+    const Context& context)
+{
+    callback_->onTcpSendComplete(connection, context);
+}
+
+//-----------------------------------------------------------------------------
+
+void TcpConnectionPool::onTcpRecvBatch(const TcpConnectionPtr& connection,
+    const TcpPacketView *packets, int count, const Context& context)
+{
+    callback_->onTcpRecvBatch(connection, packets, count, context);
+}
+
+//-----------------------------------------------------------------------------
+
+void TcpConnectionPool::onTcpHighWaterMark(const TcpConnectionPtr& connection,
+    int pendingBytes)
+{
+    callback_->onTcpHighWaterMark(connection, pendingBytes);
+}
+
+//-----------------------------------------------------------------------------
+
+void TcpConnectionPool::onTcpWriteDrained(const TcpConnectionPtr& connection)
+{
+    callback_->onTcpWriteDrained(connection);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: TcpConnector 的连接完成回调
+// 备注:
+//   成功的连接随后经 onTcpConnected() 加入连接池。此时并不清除失败记录，须待连接
+//   稳定存活 minStableTime 后 (见 onHealthCheckTimer())。
+//-----------------------------------------------------------------------------
+void TcpConnectionPool::onConnectComplete(bool success, TcpConnection *connection,
+    const InetAddress& peerAddr, const Context& context)
+{
+    if (success) return;
+
+    AutoLocker locker(mutex_);
+    Endpoint *endpoint = findEndpoint(peerAddr);
+    if (endpoint == NULL) return;
+
+    if (endpoint->dialingCount > 0)
+        endpoint->dialingCount--;
+    endpoint->failureCount++;
+    endpoint->nextDialTicks = getCurTicks() + calcBackoffDelay(endpoint->failureCount);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 健康检查定时器 (在第一个事件循环线程中执行)
+// 备注:
+//   先在锁外检查各连接 (用户的 HealthProbe 可能较慢或再次调用连接池)，再移除
+//   不健康的连接并补足各端点的连接。
+//-----------------------------------------------------------------------------
+void TcpConnectionPool::onHealthCheckTimer()
+{
+    PoolEntries checkList, evictedList;
+    HealthProbe probe;
+    DialList dialList;
+
+    {
+        AutoLocker locker(mutex_);
+        for (EndpointMap::iterator iter = endpoints_.begin(); iter != endpoints_.end(); ++iter)
+        {
+            const PoolEntries& entries = iter->second->entries;
+            checkList.insert(checkList.end(), entries.begin(), entries.end());
+        }
+        probe = healthProbe_;
+    }
+
+    for (size_t i = 0; i < checkList.size(); ++i)
+    {
+        if (!isConnectionHealthy(checkList[i].connection, probe))
+            evictedList.push_back(checkList[i]);
+    }
+
+    for (size_t i = 0; i < evictedList.size(); ++i)
+        removeEntry(evictedList[i].connection);
+
+    {
+        AutoLocker locker(mutex_);
+        UINT64 now = getCurTicks();
+        for (EndpointMap::iterator iter = endpoints_.begin(); iter != endpoints_.end(); ++iter)
+        {
+            Endpoint& endpoint = *iter->second;
+
+            // 有连接已稳定存活时清除失败记录
+            for (size_t i = 0; i < endpoint.entries.size() && endpoint.failureCount > 0; ++i)
+            {
+                if (getTickDiff(endpoint.entries[i].connectedTicks, now) >= (UINT64)options_.minStableTime)
+                    endpoint.failureCount = 0;
+            }
+
+            int missing = options_.minConnections -
+                ((int)endpoint.entries.size() + endpoint.dialingCount);
+
+            int dialCount = prepareDial(endpoint, missing);
+            if (dialCount > 0)
+                dialList.push_back(std::make_pair(endpoint.peerAddr, dialCount));
+        }
+    }
+
+    disconnectEntries(evictedList);
+    dial(dialList);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 检查连接是否健康
+// 备注: Linux 下以 TCP_INFO 检查连接状态 (读取 SO_ERROR 会清除事件循环尚未处理的错误)。
+//-----------------------------------------------------------------------------
+bool TcpConnectionPool::isConnectionHealthy(const TcpConnectionPtr& connection,
+    const HealthProbe& probe)
+{
+    SOCKET handle = connection->getSocket().getHandle();
+
+#ifdef _COMPILER_WIN
+    int errorCode = 0;
+    socklen_t errLen = sizeof(int);
+    if (getsockopt(handle, SOL_SOCKET, SO_ERROR, (char*)&errorCode, &errLen) < 0 || errorCode != 0)
+        return false;
+#endif
+#ifdef _COMPILER_LINUX
+    struct tcp_info info;
+    socklen_t infoLen = sizeof(info);
+    if (getsockopt(handle, IPPROTO_TCP, TCP_INFO, &info, &infoLen) < 0 ||
+        info.tcpi_state != TCP_ESTABLISHED)
+        return false;
+#endif
+
+    return !probe || probe(connection);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 将连接移出连接池
+// 返回: 连接是否在连接池中
+// 备注:
+//   移出后随机延迟一个初始退避时间再补充连接。连接存活不足 minStableTime 时计为
+//   一次失败，按失败次数退避。
+//-----------------------------------------------------------------------------
+bool TcpConnectionPool::removeEntry(const TcpConnectionPtr& connection)
+{
+    AutoLocker locker(mutex_);
+    Endpoint *endpoint = findEndpoint(connection->getPeerAddr());
+    if (endpoint == NULL) return false;
+
+    PoolEntries& entries = endpoint->entries;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (entries[i].connection == connection)
+        {
+            UINT64 now = getCurTicks();
+            int failureCount = 0;
+            if (getTickDiff(entries[i].connectedTicks, now) < (UINT64)options_.minStableTime)
+                failureCount = ++endpoint->failureCount;
+
+            entries.erase(entries.begin() + i);
+            endpoint->nextDialTicks = max(endpoint->nextDialTicks,
+                now + calcBackoffDelay(failureCount));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 计算端点本次可以发起的连接数，并计入 dialingCount (须在锁内调用)
+// 参数:
+//   count - 希望发起的连接数
+// 备注:
+//   退避期间不发起连接；退避结束后若仍有连接失败的记录，只发起一条连接试探。
+//-----------------------------------------------------------------------------
+int TcpConnectionPool::prepareDial(Endpoint& endpoint, int count)
+{
+    if (count <= 0) return 0;
+    if (endpoint.nextDialTicks > getCurTicks()) return 0;
+
+    int room = options_.maxConnections - ((int)endpoint.entries.size() + endpoint.dialingCount);
+    count = min(count, room);
+    if (endpoint.failureCount > 0)
+        count = min(count, 1);
+
+    count = max(count, 0);
+    endpoint.dialingCount += count;
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 向指定端点发起 count 条连接 (须在锁外调用)
+//-----------------------------------------------------------------------------
+void TcpConnectionPool::dial(const InetAddress& peerAddr, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        connector_.connect(peerAddr, this,
+            std::bind(&TcpConnectionPool::onConnectComplete, this,
+                std::placeholders::_1, std::placeholders::_2,
+                std::placeholders::_3, std::placeholders::_4),
+            EMPTY_CONTEXT, options_.maxBuffSize, options_.connectTimeout);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void TcpConnectionPool::dial(const DialList& dialList)
+{
+    for (size_t i = 0; i < dialList.size(); ++i)
+        dial(dialList[i].first, dialList[i].second);
+}
+
+//-----------------------------------------------------------------------------
+
+void TcpConnectionPool::disconnectEntries(const PoolEntries& entries)
+{
+    for (size_t i = 0; i < entries.size(); ++i)
+        entries[i].connection->disconnect();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 计算第 failureCount 次失败后的重连延迟 (毫秒)
+// 备注: 延迟 delay 按失败次数指数增长，实际取 [delay/2, delay] 中的随机值。
+//-----------------------------------------------------------------------------
+UINT64 TcpConnectionPool::calcBackoffDelay(int failureCount)
+{
+    INT64 delay = options_.reconnectBaseDelay;
+    for (int i = 1; i < failureCount && delay < options_.reconnectMaxDelay; ++i)
+        delay *= 2;
+    delay = min(delay, (INT64)options_.reconnectMaxDelay);
+
+    INT64 half = delay / 2;
+    return (UINT64)(half + getRandom(0, (int)(delay - half)));
+}
+
+//-----------------------------------------------------------------------------
+
+TcpConnectionPool::Endpoint* TcpConnectionPool::findEndpoint(const InetAddress& peerAddr)
+{
+    EndpointMap::iterator iter = endpoints_.find(makeEndpointKey(peerAddr));
+    return (iter != endpoints_.end() ? iter->second : NULL);
+}
+
+//-----------------------------------------------------------------------------
+
+UINT64 TcpConnectionPool::makeEndpointKey(const InetAddress& peerAddr)
+{
+    return ((UINT64)peerAddr.ip << 16) | peerAddr.port;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 在事件循环线程中撤销定时器
+//-----------------------------------------------------------------------------
+void TcpConnectionPool::cancelTimerInLoop(EventLoop *eventLoop, TimerId timerId,
+    Semaphore *semaphore)
+{
+    eventLoop->cancelTimer(timerId);
+    if (semaphore)
+        semaphore->increase();
+}
@@ -9,6 +9,10 @@
 #include "LogManager.h"
 #include "TCPServer.h"
 
+#ifdef _COMPILER_WIN
+#include <intrin.h>
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // class Timer
 
@@ -159,6 +163,220 @@ void TimerQueue::clearTimers()
     timerIdMap_.clear();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// class TimingWheel
+
+//-----------------------------------------------------------------------------
+// 描述: 返回 value (非 0) 最低位的 1 的位置
+//-----------------------------------------------------------------------------
+static inline int countTrailingZeros(UINT64 value)
+{
+#ifdef _COMPILER_WIN
+    unsigned long index = 0;
+#if defined(_M_IX86)
+    // 32 位目标没有 _BitScanForward64，分低、高两半查找
+    if (_BitScanForward(&index, (unsigned long)value))
+        return (int)index;
+    _BitScanForward(&index, (unsigned long)(value >> 32));
+    return (int)index + 32;
+#else
+    _BitScanForward64(&index, value);
+    return (int)index;
+#endif
+#endif
+#ifdef _COMPILER_LINUX
+    return __builtin_ctzll(value);
+#endif
+}
+
+TimingWheel::TimingWheel(UINT64 curTicks, int slotCount) :
+    slotMask_(slotCount - 1),
+    currentTicks_(curTicks),
+    count_(0)
+{
+    ASSERT_X(slotCount >= 64 && (slotCount & (slotCount - 1)) == 0);
+
+    slots_.resize(slotCount);
+    for (int i = 0; i < slotCount; i++)
+    {
+        Entry *head = new Entry();
+        head->prev_ = head->next_ = head;
+        slots_[i] = head;
+    }
+
+    slotBits_.resize(slotCount / 64, 0);
+}
+
+TimingWheel::~TimingWheel()
+{
+    for (size_t i = 0; i < slots_.size(); i++)
+    {
+        Entry *head = slots_[i];
+        while (head->next_ != head)
+            unlink(head->next_);
+        head->prev_ = head->next_ = NULL;
+        delete head;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 布置定时项，使其在 expireTicks 时刻到期 (若已布置则重新布置)
+// 备注: 到期时刻早于当前时刻的定时项，在下一次 processExpired() 中即到期。
+//-----------------------------------------------------------------------------
+void TimingWheel::arm(Entry *entry, UINT64 expireTicks)
+{
+    if (entry->wheel_)
+        entry->wheel_->disarm(entry);
+
+    if (expireTicks <= currentTicks_)
+        expireTicks = currentTicks_ + 1;
+
+    int slot = (int)(expireTicks & slotMask_);
+    entry->expireTicks_ = expireTicks;
+    entry->slot_ = slot;
+    entry->wheel_ = this;
+    link(slots_[slot], entry);
+    setSlotBit(slot, true);
+    count_++;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 撤销定时项
+//-----------------------------------------------------------------------------
+void TimingWheel::disarm(Entry *entry)
+{
+    if (entry->wheel_ != this) return;
+
+    int slot = entry->slot_;
+    unlink(entry);
+    entry->wheel_ = NULL;
+    entry->slot_ = -1;
+    count_--;
+
+    if (slot >= 0 && slots_[slot]->next_ == slots_[slot])
+        setSlotBit(slot, false);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 执行 (currentTicks_, curTicks] 内到期的定时项的回调
+// 备注:
+//   先将到期项全部移入临时链表再逐个回调，回调中可以任意布置或撤销定时项
+//   (包括尚未回调的到期项)。
+//-----------------------------------------------------------------------------
+void TimingWheel::processExpired(UINT64 curTicks)
+{
+    if (curTicks <= currentTicks_) return;
+
+    Entry expired;
+    expired.prev_ = expired.next_ = &expired;
+
+    UINT64 tickCount = min(curTicks - currentTicks_, (UINT64)slots_.size());
+    int slot = (int)((currentTicks_ + 1) & slotMask_);
+
+    for (UINT64 i = 0; i < tickCount; i++, slot = (slot + 1) & slotMask_)
+    {
+        if ((slotBits_[slot / 64] & ((UINT64)1 << (slot % 64))) == 0)
+            continue;
+
+        Entry *head = slots_[slot];
+        Entry *entry = head->next_;
+        while (entry != head)
+        {
+            Entry *next = entry->next_;
+            if (entry->expireTicks_ <= curTicks)
+            {
+                unlink(entry);
+                entry->slot_ = -1;
+                link(&expired, entry);
+            }
+            entry = next;
+        }
+
+        if (head->next_ == head)
+            setSlotBit(slot, false);
+    }
+
+    currentTicks_ = curTicks;
+
+    while (expired.next_ != &expired)
+    {
+        Entry *entry = expired.next_;
+        disarm(entry);
+        if (entry->callback_)
+            entry->callback_();
+    }
+
+    expired.prev_ = expired.next_ = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 返回距离下一个非空槽到期还有多少毫秒 (无定时项时返回 TIMEOUT_INFINITE)
+// 备注: 非空槽中可能只有下一圈才到期的定时项，此时只是提前醒来一次。
+//-----------------------------------------------------------------------------
+int TimingWheel::getWaitTimeout(UINT64 curTicks) const
+{
+    if (count_ == 0) return TIMEOUT_INFINITE;
+
+    int distance = findNextSlotDistance((int)((currentTicks_ + 1) & slotMask_));
+    UINT64 nextTicks = currentTicks_ + 1 + distance;
+
+    return (nextTicks <= curTicks) ? 0 : (int)(nextTicks - curTicks);
+}
+
+//-----------------------------------------------------------------------------
+
+void TimingWheel::link(Entry *head, Entry *entry)
+{
+    entry->prev_ = head->prev_;
+    entry->next_ = head;
+    head->prev_->next_ = entry;
+    head->prev_ = entry;
+}
+
+//-----------------------------------------------------------------------------
+
+void TimingWheel::unlink(Entry *entry)
+{
+    entry->prev_->next_ = entry->next_;
+    entry->next_->prev_ = entry->prev_;
+    entry->prev_ = entry->next_ = NULL;
+}
+
+//-----------------------------------------------------------------------------
+
+void TimingWheel::setSlotBit(int slot, bool value)
+{
+    UINT64 mask = (UINT64)1 << (slot % 64);
+    if (value)
+        slotBits_[slot / 64] |= mask;
+    else
+        slotBits_[slot / 64] &= ~mask;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 从 startSlot 开始 (循环) 查找第一个非空槽，返回其与 startSlot 的距离
+//-----------------------------------------------------------------------------
+int TimingWheel::findNextSlotDistance(int startSlot) const
+{
+    const int wordCount = (int)slotBits_.size();
+    int word = startSlot / 64;
+    UINT64 bits = slotBits_[word] & (~(UINT64)0 << (startSlot % 64));
+
+    for (int i = 0; i <= wordCount; i++)
+    {
+        if (bits != 0)
+        {
+            int slot = word * 64 + countTrailingZeros(bits);
+            return (slot - startSlot + (int)slots_.size()) & slotMask_;
+        }
+
+        word = (word + 1) % wordCount;
+        bits = slotBits_[word];
+    }
+
+    return slotMask_;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // class TimerManager
 
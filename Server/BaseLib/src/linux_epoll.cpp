@@ -8,6 +8,7 @@
 #include "ErrMsgs.h"
 #include "LogManager.h"
 #include "EventLoop.h"
+#include "TCPServer.h"
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -18,16 +19,23 @@
 // class EpollObject
 
 EpollObject::EpollObject(EventLoop *eventLoop) :
-    eventLoop_(eventLoop)
+    eventLoop_(eventLoop),
+    wakeupFd_(-1),
+    edgeTriggered_(false)
 {
     events_.resize(INITIAL_EVENT_SIZE);
     createEpoll();
-    createPipe();
+    createWakeupFd();
 }
 
 EpollObject::~EpollObject()
 {
-    destroyPipe();
+    for (HandleWatcherMap::iterator iter = watchers_.begin(); iter != watchers_.end(); ++iter)
+        retiredWatchers_.push_back(iter->second);
+    watchers_.clear();
+    clearRetiredWatchers();
+
+    destroyWakeupFd();
     destroyEpoll();
 }
 
@@ -38,7 +46,11 @@ void EpollObject::poll()
 {
     int timeout = eventLoop_->calcLoopWaitTimeout();
 
+    flushPendingChanges();
+    clearRetiredWatchers();
+
     int eventCount = ::epoll_wait(epollFd_, &events_[0], (int)events_.size(), timeout);
+    eventLoop_->endLoopWait();
 
     if (timeout != TIMEOUT_INFINITE)
         eventLoop_->processExpiredTimers();
@@ -58,11 +70,22 @@ void EpollObject::poll()
 
 //-----------------------------------------------------------------------------
 // 描述: 唤醒正在阻塞的 Poll() 函数
+// 备注:
+//   线程安全。若已有尚未被事件循环处理的唤醒，则无需再次写 eventfd，因为事件循环
+//   在处理唤醒之后才会执行被委托的仿函数。
 //-----------------------------------------------------------------------------
 void EpollObject::wakeup()
 {
-    BYTE val = 0;
-    ::write(pipeFds_[1], &val, sizeof(BYTE));
+    if (wakeupPending_.getAndAdd(1) != 0)
+    {
+        TcpInspectInfo::instance().wakeupSkippedCount.increment();
+        return;
+    }
+
+    TcpInspectInfo::instance().wakeupCount.increment();
+
+    UINT64 val = 1;
+    ::write(wakeupFd_, &val, sizeof(val));
 }
 
 //-----------------------------------------------------------------------------
@@ -70,19 +93,51 @@ void EpollObject::wakeup()
 //-----------------------------------------------------------------------------
 void EpollObject::addConnection(BaseTcpConnection *connection, bool enableSend, bool enableRecv)
 {
-    epollControl(
-        EPOLL_CTL_ADD, connection, connection->getSocket().getHandle(),
-        enableSend, enableRecv);
+    int handle = connection->getSocket().getHandle();
+    HandleState *state = getHandleState(handle, true);
+    if (state == NULL) return;
+
+    UINT events = makeEvents(connection, enableSend, enableRecv);
+    if (epollControl(EPOLL_CTL_ADD, connection, handle, events))
+    {
+        state->param = connection;
+        state->appliedEvents = events;
+        state->wantedEvents = events;
+        state->registered = true;
+        state->rearm = false;
+    }
 }
 
 //-----------------------------------------------------------------------------
 // 描述: 更新 EPoll 中的一个连接
+// 备注:
+//   事件掩码未改变时直接忽略；否则只记录期望的掩码，在下次 epoll_wait() 前统一
+//   提交。这样同一轮事件循环中先打开后关闭 (或反之) 的操作可以相互抵消。
+//   但边缘触发模式下，接收暂停时内核中可能仍有未读的数据，重新打开接收后不会再
+//   产生新的边缘，故此时总要以 EPOLL_CTL_MOD 重新装填，不能与暂停相互抵消。
 //-----------------------------------------------------------------------------
 void EpollObject::updateConnection(BaseTcpConnection *connection, bool enableSend, bool enableRecv)
 {
-    epollControl(
-        EPOLL_CTL_MOD, connection, connection->getSocket().getHandle(),
-        enableSend, enableRecv);
+    HandleState *state = getHandleState(connection->getSocket().getHandle(), false);
+    if (state == NULL || !state->registered || state->param != connection)
+        return;
+
+    UINT events = makeEvents(connection, enableSend, enableRecv);
+    if ((events & EPOLLET) && (events & EPOLLIN) && !(state->wantedEvents & EPOLLIN))
+        state->rearm = true;
+
+    if (events == state->wantedEvents)
+    {
+        TcpInspectInfo::instance().epollCtlSkippedCount.increment();
+        return;
+    }
+
+    state->wantedEvents = events;
+    if (!state->pending)
+    {
+        state->pending = true;
+        pendingHandles_.push_back(connection->getSocket().getHandle());
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -90,9 +145,63 @@ void EpollObject::updateConnection(BaseTcpConnection *connection, bool enableSen
 //-----------------------------------------------------------------------------
 void EpollObject::removeConnection(BaseTcpConnection *connection)
 {
-    epollControl(
-        EPOLL_CTL_DEL, connection, connection->getSocket().getHandle(),
-        false, false);
+    int handle = connection->getSocket().getHandle();
+    HandleState *state = getHandleState(handle, false);
+    if (state == NULL || !state->registered || state->param != connection)
+        return;
+
+    epollControl(EPOLL_CTL_DEL, connection, handle, 0);
+
+    // 若仍在 pendingHandles_ 中，flushPendingChanges() 会因 registered 为 false 而跳过它
+    state->registered = false;
+    state->param = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 监视一个非连接类的文件描述符 (如监听套接字)
+// 备注:
+//   epoll_event.data.ptr 中存放 (HandleWatcher* | 1)，以便与连接对象区分。
+//   同一文件描述符重复监视时，仅更新事件掩码和回调。
+//-----------------------------------------------------------------------------
+void EpollObject::watchHandle(int handle, bool enableSend, bool enableRecv,
+    const HandleEventCallback& callback)
+{
+    HandleWatcherMap::iterator iter = watchers_.find(handle);
+    HandleWatcher *watcher = (iter != watchers_.end() ? iter->second : NULL);
+    int operation = (watcher != NULL ? EPOLL_CTL_MOD : EPOLL_CTL_ADD);
+
+    if (watcher == NULL)
+    {
+        watcher = new HandleWatcher();
+        watcher->handle = handle;
+        watcher->active = true;
+    }
+    watcher->callback = callback;
+
+    void *param = (void*)((uintptr_t)watcher | 1);
+    if (epollControl(operation, param, handle, makeEvents(param, enableSend, enableRecv)))
+        watchers_[handle] = watcher;
+    else if (operation == EPOLL_CTL_ADD)
+        delete watcher;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取消对一个文件描述符的监视
+// 备注:
+//   本轮 epoll_wait() 返回的事件中可能仍引用该 watcher，故延迟到下次轮循前释放。
+//-----------------------------------------------------------------------------
+void EpollObject::unwatchHandle(int handle)
+{
+    HandleWatcherMap::iterator iter = watchers_.find(handle);
+    if (iter == watchers_.end())
+        return;
+
+    HandleWatcher *watcher = iter->second;
+    watchers_.erase(iter);
+
+    epollControl(EPOLL_CTL_DEL, NULL, handle, 0);
+    watcher->active = false;
+    retiredWatchers_.push_back(watcher);
 }
 
 //-----------------------------------------------------------------------------
@@ -122,26 +231,96 @@ void EpollObject::destroyEpoll()
 
 //-----------------------------------------------------------------------------
 
-void EpollObject::createPipe()
+void EpollObject::createWakeupFd()
 {
-    // pipeFds_[0] for reading, pipeFds_[1] for writing.
-    memset(pipeFds_, 0, sizeof(pipeFds_));
-    if (::pipe(pipeFds_) == 0)
-        epollControl(EPOLL_CTL_ADD, NULL, pipeFds_[0], false, true);
+    wakeupFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeupFd_ >= 0)
+        epollControl(EPOLL_CTL_ADD, NULL, wakeupFd_, false, true);
     else
-       ERROR_LOG(SEM_CREATE_PIPE_ERROR);
+       ERROR_LOG(SEM_CREATE_EVENTFD_ERROR);
+}
+
+//-----------------------------------------------------------------------------
+
+void EpollObject::destroyWakeupFd()
+{
+    if (wakeupFd_ >= 0)
+    {
+        epollControl(EPOLL_CTL_DEL, NULL, wakeupFd_, false, false);
+        ::close(wakeupFd_);
+        wakeupFd_ = -1;
+    }
 }
 
 //-----------------------------------------------------------------------------
+// 描述: 根据参数生成 epoll_event.events
+//-----------------------------------------------------------------------------
+UINT EpollObject::makeEvents(void *param, bool enableSend, bool enableRecv) const
+{
+    // 注: 缺省采用 Level Triggered (LT, 也称 "电平触发") 模式。
+    // 若启用了 edgeTriggered_，则连接采用 Edge Triggered (ET, "边缘触发") 模式，
+    // 此时连接必须在每次事件中读(写)至 EAGAIN 为止。eventfd 及非连接类文件描述符
+    // (param 带 HandleWatcher 标记位，如监听套接字) 始终采用 LT 模式，因为其回调
+    // (如每次事件最多接受一批连接) 不保证处理至 EAGAIN。
+
+    UINT events = 0;
+    if (enableSend)
+        events |= EPOLLOUT;
+    if (enableRecv)
+        events |= (EPOLLIN | EPOLLPRI);
+    if (edgeTriggered_ && param != NULL && ((uintptr_t)param & 1) == 0)
+        events |= EPOLLET;
+    return events;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得指定文件描述符的注册状态
+//-----------------------------------------------------------------------------
+EpollObject::HandleState* EpollObject::getHandleState(int handle, bool autoCreate)
+{
+    if (handle < 0)
+        return NULL;
+
+    if (handle >= (int)handleStates_.size())
+    {
+        if (!autoCreate)
+            return NULL;
+        handleStates_.resize(max(handle + 1, (int)handleStates_.size() * 2));
+    }
+
+    return &handleStates_[handle];
+}
 
-void EpollObject::destroyPipe()
+//-----------------------------------------------------------------------------
+// 描述: 将本轮事件循环中累积的事件掩码变更提交给内核
+//-----------------------------------------------------------------------------
+void EpollObject::flushPendingChanges()
 {
-    epollControl(EPOLL_CTL_DEL, NULL, pipeFds_[0], false, false);
+    for (size_t i = 0; i < pendingHandles_.size(); ++i)
+    {
+        int handle = pendingHandles_[i];
+        HandleState& state = handleStates_[handle];
+        if (!state.pending)
+            continue;
+
+        state.pending = false;
+        if (!state.registered)
+            continue;
+
+        bool rearm = state.rearm;
+        state.rearm = false;
+
+        if (state.wantedEvents == state.appliedEvents && !rearm)
+        {
+            TcpInspectInfo::instance().epollCtlSkippedCount.increment();
+            continue;
+        }
 
-    if (pipeFds_[0]) close(pipeFds_[0]);
-    if (pipeFds_[1]) close(pipeFds_[1]);
+        if (epollControl(EPOLL_CTL_MOD, state.param, handle, state.wantedEvents))
+            state.appliedEvents = state.wantedEvents;
+    }
 
-    memset(pipeFds_, 0, sizeof(pipeFds_));
+    pendingHandles_.clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -149,29 +328,43 @@ void EpollObject::destroyPipe()
 void EpollObject::epollControl(int operation, void *param, int handle,
     bool enableSend, bool enableRecv)
 {
-    // 注: 采用 Level Triggered (LT, 也称 "电平触发") 模式
+    epollControl(operation, param, handle, makeEvents(param, enableSend, enableRecv));
+}
 
+//-----------------------------------------------------------------------------
+
+bool EpollObject::epollControl(int operation, void *param, int handle, UINT events)
+{
     struct epoll_event event;
     memset(&event, 0, sizeof(event));
     event.data.ptr = param;
-    if (enableSend)
-        event.events |= EPOLLOUT;
-    if (enableRecv)
-        event.events |= (EPOLLIN | EPOLLPRI);
+    event.events = events;
+
+    TcpInspectInfo::instance().epollCtlCount.increment();
 
     if (::epoll_ctl(epollFd_, operation, handle, &event) < 0)
     {
 		ERROR_LOG(SEM_EPOLL_CTRL_ERROR, operation);
+        return false;
     }
+
+    return true;
 }
 
 //-----------------------------------------------------------------------------
-// 描述: 处理管道事件
+// 描述: 处理唤醒事件
+// 备注:
+//   一次 read() 即可将 eventfd 计数器清零。清除 wakeupPending_ 之后，其它线程的
+//   wakeup() 将重新写 eventfd；而在此之前提交的仿函数，会在本轮事件循环结束前
+//   由 executeDelegatedFunctors() 执行。
 //-----------------------------------------------------------------------------
-void EpollObject::processPipeEvent()
+void EpollObject::processWakeupEvent()
 {
-    BYTE val;
-    ::read(pipeFds_[0], &val, sizeof(BYTE));
+    UINT64 val;
+    ::read(wakeupFd_, &val, sizeof(val));
+
+    wakeupPending_.set(0);
+    __sync_synchronize();
 }
 
 //-----------------------------------------------------------------------------
@@ -206,30 +399,102 @@ enum EPOLL_EVENTS
     for (int i = 0; i < eventCount; i++)
     {
         epoll_event& ev = events_[i];
-        if (ev.data.ptr == NULL)  // for pipe
+        if (ev.data.ptr == NULL)  // for eventfd
+        {
+            processWakeupEvent();
+        }
+        else if ((uintptr_t)ev.data.ptr & 1)  // for HandleWatcher
         {
-            processPipeEvent();
+            HandleWatcher *watcher = (HandleWatcher*)((uintptr_t)ev.data.ptr & ~(uintptr_t)1);
+            EVENT_TYPE eventType = getEventType(ev.events);
+
+            if (watcher->active && eventType != ET_NONE && watcher->callback)
+                watcher->callback(eventType);
         }
         else
         {
             BaseTcpConnection *connection = (BaseTcpConnection*)ev.data.ptr;
-            EVENT_TYPE eventType = ET_NONE;
+            EVENT_TYPE eventType = getEventType(ev.events);
 
 			DEBUG_LOG("processEvents: %u", ev.events);  // debug
 
-            if ((ev.events & EPOLLERR) || ((ev.events & EPOLLHUP) && !(ev.events & EPOLLIN)))
-                eventType = ET_ERROR;
-            else if (ev.events & (EPOLLIN | EPOLLPRI | EPOLLRDHUP))
-                eventType = ET_ALLOW_RECV;
-            else if (ev.events & EPOLLOUT)
-                eventType = ET_ALLOW_SEND;
-
             if (eventType != ET_NONE && onNotifyEvent_)
                 onNotifyEvent_(connection, eventType);
+
+            // 边缘触发模式下，可发送事件不会再次通知，必须与可接收事件一并处理
+            if (edgeTriggered_ && eventType == ET_ALLOW_RECV && (ev.events & EPOLLOUT) && onNotifyEvent_)
+                onNotifyEvent_(connection, ET_ALLOW_SEND);
         }
     }
 }
 
+//-----------------------------------------------------------------------------
+// 描述: 根据 epoll_event.events 判断事件类型
+//-----------------------------------------------------------------------------
+EpollObject::EVENT_TYPE EpollObject::getEventType(UINT events)
+{
+    EVENT_TYPE eventType = ET_NONE;
+
+    if ((events & EPOLLERR) || ((events & EPOLLHUP) && !(events & EPOLLIN)))
+        eventType = ET_ERROR;
+    else if (events & (EPOLLIN | EPOLLPRI | EPOLLRDHUP))
+        eventType = ET_ALLOW_RECV;
+    else if (events & EPOLLOUT)
+        eventType = ET_ALLOW_SEND;
+
+    return eventType;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 释放已取消监视的 watcher
+//-----------------------------------------------------------------------------
+void EpollObject::clearRetiredWatchers()
+{
+    for (size_t i = 0; i < retiredWatchers_.size(); ++i)
+        delete retiredWatchers_[i];
+    retiredWatchers_.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+// 描述: 判断 accept 的错误是否因资源不足 (需暂停接受连接)
+//-----------------------------------------------------------------------------
+bool isAcceptResourceError(int errorCode)
+{
+    return errorCode == EMFILE || errorCode == ENFILE ||
+        errorCode == ENOBUFS || errorCode == ENOMEM;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// class AcceptErrorLog
+
+//-----------------------------------------------------------------------------
+// 描述: 记录 accept 的错误日志
+// 参数:
+//   backOff - 是否因此暂停接受连接
+// 备注:
+//   距上次记录不足 ACCEPT_ERROR_LOG_INTERVAL 毫秒时仅计数，下次记录时一并报告。
+//-----------------------------------------------------------------------------
+void AcceptErrorLog::log(int errorCode, bool backOff)
+{
+    UINT64 now = getCurTicks();
+    if (lastLogTicks_ != 0 && getTickDiff(lastLogTicks_, now) < (UINT64)ACCEPT_ERROR_LOG_INTERVAL)
+    {
+        ++suppressedCount_;
+        return;
+    }
+
+    if (backOff)
+        ERROR_LOG(SEM_ACCEPT_BACKOFF, errorCode, ACCEPT_BACKOFF_MS, suppressedCount_);
+    else
+        ERROR_LOG(SEM_ACCEPT_ERROR_SUPPRESSED, errorCode, suppressedCount_);
+
+    lastLogTicks_ = now;
+    if (lastLogTicks_ == 0) lastLogTicks_ = 1;
+    suppressedCount_ = 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #endif 
@@ -0,0 +1,1118 @@
+///////////////////////////////////////////////////////////////////////////////
+// 文件名称: linux_uring.cpp
+// 功能描述: io_uring 实现
+///////////////////////////////////////////////////////////////////////////////
+
+#include "linux_uring.h"
+#include "ErrMsgs.h"
+#include "LogManager.h"
+#include "EventLoop.h"
+#include "TCPServer.h"
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef _COMPILER_LINUX
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+// 内核头文件过旧时 (缺少 multishot recv 等)，io_uring 后端不可用
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT) && defined(IORING_ASYNC_CANCEL_FD)
+#define _URING_SUPPORTED
+#endif
+
+#ifdef _URING_SUPPORTED
+
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <signal.h>
+
+// 各体系结构的系统调用号相同 (自 Linux 5.1 起统一分配)
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup     425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter     426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register  427
+#endif
+
+static const int RECV_BUFFER_GROUP = 0;   // 接收缓存环的组号
+
+//-----------------------------------------------------------------------------
+
+static int sysUringSetup(UINT entries, struct io_uring_params *params)
+{
+    return (int)::syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sysUringEnter(int ringFd, UINT toSubmit, UINT minComplete, UINT flags,
+    void *arg, size_t argSize)
+{
+    return (int)::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, arg, argSize);
+}
+
+static int sysUringRegister(int ringFd, UINT opcode, void *arg, UINT argCount)
+{
+    return (int)::syscall(__NR_io_uring_register, ringFd, opcode, arg, argCount);
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// class UringObject
+
+UringObject::UringObject(EventLoop *eventLoop) :
+    eventLoop_(eventLoop),
+    ringFd_(-1),
+    features_(0),
+    sqRingPtr_(NULL),
+    sqRingSize_(0),
+    sqHead_(NULL),
+    sqTail_(NULL),
+    sqMask_(0),
+    sqEntries_(0),
+    sqLocalTail_(0),
+    sqes_(NULL),
+    sqesSize_(0),
+    cqRingPtr_(NULL),
+    cqRingSize_(0),
+    cqHead_(NULL),
+    cqTail_(NULL),
+    cqMask_(0),
+    cqes_(NULL),
+    bufRing_(NULL),
+    bufRingSize_(0),
+    recvBuffers_(NULL),
+    recvBufferCount_(0),
+    recvBufferSize_(0),
+    bufRingTail_(0),
+    legacyBuffers_(false),
+    wakeupFd_(-1),
+    wakeupValue_(0)
+{
+    // nothing
+}
+
+UringObject::~UringObject()
+{
+    destroy();
+}
+
+#ifdef _URING_SUPPORTED
+
+//-----------------------------------------------------------------------------
+// 描述: 创建 io_uring 及接收缓存环
+// 参数:
+//   queueDepth      - 提交队列的长度
+//   recvBufferCount - 接收缓存环中缓存块的个数 (向上取整为 2 的整数次幂)
+//   recvBufferSize  - 每个缓存块的字节数
+// 返回:
+//   内核不支持 (或缺少所需的特性) 时返回 false，此时调用者应改用 EpollObject。
+//-----------------------------------------------------------------------------
+bool UringObject::init(int queueDepth, int recvBufferCount, int recvBufferSize)
+{
+    bool result = setupRing(queueDepth) && setupRecvBuffers(recvBufferCount, recvBufferSize);
+
+    if (result)
+    {
+        int probeResult = probeMultishotRecv();
+
+        // 个别内核接受缓存环的注册，但 recv 始终取不到缓存块，此时改用传统方式
+        if (probeResult == -ENOBUFS && !legacyBuffers_)
+        {
+            unregisterBufferRing();
+            provideAllRecvBuffers();
+            probeResult = probeMultishotRecv();
+        }
+
+        if (probeResult != 0)
+        {
+            WARN_LOG(SEM_URING_UNAVAILABLE, "multishot recv not supported");
+            result = false;
+        }
+    }
+
+    if (result)
+    {
+        // 注意: eventfd 须为阻塞模式，因为 io_uring 对非阻塞文件的读请求会直接返回 -EAGAIN
+        wakeupFd_ = ::eventfd(0, EFD_CLOEXEC);
+        if (wakeupFd_ < 0)
+        {
+            ERROR_LOG(SEM_CREATE_EVENTFD_ERROR);
+            result = false;
+        }
+    }
+
+    if (result)
+        armWakeup();
+    else
+        destroy();
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 执行一次轮循
+// 备注:
+//   累积的请求与等待在同一次 io_uring_enter() 中完成。即使不需要等待，也以
+//   IORING_ENTER_GETEVENTS 进入内核，以便内核处理已就绪的完成事件。
+//-----------------------------------------------------------------------------
+void UringObject::poll()
+{
+    int timeout = eventLoop_->calcLoopWaitTimeout();
+
+    clearRetiredWatchers();
+    flushPendingChanges();
+
+    submit(timeout == 0 ? 0 : 1, timeout);
+    eventLoop_->endLoopWait();
+
+    if (timeout != TIMEOUT_INFINITE)
+        eventLoop_->processExpiredTimers();
+
+    processCompletions();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 唤醒正在阻塞的 poll() 函数 (线程安全)
+//-----------------------------------------------------------------------------
+void UringObject::wakeup()
+{
+    if (wakeupPending_.getAndAdd(1) != 0)
+    {
+        TcpInspectInfo::instance().wakeupSkippedCount.increment();
+        return;
+    }
+
+    TcpInspectInfo::instance().wakeupCount.increment();
+
+    UINT64 val = 1;
+    ::write(wakeupFd_, &val, sizeof(val));
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 添加一个连接
+//-----------------------------------------------------------------------------
+void UringObject::addConnection(BaseTcpConnection *connection, bool enableSend, bool enableRecv)
+{
+    int handle = connection->getSocket().getHandle();
+    HandleState *state = getHandleState(handle, true);
+    if (state == NULL) return;
+
+    resetHandleState(handle, *state);
+    state->connection = connection;
+    state->wantSend = enableSend;
+    state->wantRecv = enableRecv;
+    markPending(handle, *state);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 更新一个连接
+// 备注: 只记录期望的状态，在下次 io_uring_enter() 前统一提交相应的请求。
+//-----------------------------------------------------------------------------
+void UringObject::updateConnection(BaseTcpConnection *connection, bool enableSend, bool enableRecv)
+{
+    int handle = connection->getSocket().getHandle();
+    HandleState *state = getHandleState(handle, false);
+    if (state == NULL || state->connection != connection)
+        return;
+
+    if (state->wantSend == enableSend && state->wantRecv == enableRecv)
+    {
+        TcpInspectInfo::instance().epollCtlSkippedCount.increment();
+        return;
+    }
+
+    state->wantSend = enableSend;
+    state->wantRecv = enableRecv;
+    markPending(handle, *state);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 删除一个连接
+// 备注:
+//   内核中尚未完成的请求持有套接字的引用，若不取消，关闭套接字后连接并不会真正
+//   断开。故立即提交取消请求，而不是等到下次轮循。
+//-----------------------------------------------------------------------------
+void UringObject::removeConnection(BaseTcpConnection *connection)
+{
+    int handle = connection->getSocket().getHandle();
+    HandleState *state = getHandleState(handle, false);
+    if (state == NULL || state->connection != connection)
+        return;
+
+    cancelHandle(handle, state->generation);
+    resetHandleState(handle, *state);
+    submit(0, 0);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 监视一个非连接类的文件描述符
+//-----------------------------------------------------------------------------
+void UringObject::watchHandle(int handle, bool enableSend, bool enableRecv,
+    const HandleEventCallback& callback)
+{
+    HandleState *state = getHandleState(handle, true);
+    if (state == NULL || state->connection != NULL) return;
+
+    if (state->watcher != NULL)
+        cancelHandle(handle, state->generation);
+    resetHandleState(handle, *state);
+
+    HandleWatcher *watcher = new HandleWatcher();
+    watcher->accept = false;
+    watcher->events = (enableSend ? POLLOUT : 0) | (enableRecv ? (POLLIN | POLLPRI) : 0);
+    watcher->callback = callback;
+
+    state->watcher = watcher;
+    markPending(handle, *state);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 以 multishot accept 监视一个监听套接字
+// 备注: 每接受一个新连接，回调一次 callback (新套接字为非阻塞模式)。
+//-----------------------------------------------------------------------------
+void UringObject::watchAccept(int handle, const AcceptCallback& callback)
+{
+    HandleState *state = getHandleState(handle, true);
+    if (state == NULL || state->connection != NULL) return;
+
+    if (state->watcher != NULL)
+        cancelHandle(handle, state->generation);
+    resetHandleState(handle, *state);
+
+    HandleWatcher *watcher = new HandleWatcher();
+    watcher->accept = true;
+    watcher->events = 0;
+    watcher->acceptCallback = callback;
+
+    state->watcher = watcher;
+    markPending(handle, *state);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取消对一个文件描述符的监视
+//-----------------------------------------------------------------------------
+void UringObject::unwatchHandle(int handle)
+{
+    HandleState *state = getHandleState(handle, false);
+    if (state == NULL || state->watcher == NULL)
+        return;
+
+    cancelHandle(handle, state->generation);
+    resetHandleState(handle, *state);
+    submit(0, 0);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 创建 io_uring 并映射其 SQ/CQ
+//-----------------------------------------------------------------------------
+bool UringObject::setupRing(int queueDepth)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = queueDepth * 4;
+
+    ringFd_ = sysUringSetup(queueDepth, &params);
+    if (ringFd_ < 0 && errno == EINVAL)
+    {
+        // 较旧的内核不认识部分标志
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = queueDepth * 4;
+        ringFd_ = sysUringSetup(queueDepth, &params);
+    }
+
+    if (ringFd_ < 0)
+    {
+        WARN_LOG(SEM_URING_UNAVAILABLE, sysErrorMessage(errno).c_str());
+        return false;
+    }
+
+    features_ = params.features;
+    if (!(features_ & IORING_FEAT_EXT_ARG) || !(features_ & IORING_FEAT_NODROP))
+    {
+        WARN_LOG(SEM_URING_UNAVAILABLE, "missing IORING_FEAT_EXT_ARG/NODROP");
+        return false;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(UINT);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (features_ & IORING_FEAT_SINGLE_MMAP)
+        sqRingSize_ = cqRingSize_ = max(sqRingSize_, cqRingSize_);
+
+    sqRingPtr_ = ::mmap(NULL, sqRingSize_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (sqRingPtr_ == MAP_FAILED)
+    {
+        sqRingPtr_ = NULL;
+        WARN_LOG(SEM_URING_UNAVAILABLE, "mmap sq ring failed");
+        return false;
+    }
+
+    if (features_ & IORING_FEAT_SINGLE_MMAP)
+        cqRingPtr_ = sqRingPtr_;
+    else
+    {
+        cqRingPtr_ = ::mmap(NULL, cqRingSize_, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if (cqRingPtr_ == MAP_FAILED)
+        {
+            cqRingPtr_ = NULL;
+            WARN_LOG(SEM_URING_UNAVAILABLE, "mmap cq ring failed");
+            return false;
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = ::mmap(NULL, sqesSize_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        WARN_LOG(SEM_URING_UNAVAILABLE, "mmap sqes failed");
+        return false;
+    }
+    sqes_ = (io_uring_sqe*)sqes;
+
+    char *sq = (char*)sqRingPtr_;
+    sqHead_ = (UINT*)(sq + params.sq_off.head);
+    sqTail_ = (UINT*)(sq + params.sq_off.tail);
+    sqMask_ = *(UINT*)(sq + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    sqLocalTail_ = *sqTail_;
+
+    // SQ 数组与 SQE 一一对应，此后只需推进尾部
+    UINT *sqArray = (UINT*)(sq + params.sq_off.array);
+    for (UINT i = 0; i < sqEntries_; i++)
+        sqArray[i] = i;
+
+    char *cq = (char*)cqRingPtr_;
+    cqHead_ = (UINT*)(cq + params.cq_off.head);
+    cqTail_ = (UINT*)(cq + params.cq_off.tail);
+    cqMask_ = *(UINT*)(cq + params.cq_off.ring_mask);
+    cqes_ = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 分配接收缓存，并提供给内核
+// 备注:
+//   缓存块的内存在首次被内核写入时才分配物理页。事件循环线程若已设置了 NUMA
+//   节点偏好 (ThreadPlacement)，这些页即取自该节点。
+//-----------------------------------------------------------------------------
+bool UringObject::setupRecvBuffers(int recvBufferCount, int recvBufferSize)
+{
+    const int MAX_RECV_BUFFER_COUNT = 32768;
+
+    int count = 1;
+    while (count < recvBufferCount && count < MAX_RECV_BUFFER_COUNT)
+        count <<= 1;
+
+    recvBufferCount_ = count;
+    recvBufferSize_ = max(recvBufferSize, 1024);
+
+    void *buffers = ::mmap(NULL, (size_t)recvBufferCount_ * recvBufferSize_, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED)
+    {
+        WARN_LOG(SEM_URING_UNAVAILABLE, "mmap recv buffers failed");
+        return false;
+    }
+    recvBuffers_ = (char*)buffers;
+
+    if (!registerBufferRing())
+        provideAllRecvBuffers();
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 创建并注册接收缓存环 (Linux 5.19+)
+//-----------------------------------------------------------------------------
+bool UringObject::registerBufferRing()
+{
+    bufRingSize_ = recvBufferCount_ * sizeof(struct io_uring_buf);
+    void *bufRing = ::mmap(NULL, bufRingSize_, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufRing == MAP_FAILED)
+        return false;
+    bufRing_ = (io_uring_buf_ring*)bufRing;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (UINT64)(uintptr_t)bufRing_;
+    reg.ring_entries = recvBufferCount_;
+    reg.bgid = RECV_BUFFER_GROUP;
+
+    if (sysUringRegister(ringFd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        ::munmap(bufRing_, bufRingSize_);
+        bufRing_ = NULL;
+        return false;
+    }
+
+    legacyBuffers_ = false;
+    bufRingTail_ = 0;
+    for (int i = 0; i < recvBufferCount_; i++)
+        recycleRecvBuffer(i);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 注销接收缓存环
+//-----------------------------------------------------------------------------
+void UringObject::unregisterBufferRing()
+{
+    if (bufRing_ == NULL) return;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.bgid = RECV_BUFFER_GROUP;
+    sysUringRegister(ringFd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+
+    ::munmap(bufRing_, bufRingSize_);
+    bufRing_ = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 以传统方式 (IORING_OP_PROVIDE_BUFFERS) 一次提供全部接收缓存块
+//-----------------------------------------------------------------------------
+void UringObject::provideAllRecvBuffers()
+{
+    legacyBuffers_ = true;
+
+    io_uring_sqe *sqe = getSqe();
+    if (sqe == NULL) return;
+
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = recvBufferCount_;
+    sqe->addr = (UINT64)(uintptr_t)recvBuffers_;
+    sqe->len = recvBufferSize_;
+    sqe->off = 0;
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    sqe->user_data = makeUserData(OP_PROVIDE, 0, 0);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 检查内核是否支持 multishot recv
+// 返回:
+//   0 表示支持，否则为 recv 的错误码 (如 -ENOBUFS 表示取不到接收缓存块)
+// 备注:
+//   multishot recv 需要 Linux 6.0，单凭特性标志无法判断。此处在一对本地套接字
+//   上实际提交一次: 若收到数据且 CQE 带有 IORING_CQE_F_MORE，即为支持。
+//-----------------------------------------------------------------------------
+int UringObject::probeMultishotRecv()
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+        return -errno;
+
+    char data = 0;
+    ::write(fds[1], &data, 1);
+
+    HandleState state;
+    state.generation = 0;
+    armRecv(fds[0], state);
+
+    int result = -ETIME;
+    UINT64 userData;
+    int res;
+    UINT flags;
+    bool recvCompleted = false;
+    bool armed = false;
+
+    // 之前提交的归还缓存块等请求也会产生完成事件，故最多等待两次
+    for (int i = 0; i < 2 && !recvCompleted; ++i)
+    {
+        submit(1, 1000);
+        while (popCompletion(userData, res, flags))
+        {
+            if ((OP_TYPE)(userData >> 56) != OP_RECV)
+                continue;
+
+            recvCompleted = true;
+            armed = ((flags & IORING_CQE_F_MORE) != 0);
+            result = (res == 1 && armed ? 0 : (res < 0 ? res : -EINVAL));
+            if (flags & IORING_CQE_F_BUFFER)
+                recycleRecvBuffer(flags >> IORING_CQE_BUFFER_SHIFT);
+        }
+    }
+
+    // 取消后等待取消请求及 recv 请求各自的完成事件
+    if (armed)
+    {
+        cancelHandle(fds[0], 0);
+        submit(2, 1000);
+    }
+    while (popCompletion(userData, res, flags))
+    {
+        if (flags & IORING_CQE_F_BUFFER)
+            recycleRecvBuffer(flags >> IORING_CQE_BUFFER_SHIFT);
+    }
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 释放全部资源
+//-----------------------------------------------------------------------------
+void UringObject::destroy()
+{
+    for (size_t i = 0; i < handleStates_.size(); ++i)
+        retireWatcher(handleStates_[i]);
+    clearRetiredWatchers();
+    handleStates_.clear();
+    pendingHandles_.clear();
+
+    if (wakeupFd_ >= 0)
+    {
+        ::close(wakeupFd_);
+        wakeupFd_ = -1;
+    }
+
+    if (sqes_)
+        ::munmap(sqes_, sqesSize_);
+    if (cqRingPtr_ && cqRingPtr_ != sqRingPtr_)
+        ::munmap(cqRingPtr_, cqRingSize_);
+    if (sqRingPtr_)
+        ::munmap(sqRingPtr_, sqRingSize_);
+    sqes_ = NULL;
+    cqRingPtr_ = NULL;
+    sqRingPtr_ = NULL;
+
+    // 先关闭 io_uring (同时注销接收缓存环)，再释放缓存内存
+    if (ringFd_ >= 0)
+    {
+        ::close(ringFd_);
+        ringFd_ = -1;
+    }
+
+    if (bufRing_)
+        ::munmap(bufRing_, bufRingSize_);
+    if (recvBuffers_)
+        ::munmap(recvBuffers_, (size_t)recvBufferCount_ * recvBufferSize_);
+    bufRing_ = NULL;
+    recvBuffers_ = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得一个空闲的 SQE (提交队列已满时先提交已有的请求)
+//-----------------------------------------------------------------------------
+io_uring_sqe* UringObject::getSqe()
+{
+    UINT head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (sqLocalTail_ - head >= sqEntries_)
+    {
+        submit(0, 0);
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (sqLocalTail_ - head >= sqEntries_)
+        {
+            ERROR_LOG(SEM_URING_NO_SQE);
+            return NULL;
+        }
+    }
+
+    io_uring_sqe *sqe = &sqes_[sqLocalTail_ & sqMask_];
+    memset(sqe, 0, sizeof(*sqe));
+    sqLocalTail_++;
+    return sqe;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 提交已填写的请求，并等待完成事件
+// 参数:
+//   waitCount - 至少等待的完成事件个数 (为 0 表示不等待)
+//   timeout   - 等待的超时时间 (毫秒)，TIMEOUT_INFINITE 表示无限等待
+//-----------------------------------------------------------------------------
+int UringObject::submit(int waitCount, int timeout)
+{
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    UINT toSubmit = sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    if (waitCount > 0 && timeout != TIMEOUT_INFINITE)
+    {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (long long)(timeout % 1000) * 1000000;
+        arg.ts = (UINT64)(uintptr_t)&ts;
+    }
+
+    TcpInspectInfo::instance().uringEnterCount.increment();
+
+    int result = sysUringEnter(ringFd_, toSubmit, waitCount,
+        IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    if (result < 0 && errno != ETIME && errno != EINTR && errno != EBUSY && errno != EAGAIN)
+        ERROR_LOG(SEM_URING_ENTER_ERROR, errno);
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 从完成队列中取出一个完成事件
+//-----------------------------------------------------------------------------
+bool UringObject::popCompletion(UINT64& userData, int& result, UINT& flags)
+{
+    UINT head = *cqHead_;
+    if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE))
+        return false;
+
+    const io_uring_cqe& cqe = cqes_[head & cqMask_];
+    userData = cqe.user_data;
+    result = cqe.res;
+    flags = cqe.flags;
+
+    __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 根据本轮事件循环中累积的状态变化，填写相应的请求
+//-----------------------------------------------------------------------------
+void UringObject::flushPendingChanges()
+{
+    for (size_t i = 0; i < pendingHandles_.size(); ++i)
+    {
+        int handle = pendingHandles_[i];
+        HandleState& state = handleStates_[handle];
+        if (!state.pending)
+            continue;
+
+        state.pending = false;
+        if (state.connection != NULL)
+        {
+            if (state.wantRecv && !state.recvArmed)
+                armRecv(handle, state);
+            else if (!state.wantRecv && state.recvArmed && !state.recvCancelling)
+            {
+                cancelRequest(makeUserData(OP_RECV, state.generation, handle), handle, state.generation);
+                state.recvCancelling = true;
+            }
+
+            if (state.wantSend && !state.sendArmed)
+                armSendPoll(handle, state);
+        }
+        else if (state.watcher != NULL && !state.recvArmed)
+            armWatcher(handle, state);
+    }
+
+    pendingHandles_.clear();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 处理唤醒事件
+// 备注: 与 EpollObject 相同，清除 wakeupPending_ 后重新提交读 eventfd 的请求。
+//-----------------------------------------------------------------------------
+void UringObject::processWakeupEvent()
+{
+    wakeupPending_.set(0);
+    __sync_synchronize();
+    armWakeup();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 处理完成队列中的全部完成事件
+//-----------------------------------------------------------------------------
+void UringObject::processCompletions()
+{
+    UINT64 userData;
+    int result;
+    UINT flags;
+    int count = 0;
+
+    while (popCompletion(userData, result, flags))
+    {
+        processCompletion(userData, result, flags);
+        ++count;
+    }
+
+    if (count > 0)
+        TcpInspectInfo::instance().uringCompletionCount.getAndAdd(count);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 处理一个完成事件
+// 备注:
+//   回调中可能注销连接或取消监视，故回调之后须重新查找状态。过期的完成事件
+//   (代数不符) 被忽略，但其占用的接收缓存块仍须归还。
+//-----------------------------------------------------------------------------
+void UringObject::processCompletion(UINT64 userData, int result, UINT flags)
+{
+    OP_TYPE opType = (OP_TYPE)(userData >> 56);
+    int handle = (int)(UINT)userData;
+    bool hasMore = ((flags & IORING_CQE_F_MORE) != 0);
+    HandleState *state = findHandleState(userData);
+
+    switch (opType)
+    {
+    case OP_WAKEUP:
+        processWakeupEvent();
+        break;
+
+    case OP_RECV:
+        {
+            if (state && !hasMore)
+            {
+                state->recvArmed = false;
+                state->recvCancelling = false;
+            }
+
+            bool closed = (result == 0 || (result < 0 && result != -ECANCELED && result != -ENOBUFS));
+            if (result == -ENOBUFS)
+                TcpInspectInfo::instance().uringRecvNoBufferCount.increment();
+
+            if (state && state->connection && (result > 0 || closed) && onRecvData_)
+            {
+                const char *data = ((flags & IORING_CQE_F_BUFFER) ?
+                    getRecvBuffer(flags >> IORING_CQE_BUFFER_SHIFT) : NULL);
+                onRecvData_(state->connection, data, result);
+            }
+
+            if (flags & IORING_CQE_F_BUFFER)
+                recycleRecvBuffer(flags >> IORING_CQE_BUFFER_SHIFT);
+
+            // multishot recv 已结束 (如接收缓存环暂时用尽) 但仍需接收时，重新提交
+            state = findHandleState(userData);
+            if (state && state->connection && !closed && state->wantRecv && !state->recvArmed)
+                markPending(handle, *state);
+        }
+        break;
+
+    case OP_SEND_POLL:
+        if (state && state->connection)
+        {
+            state->sendArmed = false;
+            if (state->wantSend && result != -ECANCELED)
+            {
+                EVENT_TYPE eventType = (result < 0 ? EpollObject::ET_ERROR : EpollObject::getEventType(result));
+                if (eventType != EpollObject::ET_NONE && onNotifyEvent_)
+                    onNotifyEvent_(state->connection, eventType);
+
+                state = findHandleState(userData);
+                if (state && state->connection && state->wantSend && !state->sendArmed)
+                    markPending(handle, *state);
+            }
+        }
+        break;
+
+    case OP_WATCH:
+    case OP_ACCEPT:
+        if (state && state->watcher)
+        {
+            if (!hasMore)
+                state->recvArmed = false;
+
+            HandleWatcher *watcher = state->watcher;
+            bool backOff = false;
+            if (opType == OP_ACCEPT)
+            {
+                if (result >= 0)
+                {
+                    if (watcher->acceptCallback)
+                        watcher->acceptCallback(result);
+                    else
+                        ::close(result);
+                }
+                else if (result != -ECANCELED && result != -EINTR && result != -ECONNABORTED)
+                {
+                    // 资源不足时待接受的连接仍在队列中，立即重新提交只会再次失败
+                    backOff = isAcceptResourceError(-result);
+                    watcher->errorLog.log(-result, backOff);
+                }
+            }
+            else if (result >= 0)
+            {
+                EVENT_TYPE eventType = EpollObject::getEventType(result);
+                if (eventType != EpollObject::ET_NONE && watcher->callback)
+                    watcher->callback(eventType);
+            }
+
+            state = findHandleState(userData);
+            if (state && state->watcher && !state->recvArmed)
+            {
+                if (backOff)
+                    eventLoop_->executeAfter(ACCEPT_BACKOFF_MS, std::bind(&UringObject::rearmWatcher, this, userData));
+                else
+                    markPending(handle, *state);
+            }
+        }
+        else if (opType == OP_ACCEPT && result >= 0)
+            ::close(result);
+        break;
+
+    default:
+        break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取得指定文件描述符的请求状态
+//-----------------------------------------------------------------------------
+UringObject::HandleState* UringObject::getHandleState(int handle, bool autoCreate)
+{
+    if (handle < 0)
+        return NULL;
+
+    if (handle >= (int)handleStates_.size())
+    {
+        if (!autoCreate)
+            return NULL;
+        handleStates_.resize(max(handle + 1, (int)handleStates_.size() * 2));
+    }
+
+    return &handleStates_[handle];
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 根据 user_data 查找请求状态 (已过期时返回 NULL)
+//-----------------------------------------------------------------------------
+UringObject::HandleState* UringObject::findHandleState(UINT64 userData)
+{
+    HandleState *state = getHandleState((int)(UINT)userData, false);
+    if (state && state->generation == (UINT)((userData >> 32) & 0xFFFFFF) &&
+        (state->connection != NULL || state->watcher != NULL))
+        return state;
+
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+
+void UringObject::markPending(int handle, HandleState& state)
+{
+    if (!state.pending)
+    {
+        state.pending = true;
+        pendingHandles_.push_back(handle);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 清除请求状态，并递增代数，使其后到达的旧完成事件被忽略
+//-----------------------------------------------------------------------------
+void UringObject::resetHandleState(int handle, HandleState& state)
+{
+    retireWatcher(state);
+
+    state.generation = (state.generation + 1) & 0xFFFFFF;
+    if (state.generation == 0) state.generation = 1;
+
+    state.connection = NULL;
+    state.wantSend = false;
+    state.wantRecv = false;
+    state.sendArmed = false;
+    state.recvArmed = false;
+    state.recvCancelling = false;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 将 watcher 移入待释放列表 (回调中可能正在使用它)
+//-----------------------------------------------------------------------------
+void UringObject::retireWatcher(HandleState& state)
+{
+    if (state.watcher != NULL)
+    {
+        retiredWatchers_.push_back(state.watcher);
+        state.watcher = NULL;
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void UringObject::clearRetiredWatchers()
+{
+    for (size_t i = 0; i < retiredWatchers_.size(); ++i)
+        delete retiredWatchers_[i];
+    retiredWatchers_.clear();
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 提交读 eventfd 的请求
+//-----------------------------------------------------------------------------
+void UringObject::armWakeup()
+{
+    io_uring_sqe *sqe = getSqe();
+    if (sqe == NULL) return;
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeupFd_;
+    sqe->addr = (UINT64)(uintptr_t)&wakeupValue_;
+    sqe->len = sizeof(wakeupValue_);
+    sqe->user_data = makeUserData(OP_WAKEUP, 0, wakeupFd_);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 提交连接的 multishot recv (从接收缓存环中选取缓存块)
+//-----------------------------------------------------------------------------
+void UringObject::armRecv(int handle, HandleState& state)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (sqe == NULL) return;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = handle;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    sqe->user_data = makeUserData(OP_RECV, state.generation, handle);
+
+    state.recvArmed = true;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 提交等待连接可发送的请求
+//-----------------------------------------------------------------------------
+void UringObject::armSendPoll(int handle, HandleState& state)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (sqe == NULL) return;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = handle;
+    sqe->poll32_events = POLLOUT;
+    sqe->user_data = makeUserData(OP_SEND_POLL, state.generation, handle);
+
+    state.sendArmed = true;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 提交 watcher 的 multishot poll 或 multishot accept
+//-----------------------------------------------------------------------------
+void UringObject::armWatcher(int handle, HandleState& state)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (sqe == NULL) return;
+
+    sqe->fd = handle;
+    if (state.watcher->accept)
+    {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = makeUserData(OP_ACCEPT, state.generation, handle);
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = state.watcher->events;
+        sqe->user_data = makeUserData(OP_WATCH, state.generation, handle);
+    }
+
+    state.recvArmed = true;
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 退避结束后重新提交监视者的请求
+// 备注: 期间已取消监视或重新监视 (代数不符) 时，不做任何事。
+//-----------------------------------------------------------------------------
+void UringObject::rearmWatcher(UINT64 userData)
+{
+    HandleState *state = findHandleState(userData);
+    if (state && state->watcher && !state->recvArmed)
+        markPending((int)(UINT)userData, *state);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取消指定的请求
+//-----------------------------------------------------------------------------
+void UringObject::cancelRequest(UINT64 userData, int handle, UINT generation)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (sqe == NULL) return;
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = userData;
+    sqe->user_data = makeUserData(OP_CANCEL, generation, handle);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 取消指定文件描述符上的全部请求
+//-----------------------------------------------------------------------------
+void UringObject::cancelHandle(int handle, UINT generation)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (sqe == NULL) return;
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = handle;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = makeUserData(OP_CANCEL, generation, handle);
+}
+
+//-----------------------------------------------------------------------------
+// 描述: 将缓存块归还给接收缓存环
+//-----------------------------------------------------------------------------
+void UringObject::recycleRecvBuffer(int bufferId)
+{
+    if (legacyBuffers_)
+    {
+        io_uring_sqe *sqe = getSqe();
+        if (sqe == NULL) return;
+
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = 1;
+        sqe->addr = (UINT64)(uintptr_t)getRecvBuffer(bufferId);
+        sqe->len = recvBufferSize_;
+        sqe->off = bufferId;
+        sqe->buf_group = RECV_BUFFER_GROUP;
+        sqe->user_data = makeUserData(OP_PROVIDE, 0, 0);
+        return;
+    }
+
+    struct io_uring_buf *buf = &bufRing_->bufs[bufRingTail_ & (recvBufferCount_ - 1)];
+    buf->addr = (UINT64)(uintptr_t)getRecvBuffer(bufferId);
+    buf->len = recvBufferSize_;
+    buf->bid = (WORD)bufferId;
+
+    bufRingTail_++;
+    __atomic_store_n(&bufRing_->tail, bufRingTail_, __ATOMIC_RELEASE);
+}
+
+//-----------------------------------------------------------------------------
+
+UINT64 UringObject::makeUserData(OP_TYPE opType, UINT generation, int handle)
+{
+    return ((UINT64)opType << 56) | ((UINT64)(generation & 0xFFFFFF) << 32) | (UINT)handle;
+}
+
+#else  /* ifdef _URING_SUPPORTED */
+
+bool UringObject::init(int queueDepth, int recvBufferCount, int recvBufferSize)
+{
+    WARN_LOG(SEM_URING_UNAVAILABLE, "not supported by the kernel headers");
+    return false;
+}
+
+void UringObject::destroy() {}
+void UringObject::poll() {}
+void UringObject::wakeup() {}
+void UringObject::addConnection(BaseTcpConnection *connection, bool enableSend, bool enableRecv) {}
+void UringObject::updateConnection(BaseTcpConnection *connection, bool enableSend, bool enableRecv) {}
+void UringObject::removeConnection(BaseTcpConnection *connection) {}
+void UringObject::watchHandle(int handle, bool enableSend, bool enableRecv, const HandleEventCallback& callback) {}
+void UringObject::watchAccept(int handle, const AcceptCallback& callback) {}
+void UringObject::unwatchHandle(int handle) {}
+
+#endif  /* ifdef _URING_SUPPORTED */
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
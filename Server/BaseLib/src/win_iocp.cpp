@@ -261,6 +261,7 @@ void IocpObject::work()
         // 等待事件
         BOOL ret = ::GetQueuedCompletionStatus(iocpHandle_, &bytesTransferred, &nTemp,
             (LPOVERLAPPED*)&overlappedPtr, timeout);
+        eventLoop_->endLoopWait();
 
         // 处理定时器事件
         if (timeout != TIMEOUT_INFINITE)